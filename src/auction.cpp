@@ -0,0 +1,63 @@
+#include "auction.h"
+
+#include <algorithm>
+
+Auction::Auction(unsigned property_id, int starting_bid, int increment, unsigned players,
+                 Clock::time_point deadline)
+    : property_id_{property_id}, starting_bid_{std::max(starting_bid, 1)},
+      increment_{std::max(increment, 1)}, best_(std::min(players, max_players)),
+      deadline_{deadline.time_since_epoch().count()}
+{
+}
+
+Auction::BidResult Auction::bid(unsigned player_id, int amount, int cash, Clock::time_point now)
+{
+    if (player_id >= best_.size()) return BidResult::not_a_bidder;
+
+    std::uint64_t top = top_.load();
+    for (;;) {
+        if (top & closed_bit) return BidResult::closed;
+        if (amount < this->minimum_bid(top)) return BidResult::too_low;
+        if (amount > cash) return BidResult::cannot_afford;
+        // On failure top is reloaded, and the bid checked against the new one
+        if (top_.compare_exchange_weak(top, pack(Bid{player_id, amount}))) break;
+    }
+
+    // Bids only go up, so this is the bidder's highest unless one of their
+    // own later bids has got in first
+    int best = best_[player_id].load();
+    while (best < amount && !best_[player_id].compare_exchange_weak(best, amount)) {}
+    last_bid_ = now.time_since_epoch().count();
+    ++bids_;
+    return BidResult::accepted;
+}
+
+std::optional<Auction::Bid> Auction::close() noexcept
+{
+    return unpack(top_.fetch_or(closed_bit));
+}
+
+std::vector<Auction::Bid> Auction::ranking() const
+{
+    std::vector<Bid> bids;
+    for (unsigned player_id = 0; player_id < best_.size(); ++player_id) {
+        const int best = best_[player_id].load();
+        if (best > 0) bids.push_back(Bid{player_id, best});
+    }
+
+    // The top bid may not have reached its bidder's best yet
+    if (const auto top = this->highest()) {
+        const auto it = std::find_if(bids.begin(), bids.end(), [&](const Bid& bid) {
+            return bid.player_id == top->player_id;
+        });
+        if (it == bids.end()) {
+            bids.push_back(*top);
+        } else {
+            it->amount = std::max(it->amount, top->amount);
+        }
+    }
+
+    std::sort(bids.begin(), bids.end(),
+              [](const Bid& a, const Bid& b) { return a.amount > b.amount; });
+    return bids;
+}
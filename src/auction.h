@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// An auction of one property, which any number of sessions can bid in at
+// once without waiting on the game's lock or any other.
+//
+// The highest bid, who made it, and whether the auction has closed are
+// packed into a single word, so a bid is checked and made with one compare
+// and swap, and closing the auction is a single atomic operation too: a bid
+// either gets in before the auction closes or is turned away, and the
+// highest bid can't change once it has. Every bid must beat the last by the
+// increment, so accepted bids only ever go up.
+//
+// Bids are checked against the cash the caller says the bidder has, which
+// may be out of date by the time the auction ends, so whoever settles it
+// should try the bidders in ranking order until one can pay.
+struct Auction {
+    using Clock = std::chrono::steady_clock;
+
+    struct Bid {
+        unsigned player_id = 0;
+        int amount = 0;
+    };
+
+    enum class BidResult { accepted, too_low, cannot_afford, closed, not_a_bidder };
+
+    // Bids start at 1 at the least. Only the players in the game when the
+    // auction opens can bid, and only this many of them can be told apart.
+    static constexpr unsigned max_players = (1u << 31) - 2;
+
+    Auction(unsigned property_id, int starting_bid, int increment, unsigned players,
+            Clock::time_point deadline);
+
+    BidResult bid(unsigned player_id, int amount, int cash, Clock::time_point now = Clock::now());
+
+    // Turns away any more bids, returning the highest
+    std::optional<Bid> close() noexcept;
+
+    bool closed() const noexcept { return top_.load() & closed_bit; }
+    std::optional<Bid> highest() const noexcept { return unpack(top_.load()); }
+    // The least the next bid can be, which is more than any int once the
+    // top bid is within the increment of the largest
+    std::int64_t minimum_bid() const noexcept { return this->minimum_bid(top_.load()); }
+
+    // Each bidder's highest bid, highest first. Best called once closed.
+    std::vector<Bid> ranking() const;
+
+    unsigned property_id() const noexcept { return property_id_; }
+    std::uint64_t bids() const noexcept { return bids_.load(); }
+
+    // When the auction is due to end, as the server running it decides
+    Clock::time_point deadline() const noexcept {
+        return Clock::time_point(Clock::duration(deadline_.load()));
+    }
+    void extend(Clock::time_point deadline) noexcept {
+        deadline_ = deadline.time_since_epoch().count();
+    }
+
+    // When the last bid was accepted, only meaningful if there has been one
+    Clock::time_point last_bid() const noexcept {
+        return Clock::time_point(Clock::duration(last_bid_.load()));
+    }
+private:
+    // Bid amount in the high half, then the closed bit, then the bidder's id
+    // plus one, with no bidder as 0
+    static constexpr std::uint64_t closed_bit = std::uint64_t(1) << 31;
+    static constexpr std::uint64_t bidder_mask = closed_bit - 1;
+
+    static std::uint64_t pack(const Bid& bid) noexcept {
+        return std::uint64_t(std::uint32_t(bid.amount)) << 32 | (bid.player_id + 1);
+    }
+    static std::optional<Bid> unpack(std::uint64_t top) noexcept {
+        if ((top & bidder_mask) == 0) return {};
+        return Bid{unsigned((top & bidder_mask) - 1), int(top >> 32)};
+    }
+    std::int64_t minimum_bid(std::uint64_t top) const noexcept {
+        const auto bid = unpack(top);
+        return bid ? std::int64_t(bid->amount) + increment_ : starting_bid_;
+    }
+
+    const unsigned property_id_;
+    const int starting_bid_;
+    const int increment_;
+
+    std::atomic<std::uint64_t> top_{0};
+    // Highest bid each player has made, 0 if none. Updated just after the
+    // bid is accepted, so may briefly lag the top bid.
+    std::vector<std::atomic<int>> best_;
+    std::atomic<std::uint64_t> bids_{0};
+    std::atomic<Clock::rep> deadline_;
+    std::atomic<Clock::rep> last_bid_{0};
+};
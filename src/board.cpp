@@ -0,0 +1,248 @@
+#include "board.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+    constexpr Square property(unsigned id) { return {SquareType::property, id}; }
+    constexpr Square square(SquareType type) { return {type, 0}; }
+}
+
+const std::array<Square, board_size> board = {{
+    square(SquareType::go),
+    property(0),                            // Old Kent Road
+    square(SquareType::community_chest),
+    property(1),                            // Whitechapel Road
+    square(SquareType::income_tax),
+    property(22),                           // Kings Cross Station
+    property(2),                            // The Angel Islington
+    square(SquareType::chance),
+    property(3),                            // Euston Road
+    property(4),                            // Pentonville Road
+
+    square(SquareType::jail),
+    property(5),                            // Pall Mall
+    property(26),                           // Electric Company
+    property(6),                            // Whitehall
+    property(7),                            // Northumberland Avenue
+    property(23),                           // Marylebone Station
+    property(8),                            // Bow Street
+    square(SquareType::community_chest),
+    property(9),                            // Marlborough Street
+    property(10),                           // Vine Street
+
+    square(SquareType::free_parking),
+    property(11),                           // Strand
+    square(SquareType::chance),
+    property(12),                           // Fleet Street
+    property(13),                           // Trafalgar Square
+    property(24),                           // Fenchurch St. Station
+    property(14),                           // Leicester Square
+    property(15),                           // Coventry Street
+    property(27),                           // Water Works
+    property(16),                           // Piccadiliy
+
+    square(SquareType::go_to_jail),
+    property(17),                           // Regent Street
+    property(18),                           // Oxford Street
+    square(SquareType::community_chest),
+    property(19),                           // Bond Street
+    property(25),                           // Liverpool St. Station
+    square(SquareType::chance),
+    property(20),                           // Park lane
+    square(SquareType::super_tax),
+    property(21),                           // Mayfair
+}};
+
+const std::array<unsigned, num_standard_properties> property_squares = [] {
+    std::array<unsigned, num_standard_properties> squares = {};
+    for (unsigned i = 0; i < board_size; ++i) {
+        if (board[i].type == SquareType::property) squares[board[i].property_id] = i;
+    }
+    return squares;
+}();
+
+const std::array<PropertySet, 8> colour_sets = {{
+    PropertySet::brown, PropertySet::lblue, PropertySet::pink, PropertySet::orange,
+    PropertySet::red, PropertySet::yellow, PropertySet::green, PropertySet::dblue,
+}};
+
+using Action = Card::Action;
+
+const std::array<Card, deck_size> chance_cards = {{
+    {Action::advance_to, 0},                // Advance to go
+    {Action::advance_to, 24},               // Advance to Trafalgar Square
+    {Action::advance_to, 11},               // Advance to Pall Mall
+    {Action::advance_to, 39},               // Advance to Mayfair
+    {Action::advance_to, 15},               // Take a trip to Marylebone Station
+    {Action::go_back, 3},
+    {Action::go_to_jail},
+    {Action::collect, 50},                  // Bank pays you dividend
+    {Action::get_out_of_jail},
+    {Action::repairs, 25, 100},             // General repairs
+    {Action::repairs, 40, 115},             // Street repairs
+    {Action::pay, 150},                     // School fees
+    {Action::pay, 15},                      // Speeding fine
+    {Action::pay, 20},                      // Drunk in charge
+    {Action::collect, 150},                 // Building loan matures
+    {Action::collect, 100},                 // Crossword competition
+}};
+
+const std::array<Card, deck_size> community_chest_cards = {{
+    {Action::advance_to, 0},                // Advance to go
+    {Action::go_to_jail},
+    {Action::go_back_to, 1},                // Go back to Old Kent Road
+    {Action::collect, 200},                 // Bank error in your favour
+    {Action::pay, 50},                      // Doctor's fee
+    {Action::collect, 50},                  // Sale of stock
+    {Action::get_out_of_jail},
+    {Action::pay, 100},                     // Hospital fees
+    {Action::collect, 20},                  // Income tax refund
+    {Action::pay, 50},                      // Insurance premium
+    {Action::collect, 100},                 // Annuity matures
+    {Action::collect, 10},                  // Second prize in a beauty contest
+    {Action::collect, 100},                 // Inheritance
+    {Action::collect, 25},                  // Interest on shares
+    {Action::collect, 10},                  // It's your birthday
+    {Action::pay, 10},                      // Fine
+}};
+
+// Landing probabilities ------------------------------------------------------
+
+namespace {
+
+using Distribution = std::array<double, board_size>;
+
+// Adds where a player who lands on square ends up, after following any card
+// they draw, to destinations. Being sent to jail is recorded as ending up on
+// the go to jail square, which nobody can otherwise stay on.
+void resolve(unsigned square, double probability, Distribution& destinations)
+{
+    const auto draw = [square, probability, &destinations](const auto& cards) {
+        const double p = probability / cards.size();
+        for (const auto& card : cards) {
+            switch (card.action) {
+            case Card::Action::advance_to:
+            case Card::Action::go_back_to:
+                resolve(card.value, p, destinations);
+                break;
+            case Card::Action::go_back:
+                resolve((square + board_size - card.value) % board_size, p, destinations);
+                break;
+            case Card::Action::go_to_jail:
+                destinations[go_to_jail_square] += p;
+                break;
+            default:
+                destinations[square] += p;
+                break;
+            }
+        }
+    };
+
+    switch (board[square].type) {
+    case SquareType::chance:
+        draw(chance_cards);
+        break;
+    case SquareType::community_chest:
+        draw(community_chest_cards);
+        break;
+    default:
+        destinations[square] += probability;
+        break;
+    }
+}
+
+// Solves for the stationary distribution of the Markov chain with one state
+// for each square and number of doubles rolled so far in the turn, plus one
+// for each turn spent in jail. Get out of jail free cards are ignored.
+std::array<double, board_size> solve_landing_probabilities()
+{
+    std::array<Distribution, board_size> resolved = {};
+    for (unsigned square = 0; square < board_size; ++square) {
+        resolve(square, 1.0, resolved[square]);
+    }
+
+    constexpr unsigned max_doubles = 3;
+    constexpr unsigned jail_state = board_size * max_doubles;
+    constexpr unsigned num_states = jail_state + 3;
+
+    std::vector<double> state(num_states, 1.0 / num_states);
+    std::vector<double> next(num_states);
+
+    // Moves a player out of square by the dice, into the next state
+    const auto move = [&resolved, &next](unsigned square, int dice, unsigned doubles, double p) {
+        const auto& destinations = resolved[(square + dice) % board_size];
+        for (unsigned d = 0; d < board_size; ++d) {
+            if (destinations[d] == 0.0) continue;
+            if (d == go_to_jail_square) {
+                next[jail_state] += p * destinations[d];
+            } else {
+                next[d * max_doubles + doubles] += p * destinations[d];
+            }
+        }
+    };
+
+    for (unsigned iteration = 0; iteration < 10000; ++iteration) {
+        std::fill(next.begin(), next.end(), 0.0);
+
+        for (unsigned die1 = 1; die1 <= 6; ++die1) {
+            for (unsigned die2 = 1; die2 <= 6; ++die2) {
+                const bool is_double = die1 == die2;
+                const int dice = die1 + die2;
+
+                for (unsigned s = 0; s < jail_state; ++s) {
+                    const double p = state[s] / 36.0;
+                    const unsigned square = s / max_doubles;
+                    const unsigned doubles = s % max_doubles;
+
+                    if (is_double && doubles + 1 == max_doubles) {
+                        next[jail_state] += p;
+                    } else {
+                        move(square, dice, is_double ? doubles + 1 : 0, p);
+                    }
+                }
+
+                for (unsigned turns = 0; turns < 3; ++turns) {
+                    const double p = state[jail_state + turns] / 36.0;
+                    // Rolling a double, or paying the fine on the third turn,
+                    // moves the player out of jail with no extra roll
+                    if (is_double || turns == 2) {
+                        move(jail_square, dice, 0, p);
+                    } else {
+                        next[jail_state + turns + 1] += p;
+                    }
+                }
+            }
+        }
+
+        double change = 0.0;
+        for (unsigned s = 0; s < num_states; ++s) change += std::abs(next[s] - state[s]);
+        state.swap(next);
+        if (change < 1e-12) break;
+    }
+
+    std::array<double, board_size> probabilities = {};
+    for (unsigned s = 0; s < jail_state; ++s) probabilities[s / max_doubles] += state[s];
+    return probabilities;
+}
+
+}
+
+const std::array<double, board_size>& landing_probabilities()
+{
+    static const auto probabilities = solve_landing_probabilities();
+    return probabilities;
+}
+
+const std::array<int, num_standard_properties>& landing_weights()
+{
+    static const auto weights = [] {
+        std::array<int, num_standard_properties> weights = {};
+        for (unsigned id = 0; id < weights.size(); ++id) {
+            const double p = landing_probabilities()[property_squares[id]];
+            weights[id] = std::lround(p * board_size * landing_weight_scale);
+        }
+        return weights;
+    }();
+    return weights;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+
+#include "game.h"
+
+// The physical board. The Game only models finances, this describes the 40
+// squares players move around, and the cards they can draw. It is used by the
+// headless simulator and anything else that needs to know how often players
+// land where.
+
+enum class SquareType {
+    go, property, community_chest, chance, income_tax, super_tax,
+    jail, free_parking, go_to_jail
+};
+
+struct Square {
+    SquareType type;
+    unsigned property_id = 0;  // Only meaningful for SquareType::property
+};
+
+constexpr unsigned board_size = 40;
+constexpr unsigned jail_square = 10;
+constexpr unsigned go_to_jail_square = 30;
+
+constexpr int income_tax = 200;
+constexpr int super_tax = 100;
+constexpr int jail_fine = 50;
+
+extern const std::array<Square, board_size> board;
+
+// Square that each property sits on, indexed by property id
+extern const std::array<unsigned, num_standard_properties> property_squares;
+
+// The eight sets of properties that can have houses built on them
+extern const std::array<PropertySet, 8> colour_sets;
+
+struct Card {
+    enum class Action {
+        advance_to,         // Move forward to square value, passing go if necessary
+        go_back,            // Move back value squares
+        go_back_to,         // Move back to square value, without passing go
+        go_to_jail,
+        collect,            // Collect value from the bank
+        pay,                // Pay value to the bank
+        repairs,            // Pay value per house and value2 per hotel
+        get_out_of_jail,
+    };
+
+    Action action;
+    int value = 0;
+    int value2 = 0;
+};
+
+constexpr unsigned deck_size = 16;
+
+extern const std::array<Card, deck_size> chance_cards;
+extern const std::array<Card, deck_size> community_chest_cards;
+
+// Landing probabilities ------------------------------------------------------
+
+// Long run probability that a roll of the dice (after any cards have been
+// followed) leaves a player on each square. Time spent in jail is not counted
+// as landing on the jail square. Solved once, the first time it is needed.
+const std::array<double, board_size>& landing_probabilities();
+
+// How often each property is landed on compared to a square picked uniformly
+// at random, in units of 1/landing_weight_scale, indexed by property id
+const std::array<int, num_standard_properties>& landing_weights();
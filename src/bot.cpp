@@ -0,0 +1,99 @@
+#include "bot.h"
+
+#include <algorithm>
+#include <random>
+
+#include "thread_pool.h"
+
+namespace {
+    // The bot currently playing a move on this thread, so that changes made
+    // by bots can be told apart
+    thread_local const Bot* playing_bot = nullptr;
+}
+
+Bot::Bot(BotHost& host, ThreadPool& pool, unsigned player_id, const SearchOptions& options)
+    : host_{host}, pool_{pool}, player_id_{player_id}, options_{options},
+      rng_{std::random_device{}()}
+{}
+
+Bot::~Bot()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_ = true;
+    waiting_ = {};
+    idle_.wait(lock, [this] { return !searching_; });
+}
+
+void Bot::game_changed(std::uint64_t version, const Game& game)
+{
+    if (playing_bot == this) return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stopping_) return;
+
+    if (!playing_bot) {
+        ++changes_;
+    } else if (answered_ == changes_) {
+        // Another bot's move, and this one has already moved since anyone
+        // else did anything
+        return;
+    }
+
+    if (searching_) {
+        waiting_.emplace(version, game);
+    } else {
+        searching_ = true;
+        const std::uint64_t changes = changes_;
+        lock.unlock();
+        this->start(version, changes, game);
+    }
+}
+
+void Bot::start(std::uint64_t version, std::uint64_t changes, Game game)
+{
+    pool_.submit([this, version, changes, game = std::move(game)] {
+        const auto actions = search(game, player_id_, rng_, options_);
+
+        // Never hold our own mutex while calling into the host, which calls
+        // back into game_changed with its mutex held
+        const bool moved = this->play(version, changes, actions);
+
+        std::optional<std::pair<std::uint64_t, Game>> next;
+        std::uint64_t next_changes = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Another bot's move made while searching has been answered
+            if (moved && answered_ == changes_) waiting_ = {};
+            if (!stopping_) next = std::move(waiting_);
+            waiting_ = {};
+            next_changes = changes_;
+            searching_ = next.has_value();
+            if (!searching_) idle_.notify_all();
+        }
+
+        if (next) this->start(next->first, next_changes, std::move(next->second));
+    });
+}
+
+bool Bot::play(std::uint64_t version, std::uint64_t changes,
+               const std::vector<BotAction>& actions)
+{
+    // The move was planned for a game that no longer exists
+    if (host_.version() != version) return false;
+
+    // Before moving, so other bots' answers to this move are ignored
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        answered_ = std::max(answered_, changes);
+    }
+
+    playing_bot = this;
+    for (const auto& action : actions) {
+        const GameEvent event{[action, player_id = player_id_](Game& g) {
+            return action.apply(g, player_id);
+        }};
+        if (!host_.play(event)) break;
+    }
+    playing_bot = nullptr;
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "bot_search.h"
+#include "event.h"
+#include "game.h"
+
+struct ThreadPool;
+
+// What bots play through, which is the GameServer in a live game
+struct BotHost {
+    virtual ~BotHost() = default;
+
+    // Incremented every time the game changes
+    virtual std::uint64_t version() = 0;
+    // Applies the event and tells everyone about it, as if a person had
+    virtual Result play(const GameEvent&) = 0;
+};
+
+// A computer player in a live game. Whenever somebody else changes the game
+// the bot searches for its best move on the shared bot pool, then plays it
+// through the host like any human would. A move is thrown away if the game
+// has changed again by the time the search finishes.
+//
+// Bots answer each change made by anyone but a bot with at most one move
+// each. Another bot's move is only answered by bots that haven't yet moved
+// since, so however many bots there are they can't keep answering each
+// other, and the game goes quiet until somebody else does something.
+struct Bot {
+    Bot(BotHost&, ThreadPool&, unsigned player_id, const SearchOptions& = {});
+    ~Bot();
+
+    Bot(const Bot&) = delete;
+    Bot& operator=(const Bot&) = delete;
+
+    unsigned player_id() const noexcept { return player_id_; }
+
+    // Called by the GameServer, with its mutex held, after every change to
+    // the game. Never blocks on the search.
+    void game_changed(std::uint64_t version, const Game&);
+private:
+    // Searches from the game as of version, answering every change up to
+    // the given count of changes not made by bots
+    void start(std::uint64_t version, std::uint64_t changes, Game);
+    // Returns false if the move was thrown away
+    bool play(std::uint64_t version, std::uint64_t changes, const std::vector<BotAction>&);
+
+    BotHost& host_;
+    ThreadPool& pool_;
+    const unsigned player_id_;
+    const SearchOptions options_;
+
+    // Only used by the running search, of which there is at most one
+    Rng rng_;
+
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    bool searching_ = false;
+    bool stopping_ = false;
+    // Newest change made while a search was running
+    std::optional<std::pair<std::uint64_t, Game>> waiting_ = {};
+    // Changes made by anyone but a bot, and how many of them had been made
+    // when the bot last moved
+    std::uint64_t changes_ = 0;
+    std::uint64_t answered_ = 0;
+};
@@ -0,0 +1,193 @@
+#include "bot_search.h"
+
+#include <cmath>
+#include <memory>
+
+#include "board.h"
+
+// BotAction ------------------------------------------------------------------
+
+Result BotAction::check(const Game& game, unsigned player) const
+{
+    switch (type) {
+    case Type::pass: return true;
+    case Type::buy_property: return can_buy_property(game, player, property, amount);
+    case Type::mortgage: return can_mortgage(game, player, property);
+    case Type::unmortgage: return can_unmortgage(game, player, property);
+    case Type::build_houses: return can_build_houses(game, player, set, amount);
+    case Type::sell_houses: return can_sell_houses(game, player, set, amount);
+    case Type::take_out_secured_debt: return can_take_out_secured_debt(game, player, amount);
+    case Type::take_out_unsecured_debt: return can_take_out_unsecured_debt(game, player, amount);
+    case Type::pay_off_secured_debt: return can_pay_off_secured_debt(game, player, amount);
+    case Type::pay_off_unsecured_debt: return can_pay_off_unsecured_debt(game, player, amount);
+    }
+    return false;
+}
+
+Result BotAction::apply(Game& game, unsigned player) const
+{
+    switch (type) {
+    case Type::pass: return true;
+    case Type::buy_property: return buy_property(game, player, property, amount);
+    case Type::mortgage: return mortgage(game, player, property);
+    case Type::unmortgage: return unmortgage(game, player, property);
+    case Type::build_houses: return build_houses(game, player, set, amount);
+    case Type::sell_houses: return sell_houses(game, player, set, amount);
+    case Type::take_out_secured_debt: return take_out_secured_debt(game, player, amount);
+    case Type::take_out_unsecured_debt: return take_out_unsecured_debt(game, player, amount);
+    case Type::pay_off_secured_debt: return pay_off_secured_debt(game, player, amount);
+    case Type::pay_off_unsecured_debt: return pay_off_unsecured_debt(game, player, amount);
+    }
+    return false;
+}
+
+std::vector<BotAction> legal_actions(const Game& game, unsigned player_id)
+{
+    using Type = BotAction::Type;
+
+    std::vector<BotAction> actions;
+    const auto add = [&game, player_id, &actions](BotAction action) {
+        if (action.check(game, player_id)) actions.push_back(action);
+    };
+
+    add({Type::pass});
+
+    const auto& player = game.player(player_id);
+    for (unsigned id = 0; id < game.properties.size(); ++id) {
+        const auto& property = game.properties[id];
+        if (!property.owner_id) {
+            const int price = property.guide_price() * game.ppi;
+            add({Type::buy_property, id, 0, price});
+        } else if (*property.owner_id == player_id && property.houses == 0) {
+            add({property.mortgaged() ? Type::unmortgage : Type::mortgage, id});
+        }
+    }
+
+    for (const auto set : colour_sets) {
+        if ((player.properties & set) != set) continue;
+        add({Type::build_houses, 0, set, 1});
+        add({Type::sell_houses, 0, set, 1});
+    }
+
+    // Debt in fixed steps, to keep the tree narrow
+    constexpr int debt_step = 100;
+    add({Type::take_out_secured_debt, 0, 0, debt_step});
+    add({Type::take_out_unsecured_debt, 0, 0, debt_step});
+    add({Type::pay_off_secured_debt, 0, 0, std::min(player.secured_debt, player.cash)});
+    add({Type::pay_off_unsecured_debt, 0, 0, std::min(player.unsecured_debt, player.cash)});
+
+    return actions;
+}
+
+// Search ---------------------------------------------------------------------
+
+namespace {
+
+struct Node {
+    Node(BotAction action, std::vector<BotAction> untried)
+        : action{action}, untried{std::move(untried)}
+    {}
+
+    BotAction action;
+    std::vector<BotAction> untried;
+    std::vector<std::unique_ptr<Node>> children;
+
+    unsigned visits = 0;
+    double reward = 0.0;
+};
+
+// Child with the highest upper confidence bound (UCB1)
+Node* select(Node& node)
+{
+    constexpr double exploration = 1.4;
+    const double log_visits = std::log(double(node.visits));
+
+    Node* best = nullptr;
+    double best_score = -1.0;
+    for (const auto& child : node.children) {
+        const double score = child->reward / child->visits
+                             + exploration * std::sqrt(log_visits / child->visits);
+        if (score > best_score) {
+            best = child.get();
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+// Share of the total net worth the player ends up with, nothing if bankrupt
+double score(const GameOutcome& outcome, unsigned player_id)
+{
+    if (outcome.bankrupt[player_id]) return 0.0;
+
+    double total = 0.0;
+    for (const int worth : outcome.net_worth) total += std::max(worth, 0);
+    if (total <= 0.0) return 0.0;
+    return std::max(outcome.net_worth[player_id], 0) / total;
+}
+
+}
+
+std::vector<BotAction> search(const Game& game, unsigned player_id, Rng& rng,
+                              const SearchOptions& options)
+{
+    const auto deadline = std::chrono::steady_clock::now() + options.budget;
+
+    const std::vector<Strategy> strategies(game.num_players(), cautious_strategy());
+    SimulationOptions playout;
+    playout.max_laps = options.playout_laps;
+
+    Node root{{}, legal_actions(game, player_id)};
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        Game state = game;
+        std::vector<Node*> path = {&root};
+        Node* node = &root;
+        unsigned depth = 0;
+
+        // Selection
+        while (node->untried.empty() && !node->children.empty()) {
+            node = select(*node);
+            node->action.apply(state, player_id);
+            path.push_back(node);
+            ++depth;
+        }
+
+        // Expansion. Passing, or running out of actions, ends the move.
+        if (!node->untried.empty()) {
+            const auto i = std::uniform_int_distribution<std::size_t>{
+                0, node->untried.size() - 1}(rng);
+            const BotAction action = node->untried[i];
+            node->untried.erase(node->untried.begin() + i);
+
+            action.apply(state, player_id);
+            ++depth;
+            const bool ends_move = action.type == BotAction::Type::pass
+                                   || depth >= options.max_actions;
+            node->children.push_back(std::make_unique<Node>(
+                action, ends_move ? std::vector<BotAction>{} : legal_actions(state, player_id)));
+            node = node->children.back().get();
+            path.push_back(node);
+        }
+
+        // Playout and backpropagation
+        const double reward = score(simulate_game(state, strategies, rng, playout), player_id);
+        for (Node* n : path) {
+            ++n->visits;
+            n->reward += reward;
+        }
+    }
+
+    // Follow the most visited children until the move ends
+    std::vector<BotAction> actions;
+    const Node* node = &root;
+    while (!node->children.empty()) {
+        const auto it = std::max_element(
+            node->children.begin(), node->children.end(),
+            [](const auto& a, const auto& b) { return a->visits < b->visits; });
+        node = it->get();
+        if (node->action.type == BotAction::Type::pass) break;
+        actions.push_back(node->action);
+    }
+    return actions;
+}
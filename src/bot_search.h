@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "game.h"
+#include "simulation.h"
+
+// Monte Carlo tree search over the actions a bot player can take. A move is a
+// short sequence of actions ending in a pass. Each node of the tree is a copy
+// of the Game with the actions so far applied, and is scored by playing the
+// game on a few laps with the headless simulator.
+
+// A single action a bot can take, applied through the mutators in game.cpp
+struct BotAction {
+    enum class Type {
+        pass, buy_property, mortgage, unmortgage, build_houses, sell_houses,
+        take_out_secured_debt, take_out_unsecured_debt,
+        pay_off_secured_debt, pay_off_unsecured_debt,
+    };
+
+    Type type = Type::pass;
+    unsigned property = 0;
+    PropertySet set = 0;
+    int amount = 0;
+
+    Result check(const Game&, unsigned player) const;
+    Result apply(Game&, unsigned player) const;
+};
+
+// Every action the player could take right now, checked with the can_*
+// functions. Always includes passing.
+std::vector<BotAction> legal_actions(const Game&, unsigned player);
+
+struct SearchOptions {
+    std::chrono::milliseconds budget{500};
+    // Most actions in one move, not counting the pass
+    unsigned max_actions = 3;
+    // How far ahead each playout looks
+    unsigned playout_laps = 2;
+};
+
+// The best sequence of actions found within the time budget, not including
+// the final pass. Empty if doing nothing is best.
+std::vector<BotAction> search(const Game&, unsigned player, Rng&, const SearchOptions& = {});
@@ -0,0 +1,273 @@
+#include "chat_log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <stdexcept>
+
+#include "memory_usage.h"
+
+ChatLog::ChatLog(const std::string& path)
+    : path_{path}
+{
+    if (path_.empty()) return;
+    this->load();
+    file_.open(path_, std::ios::app);
+}
+
+void ChatLog::load()
+{
+    std::ifstream in(path_);
+    if (!in) return;
+
+    std::uint64_t lines = 0;
+    for (std::string line; std::getline(in, line);) ++lines;
+    in.close();
+    if (lines > roll_over_above) this->roll_over(lines);
+    in.open(path_);
+
+    // Only the segment still being filled is kept in memory, everything
+    // before it is read back from the file when asked for
+    std::uint64_t count = 0;
+    std::uint64_t offset = 0;
+    std::vector<std::string> tail;
+    for (std::string line; count < capacity && std::getline(in, line); ++count) {
+        if (count % segment_size == 0) {
+            offsets_[count / segment_size] = offset;
+            tail.clear();
+        }
+        offset += line.size() + 1;
+        tail.push_back(std::move(line));
+    }
+
+    const std::size_t full_segments = count / segment_size;
+    for (std::size_t s = 0; s < full_segments; ++s) spilled_[s] = true;
+    next_spill_ = full_segments;
+
+    if (count % segment_size != 0) {
+        auto segment = std::make_shared<Segment>();
+        for (std::size_t i = 0; i < tail.size(); ++i) {
+            live_text_bytes_ += heap_usage(tail[i]);
+            segment->slots[i].text = std::move(tail[i]);
+            segment->slots[i].filled = true;
+        }
+        live_[full_segments] = std::move(segment);
+    }
+
+    reserved_ = count;
+    published_ = count;
+    persisted_ = count;
+    file_bytes_ = std::filesystem::file_size(path_);
+}
+
+void ChatLog::roll_over(std::uint64_t lines)
+{
+    // Everything stays in the old file, only the most recent lines are
+    // copied to start the new one
+    const std::string old_path = path_ + ".1";
+    std::filesystem::rename(path_, old_path);
+
+    std::ifstream in(old_path);
+    std::ofstream out(path_);
+    std::uint64_t index = 0;
+    for (std::string line; std::getline(in, line); ++index) {
+        if (index + kept_on_roll_over >= lines) out << line << '\n';
+    }
+    if (!out.flush()) throw std::runtime_error("Failed to roll over chat log " + path_);
+}
+
+std::optional<std::uint64_t> ChatLog::append(std::string text)
+{
+    const std::uint64_t index = reserved_.fetch_add(1);
+    if (index >= capacity) return {};
+
+    std::replace_if(text.begin(), text.end(), [](char c) { return c == '\n' || c == '\r'; },
+                    ' ');
+
+    const auto segment = this->allocate(index);
+    Slot& slot = segment->slots[index % segment_size];
+    live_text_bytes_ += heap_usage(text);
+    slot.text = std::move(text);
+    // Sequentially consistent, as are the loads in publish, so that of two
+    // threads filling neighbouring slots at least one sees both filled
+    slot.filled.store(true);
+
+    this->publish();
+    if (this->persistent()) this->persist();
+    return index;
+}
+
+std::shared_ptr<ChatLog::Segment> ChatLog::allocate(std::uint64_t index)
+{
+    auto* pointer = &live_[index / segment_size];
+    auto segment = std::atomic_load(pointer);
+    if (!segment) {
+        // Several threads may race to allocate the same segment, only one
+        // wins, and the others get the winner's
+        auto fresh = std::make_shared<Segment>();
+        if (std::atomic_compare_exchange_strong(pointer, &segment, fresh)) segment = fresh;
+    }
+    return segment;
+}
+
+bool ChatLog::filled(std::uint64_t index) const
+{
+    // The slot's segment may not even be allocated yet
+    const auto segment = std::atomic_load(&live_[index / segment_size]);
+    return segment && segment->slots[index % segment_size].filled.load();
+}
+
+void ChatLog::publish()
+{
+    // Move past every filled slot. Threads that append at the same time help
+    // each other along, and whoever fills the slot holding everyone up
+    // publishes the ones behind it too. Whoever publishes the last slot of a
+    // segment packs it.
+    std::uint64_t published = published_.load();
+    while (published < std::min(reserved_.load(), capacity) && this->filled(published)) {
+        if (published_.compare_exchange_weak(published, published + 1)) {
+            ++published;
+            if (published % segment_size == 0) this->pack(published / segment_size - 1);
+        }
+    }
+}
+
+void ChatLog::pack(std::size_t segment)
+{
+    const auto live = std::atomic_load(&live_[segment]);
+    assert(live);
+
+    auto block = std::make_shared<Block>();
+    std::size_t text_bytes = 0;
+    std::size_t length = 0;
+    for (const auto& slot : live->slots) length += slot.text.size();
+    block->text.reserve(length);
+    block->ends.reserve(segment_size);
+    for (const auto& slot : live->slots) {
+        text_bytes += heap_usage(slot.text);
+        block->text += slot.text;
+        block->ends.push_back(block->text.size());
+    }
+
+    // Published before the live segment is dropped, so a reader always finds
+    // one or the other
+    packed_bytes_ += heap_usage(block->text) + heap_usage(block->ends);
+    std::atomic_store(&packed_[segment], std::shared_ptr<const Block>(std::move(block)));
+    std::atomic_store(&live_[segment], std::shared_ptr<Segment>());
+    live_text_bytes_ -= text_bytes;
+
+    if (this->persistent()) this->spill();
+}
+
+void ChatLog::persist()
+{
+    // A thread that publishes a message while another is writing leaves it
+    // to the writer, so the writer looks at size() again after letting go.
+    // Both flag operations are sequentially consistent, like the publishing
+    // of messages: with weaker ones the writer could read size() from before
+    // the message was published while the publisher still saw the flag set,
+    // and the message wouldn't be written until the next one was.
+    while (persisted_.load() < this->size()) {
+        if (writing_.test_and_set()) return;
+
+        const auto page = this->read(persisted_.load(), this->size());
+        for (std::uint64_t i = page.first; i < page.end(); ++i) {
+            if (i % segment_size == 0) offsets_[i / segment_size] = file_bytes_;
+            const auto& text = page.messages[i - page.first];
+            file_ << text << '\n';
+            file_bytes_ += text.size() + 1;
+        }
+        file_.flush();
+        persisted_ = page.end();
+
+        writing_.clear();
+        this->spill();
+    }
+}
+
+void ChatLog::spill()
+{
+    // Drops the oldest packed segment while there are more than enough of
+    // them, and it has been written out
+    for (;;) {
+        std::size_t segment = next_spill_.load();
+        if (segment + resident_segments >= this->size() / segment_size) return;
+        if (persisted_.load() < (segment + 1) * segment_size) return;
+
+        const auto packed = std::atomic_load(&packed_[segment]);
+        if (!packed) return;  // Not quite packed yet, left for next time
+        if (!next_spill_.compare_exchange_strong(segment, segment + 1)) continue;
+
+        // Marked before the packed segment is dropped, so a reader always
+        // finds one or the other
+        spilled_[segment] = true;
+        std::atomic_store(&packed_[segment], std::shared_ptr<const Block>());
+        packed_bytes_ -= heap_usage(packed->text) + heap_usage(packed->ends);
+    }
+}
+
+ChatLog::Page ChatLog::read(std::uint64_t first, std::uint64_t last) const
+{
+    last = std::min(last, this->size());
+    Page page{first, {}};
+    if (first >= last) return page;
+
+    page.messages.reserve(last - first);
+    for (std::size_t s = first / segment_size; s <= (last - 1) / segment_size; ++s) {
+        this->read_segment(s, std::max<std::uint64_t>(first, s * segment_size),
+                           std::min<std::uint64_t>(last, (s + 1) * segment_size),
+                           page.messages);
+    }
+    return page;
+}
+
+ChatLog::Page ChatLog::page_before(std::uint64_t end, std::size_t count) const
+{
+    end = std::min(end, this->size());
+    return this->read(end - std::min<std::uint64_t>(end, count), end);
+}
+
+void ChatLog::read_segment(std::size_t segment, std::uint64_t first, std::uint64_t last,
+                           std::vector<std::string>& messages) const
+{
+    const std::uint64_t start = segment * segment_size;
+
+    // A segment moves from live to packed to spilled, and is always put in
+    // its next place before it's taken from the last, so looking again in
+    // the same order finds it if it moved while looking
+    for (;;) {
+        if (const auto block = std::atomic_load(&packed_[segment])) {
+            for (auto i = first - start; i < last - start; ++i) {
+                const std::uint32_t begin = i == 0 ? 0 : block->ends[i - 1];
+                messages.push_back(block->text.substr(begin, block->ends[i] - begin));
+            }
+            return;
+        }
+        if (const auto live = std::atomic_load(&live_[segment])) {
+            for (auto i = first - start; i < last - start; ++i) {
+                messages.push_back(live->slots[i].text);
+            }
+            return;
+        }
+        if (spilled_[segment].load()) {
+            // Every reader opens a stream of its own, so reading never waits
+            std::ifstream in(path_);
+            in.seekg(offsets_[segment].load());
+            std::string line;
+            for (auto i = start; i < last && std::getline(in, line); ++i) {
+                if (i >= first) messages.push_back(line);
+            }
+            return;
+        }
+    }
+}
+
+std::size_t ChatLog::memory_usage() const noexcept
+{
+    std::size_t bytes = sizeof(ChatLog) + live_text_bytes_.load() + packed_bytes_.load();
+    for (std::size_t s = 0; s < max_segments; ++s) {
+        if (std::atomic_load(&live_[s])) bytes += sizeof(Segment);
+        if (std::atomic_load(&packed_[s])) bytes += sizeof(Block);
+    }
+    return bytes;
+}
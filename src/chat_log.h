@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Every line shown in a game's message box, chat and notifications alike, in
+// order, kept apart from the game so that chatting never waits on the game's
+// lock or holds it up.
+//
+// Any number of threads can append and read at once. An append reserves the
+// next index, fills in its slot, then publishes every filled slot up to the
+// first that isn't filled yet; messages are only ever read below size(), so a
+// reader never sees a half written one.
+//
+// Messages are kept in segments. Once a segment is full it's packed into a
+// single buffer, and if the log is saved to a file, all but the most recent
+// few packed segments are dropped from memory and read back from the file
+// when asked for. Segments are swapped with atomic shared_ptr operations, so
+// a reader holds on to whatever segment it found and never waits on a writer
+// for more than copying a pointer.
+//
+// If given a path, every message is appended to that file, and whatever the
+// file already held is loaded first. Whichever appending thread finds nobody
+// else writing writes out everything published so far, so appends are only
+// ever held up by their own writes.
+//
+// The log holds at most capacity messages, after which appends fail. A file
+// more than half full when loaded is rolled over first: it's moved to the
+// same path with ".1" added, replacing any file there, and only its most
+// recent messages are kept, so a saved log never fills up for good.
+struct ChatLog {
+    static constexpr std::size_t segment_size = 1024;
+    static constexpr std::size_t max_segments = 1024;
+    static constexpr std::uint64_t capacity = segment_size * max_segments;
+    // Loading a file with more messages than this rolls it over, keeping
+    // kept_on_roll_over of them
+    static constexpr std::uint64_t roll_over_above = capacity / 2;
+    static constexpr std::uint64_t kept_on_roll_over = capacity / 8;
+    // Packed segments kept in memory when they can be read back from the file
+    static constexpr std::size_t resident_segments = 4;
+
+    explicit ChatLog(const std::string& path = {});
+    ChatLog(const ChatLog&) = delete;
+    ChatLog& operator=(const ChatLog&) = delete;
+
+    // Returns the index of the message, or nothing if the log is full. Line
+    // breaks are replaced with spaces.
+    std::optional<std::uint64_t> append(std::string text);
+
+    // Number of messages published, every one of which can be read
+    std::uint64_t size() const noexcept { return published_.load(); }
+
+    // Consecutive messages, starting at index first
+    struct Page {
+        std::uint64_t first = 0;
+        std::vector<std::string> messages;
+
+        std::uint64_t end() const noexcept { return first + messages.size(); }
+    };
+
+    // Messages first up to but not including last, of those published
+    Page read(std::uint64_t first, std::uint64_t last) const;
+
+    // Up to count messages just before the one at index end
+    Page page_before(std::uint64_t end, std::size_t count) const;
+
+    // Whether messages are saved to a file
+    bool persistent() const noexcept { return file_.is_open(); }
+
+    std::size_t memory_usage() const noexcept;
+private:
+    struct Slot {
+        std::string text;
+        std::atomic<bool> filled{false};
+    };
+    struct Segment {
+        std::array<Slot, segment_size> slots;
+    };
+    // A full segment, packed
+    struct Block {
+        std::string text;
+        // Where each message ends in text
+        std::vector<std::uint32_t> ends;
+    };
+
+    void load();
+    void roll_over(std::uint64_t lines);
+    std::shared_ptr<Segment> allocate(std::uint64_t index);
+    bool filled(std::uint64_t index) const;
+    void publish();
+    void pack(std::size_t segment);
+    void persist();
+    void spill();
+    void read_segment(std::size_t segment, std::uint64_t first, std::uint64_t last,
+                      std::vector<std::string>& messages) const;
+
+    // Only ever accessed with std::atomic_load and friends. A segment is
+    // live until full, then packed, then perhaps spilled to the file.
+    std::array<std::shared_ptr<Segment>, max_segments> live_ = {};
+    std::array<std::shared_ptr<const Block>, max_segments> packed_ = {};
+    std::array<std::atomic<bool>, max_segments> spilled_ = {};
+    // Where in the file each segment starts, once written
+    std::array<std::atomic<std::uint64_t>, max_segments> offsets_ = {};
+
+    std::atomic<std::uint64_t> reserved_{0};
+    std::atomic<std::uint64_t> published_{0};
+    std::atomic<std::size_t> next_spill_{0};
+    std::atomic<std::size_t> live_text_bytes_{0};
+    std::atomic<std::size_t> packed_bytes_{0};
+
+    std::string path_;
+    std::ofstream file_;
+    std::atomic_flag writing_ = ATOMIC_FLAG_INIT;
+    std::atomic<std::uint64_t> persisted_{0};
+    // Only used while writing
+    std::uint64_t file_bytes_ = 0;
+};
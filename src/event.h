@@ -38,6 +38,21 @@ struct AddPlayerEvent {
     unsigned player_id;
 };
 
+// Sent when background analysis of the game (such as bankruptcy risk) has
+// new results to show
+struct AnalysisEvent {
+};
+
+// Sent when the auction running in the game has changed, at most once a
+// scheduler tick however many bids come in
+struct AuctionEvent {
+};
+
+// Sent when a trade has been offered, countered, accepted or turned down.
+// Trades that go through are sent as a GameEvent too.
+struct TradeEvent {
+};
+
 struct GameEvent {
     using Function = std::function<Result(Game&)>;
 
@@ -52,9 +67,10 @@ private:
 
 struct Event {
     using Data = std::variant<MessageEvent, NotificationEvent, GameEvent,
-                              AddPlayerEvent, UndoEvent, RedoEvent>;
+                              AddPlayerEvent, UndoEvent, RedoEvent, AnalysisEvent,
+                              AuctionEvent, TradeEvent>;
     enum class Type {
-        message, notification, game, add_player, undo, redo
+        message, notification, game, add_player, undo, redo, analysis, auction, trade
     };
 
     Event(Data&& data)
@@ -79,6 +95,13 @@ struct Event {
         return std::get<T>(data_);
     }
 
+    // The line shown in the message log, for events that show one
+    const std::string* text() const noexcept {
+        if (const auto* e = std::get_if<MessageEvent>(&data_)) return &e->text;
+        if (const auto* e = std::get_if<NotificationEvent>(&data_)) return &e->text;
+        return nullptr;
+    }
+
     // Generates a higher level description of an event, useful for logging
     std::string description() const {
         struct {
@@ -100,6 +123,15 @@ struct Event {
             std::string operator()(const AddPlayerEvent& e) {
                 return "Add player: " + e.name;
             }
+            std::string operator()(const AnalysisEvent&) {
+                return "Analysis updated";
+            }
+            std::string operator()(const AuctionEvent&) {
+                return "Auction updated";
+            }
+            std::string operator()(const TradeEvent&) {
+                return "Trades updated";
+            }
         } v;
         return std::visit(v, data_);
     }
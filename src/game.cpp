@@ -1,4 +1,8 @@
 #include "game.h"
+#include "board.h"
+#include "memory_usage.h"
+
+#include <stdexcept>
 
 const PropertySet PropertySet::brown   = 0b0000000000000000000000000011;
 const PropertySet PropertySet::lblue   = 0b0000000000000000000000011100;
@@ -11,121 +15,286 @@ const PropertySet PropertySet::dblue   = 0b0000001100000000000000000000;
 const PropertySet PropertySet::station = 0b0011110000000000000000000000;
 const PropertySet PropertySet::utility = 0b1100000000000000000000000000;
 
+// Rulesets -------------------------------------------------------------------
+
+namespace {
+    constexpr std::uint8_t no_property = 0xff;
+}
+
+template <std::size_t N>
+BasicRuleset<N>::BasicRuleset(std::string name, std::array<PropertyInfo, N> properties,
+                              Rules rules)
+    : name_{std::move(name)}, rules_{rules}, properties_(std::move(properties))
+{
+    for (unsigned id = 0; id < N; ++id) {
+        auto& info = properties_[id];
+        assert(info.set.test(id));
+        info.set_leader = property_id(info.set);
+        info.set_size = info.set.count();
+        stations_.set(id, info.kind == PropertyKind::station);
+        utilities_.set(id, info.kind == PropertyKind::utility);
+    }
+
+    // Kept at most half full
+    std::size_t size = 8;
+    while (size < 2 * N) size *= 2;
+    property_index_.assign(size, no_property);
+
+    const std::size_t mask = size - 1;
+    for (unsigned id = 0; id < N; ++id) {
+        std::size_t slot = std::hash<std::string_view>{}(properties_[id].name) & mask;
+        while (property_index_[slot] != no_property) slot = (slot + 1) & mask;
+        property_index_[slot] = id;
+    }
+}
+
+template <std::size_t N>
+std::optional<unsigned> BasicRuleset<N>::find_property(std::string_view name) const noexcept
+{
+    const std::size_t mask = property_index_.size() - 1;
+    for (std::size_t slot = std::hash<std::string_view>{}(name) & mask;;
+         slot = (slot + 1) & mask) {
+        const std::uint8_t id = property_index_[slot];
+        if (id == no_property) return {};
+        if (properties_[id].name == name) return id;
+    }
+}
+
+// The standard board ---------------------------------------------------------
+
+const Ruleset& standard_ruleset()
+{
+    static const Ruleset ruleset = [] {
+        std::array<PropertyInfo, num_standard_properties> properties = {{
+            {"Old Kent Road",         60,  50,  PropertySet::brown,   {{2,  10, 30,  90,  160, 250}}},
+            {"Whitechapel Road",      60,  50,  PropertySet::brown,   {{4,  20, 60,  180, 360, 450}}},
+
+            {"The Angel Islington",   100, 50,  PropertySet::lblue,   {{6,  30, 90,  270, 400, 550}}},
+            {"Euston Road",           100, 50,  PropertySet::lblue,   {{6,  30, 90,  270, 400, 550}}},
+            {"Pentonville Road",      120, 50,  PropertySet::lblue,   {{8,  40, 100, 300, 450, 600}}},
+
+            {"Pall Mall",             140, 100, PropertySet::pink,    {{10, 50, 150, 450, 625, 750}}},
+            {"Whitehall",             140, 100, PropertySet::pink,    {{10, 50, 150, 450, 625, 750}}},
+            {"Northumberland Avenue", 160, 100, PropertySet::pink,    {{12, 60, 180, 500, 700, 900}}},
+
+            {"Bow Street",            140, 100, PropertySet::orange,  {{10, 50, 150, 450, 625, 750}}},
+            {"Marlborough Street",    140, 100, PropertySet::orange,  {{10, 50, 150, 450, 625, 750}}},
+            {"Vine Street",           160, 100, PropertySet::orange,  {{12, 60, 180, 500, 700, 900}}},
+
+            {"Strand",                140, 100, PropertySet::red,     {{10, 50, 150, 450, 625, 750}}},
+            {"Fleet Street",          140, 100, PropertySet::red,     {{10, 50, 150, 450, 625, 750}}},
+            {"Trafalgar Square",      160, 100, PropertySet::red,     {{12, 60, 180, 500, 700, 900}}},
+
+            {"Leicester Square",      140, 100, PropertySet::yellow,  {{10, 50, 150, 450, 625, 750}}},
+            {"Coventry Street",       140, 100, PropertySet::yellow,  {{10, 50, 150, 450, 625, 750}}},
+            {"Piccadiliy",            160, 100, PropertySet::yellow,  {{12, 60, 180, 500, 700, 900}}},
+
+            {"Regent Street",         140, 100, PropertySet::green,   {{10, 50, 150, 450, 625, 750}}},
+            {"Oxford Street",         140, 100, PropertySet::green,   {{10, 50, 150, 450, 625, 750}}},
+            {"Bond Street",           160, 100, PropertySet::green,   {{12, 60, 180, 500, 700, 900}}},
+
+            {"Park lane",             140, 100, PropertySet::dblue,   {{10, 50, 150, 450, 625, 750}}},
+            {"Mayfair",               160, 100, PropertySet::dblue,   {{12, 60, 180, 500, 700, 900}}},
+
+            {"Kings Cross Station",   200, 0,   PropertySet::station, {{25, 50, 100, 200, 0,   0  }}, PropertyKind::station},
+            {"Marylebone Station",    200, 0,   PropertySet::station, {{25, 50, 100, 200, 0,   0  }}, PropertyKind::station},
+            {"Fenchurch St. Station", 200, 0,   PropertySet::station, {{25, 50, 100, 200, 0,   0  }}, PropertyKind::station},
+            {"Liverpool St. Station", 200, 0,   PropertySet::station, {{25, 50, 100, 200, 0,   0  }}, PropertyKind::station},
+
+            {"Electric Company",      150, 0,   PropertySet::utility, {{10, 50, 150, 450, 625, 750}}, PropertyKind::utility},
+            {"Water Works",           150, 0,   PropertySet::utility, {{12, 60, 180, 500, 700, 900}}, PropertyKind::utility},
+        }};
+        for (unsigned id = 0; id < properties.size(); ++id) {
+            properties[id].landing_weight = landing_weights()[id];
+        }
+        return Ruleset{"Standard", std::move(properties)};
+    }();
+    return ruleset;
+}
+
+// Rules ----------------------------------------------------------------------
+
+std::optional<Ratio> Ratio::parse(const std::string& text)
+{
+    std::int64_t raw = 0;
+    int places = -1;
+    for (const char c : text) {
+        if (c == '.' && places < 0) {
+            places = 0;
+        } else if (c >= '0' && c <= '9' && places < 4 && raw < (std::int64_t(1) << 40)) {
+            raw = raw * 10 + (c - '0');
+            if (places >= 0) ++places;
+        } else {
+            return {};
+        }
+    }
+    if (text.empty() || text == ".") return {};
+
+    for (int i = std::max(places, 0); i < 4; ++i) raw *= 10;
+    return from_raw(raw);
+}
+
+std::string Ratio::to_string() const
+{
+    std::string fraction = std::to_string(raw_ % scale + scale).substr(1);
+    while (!fraction.empty() && fraction.back() == '0') fraction.pop_back();
+
+    std::string text = std::to_string(raw_ / scale);
+    if (!fraction.empty()) text += "." + fraction;
+    return text;
+}
+
+bool set_rule(Rules& rules, const std::string& name, const std::string& value)
+{
+    if (name == "ppi_memory" || name == "unmortgage_factor") {
+        const auto ratio = Ratio::parse(value);
+        if (!ratio) return false;
+        (name == "ppi_memory" ? rules.ppi_memory : rules.unmortgage_factor) = *ratio;
+        return true;
+    }
+
+    try {
+        std::size_t end = 0;
+        if (name == "starting_secured_interest") {
+            rules.starting_secured_interest = std::stoi(value, &end);
+        } else if (name == "starting_unsecured_interest") {
+            rules.starting_unsecured_interest = std::stoi(value, &end);
+        } else if (name == "max_unsecured_debt") {
+            rules.max_unsecured_debt = std::stoi(value, &end);
+        } else if (name == "secured_debt_salaries") {
+            rules.secured_debt_salaries = std::stoi(value, &end);
+        } else {
+            return false;
+        }
+        return end == value.size();
+    } catch (std::logic_error&) {
+        return false;
+    }
+}
+
 // Information functions ------------------------------------------------------
 
-int expected_rent(const Property& p, const Game& g) noexcept {
+template <std::size_t N>
+int rent(const BasicProperty<N>& p, const BasicGame<N>& g, int dice_total) noexcept {
     if (p.mortgaged()) return 0;
 
     const unsigned number_owned_in_set = [&p, &g]() -> unsigned {
         if (p.owner_id) {
             const auto& owner = g.player(*p.owner_id);
-            return (owner.properties & p.set).count();
+            return owner.totals().owned_in_set[p.info().set_leader];
         }
         return 0;
     }();
 
     if (number_owned_in_set == 0) return 0;
 
-    if (p.set == PropertySet::station) {
+    if (p.kind() == PropertyKind::station) {
         assert(number_owned_in_set >= 1 && number_owned_in_set <= 4);
-        return p.rents[number_owned_in_set-1];
+        return p.rents()[number_owned_in_set-1];
     }
 
-    if (p.set == PropertySet::utility) {
+    if (p.kind() == PropertyKind::utility) {
         assert(number_owned_in_set >= 1 && number_owned_in_set <= 2);
-        return 7 * p.rents[number_owned_in_set-1];
+        return dice_total * p.rents()[number_owned_in_set-1];
     }
 
     // OK, so must be a normal property
 
-    const bool owns_all_of_set = number_owned_in_set == p.set.count();
+    const bool owns_all_of_set = number_owned_in_set == p.info().set_size;
     const int multiplier = (p.houses == 0 && owns_all_of_set) ? 2 : 1;
 
-    return p.rents[p.houses] * multiplier;
+    return p.rents()[p.houses] * multiplier;
 }
 
-int asset_value(const Player& p, const Game& g) noexcept
+template <std::size_t N>
+int expected_rent(const BasicProperty<N>& p, const BasicGame<N>& g) noexcept {
+    // 7 is the most likely, and the mean, total of two dice
+    return rent(p, g, 7);
+}
+
+template <std::size_t N>
+int asset_value(const BasicPlayer<N>& p, const BasicGame<N>& g) noexcept
 {
-    int sum = 0;
-    for (int i = 0; i < 28; ++i) {
-        sum += static_cast<int>(p.properties[i]) * g.properties[i].guide_price;
-    }
-    return sum * g.ppi;
+    return p.totals().guide_price * g.ppi;
 }
 
-int expected_income(const Player& player, const Game& game) noexcept
+// Rent from each property is weighted by how often it is actually landed on,
+// relative to a square picked uniformly at random
+template <std::size_t N>
+int expected_income(const BasicPlayer<N>& player, const BasicGame<N>&) noexcept
 {
-    int sum = 0;
-    for (int i = 0; i < 28; ++i) {
-        if (player.properties[i]) {
-            sum += expected_rent(game.properties[i], game);
-        }
-    }
-    return sum;
+    return player.totals().weighted_income / landing_weight_scale;
 }
 
-int interest_to_pay(const Player& p, const Game& g) noexcept
+template <std::size_t N>
+int interest_to_pay(const BasicPlayer<N>& p, const BasicGame<N>& g) noexcept
 {
-    return p.secured_debt * g.secured_interest() / 100.0 +
-           p.unsecured_debt * g.unsecured_interest() / 100.0;
+    return (p.secured_debt * g.secured_interest() + p.unsecured_debt * g.unsecured_interest()) / 100;
 }
 
-int max_secured_debt(const Player& p, const Game& g) noexcept {
-    return 5 * p.salary + std::min(3 * expected_income(p, g), asset_value(p, g));
+template <std::size_t N>
+int max_secured_debt(const BasicPlayer<N>& p, const BasicGame<N>& g) noexcept {
+    return g.rules().secured_debt_salaries * p.salary
+           + std::min(3 * expected_income(p, g), asset_value(p, g));
 }
 
-int max_unsecured_debt(const Player&, const Game&) noexcept {
-    return 200;
+template <std::size_t N>
+int max_unsecured_debt(const BasicPlayer<N>&, const BasicGame<N>& g) noexcept {
+    return g.rules().max_unsecured_debt;
 }
 
 // Checking functions ---------------------------------------------------------
 
 #define CHECK_PLAYER_OWNS_PROPERTY(player_id, property_id)                                        \
     if (game.properties[property_id].owner_id != player_id) {                                     \
-        return {false, "Property is not owned by player_id"};                                     \
+        return {false, Result::Code::property_not_owned, {player_id, 0, property_id}};            \
     }                                                                                             \
                                                                                                   \
     assert(game.player(player_id).properties[property_id] == true)
 
 #define CHECK_PLAYER_ID_IN_RANGE(player_id) assert(player_id < game.num_players())
 
-#define CHECK_PROPERTY_ID_IN_RANGE(property_id) assert(property_id < 28);
+#define CHECK_PROPERTY_ID_IN_RANGE(property_id) assert(property_id < N);
 
 #define CHECK_PLAYER_HAS_CASH(player_id, amount)                                                  \
     if (amount > game.player(player_id).cash) {                                                   \
-        return {false, game.player(player_id).name + " doesn't have enough cash"};                \
+        return {false, Result::Code::not_enough_cash, {player_id}};                               \
     }
 
-Result can_raise_interest(const Game&)
+template <std::size_t N>
+Result can_raise_interest(const BasicGame<N>&)
 {
     return true;
 }
 
-Result can_lower_interest(const Game&)
+template <std::size_t N>
+Result can_lower_interest(const BasicGame<N>&)
 {
     return true;
 }
 
-Result can_passgo(const Game& game, unsigned player_id)
+template <std::size_t N>
+Result can_passgo(const BasicGame<N>& game, unsigned player_id)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
 
     if (game.player(player_id).cash + game.player(player_id).salary <
         interest_to_pay(game.player(player_id), game)) {
-        return {false, "Not enough funds to pay interest"};
+        return {false, Result::Code::cannot_pay_interest, {player_id}};
     }
 
     return true;
 }
 
-Result can_buy_property(const Game& game, unsigned player_id, unsigned property_id, int price)
+template <std::size_t N>
+Result can_buy_property(const BasicGame<N>& game, unsigned player_id, unsigned property_id, int price)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     CHECK_PROPERTY_ID_IN_RANGE(property_id);
     assert(price >= 0);
 
     if (game.properties[property_id].owner_id) {
-        return {false, "Property not available"};
+        return {false, Result::Code::property_not_available, {player_id, 0, property_id}};
     }
 
     CHECK_PLAYER_HAS_CASH(player_id, price);
@@ -133,7 +302,8 @@ Result can_buy_property(const Game& game, unsigned player_id, unsigned property_
     return true;
 }
 
-Result can_sell_property(const Game& game, unsigned player_id, unsigned property_id)
+template <std::size_t N>
+Result can_sell_property(const BasicGame<N>& game, unsigned player_id, unsigned property_id)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     CHECK_PROPERTY_ID_IN_RANGE(property_id);
@@ -143,7 +313,8 @@ Result can_sell_property(const Game& game, unsigned player_id, unsigned property
     return true;
 }
 
-Result can_mortgage(const Game& game, unsigned player_id, unsigned property_id)
+template <std::size_t N>
+Result can_mortgage(const BasicGame<N>& game, unsigned player_id, unsigned property_id)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     CHECK_PROPERTY_ID_IN_RANGE(property_id);
@@ -151,13 +322,14 @@ Result can_mortgage(const Game& game, unsigned player_id, unsigned property_id)
     CHECK_PLAYER_OWNS_PROPERTY(player_id, property_id);
 
     if (game.properties[property_id].mortgaged()) {
-        return {false, "Property is already mortgaged"};
+        return {false, Result::Code::already_mortgaged, {player_id, 0, property_id}};
     }
 
     return true;
 }
 
-Result can_unmortgage(const Game& game, unsigned player_id, unsigned property_id)
+template <std::size_t N>
+Result can_unmortgage(const BasicGame<N>& game, unsigned player_id, unsigned property_id)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     CHECK_PROPERTY_ID_IN_RANGE(property_id);
@@ -165,26 +337,32 @@ Result can_unmortgage(const Game& game, unsigned player_id, unsigned property_id
     CHECK_PLAYER_OWNS_PROPERTY(player_id, property_id);
 
     if (!game.properties[property_id].mortgaged()) {
-        return {false, "Cannot unmortgage - property_id is not mortgaged"};
+        return {false, Result::Code::not_mortgaged, {player_id, 0, property_id}};
     }
 
-    const int to_pay = game.properties[property_id].mortgage_amount() * 1.1;
+    const int to_pay = game.properties[property_id].mortgage_amount()
+                       * game.rules().unmortgage_factor;
     CHECK_PLAYER_HAS_CASH(player_id, to_pay);
 
     return true;
 }
 
-Result can_build_houses(const Game& game, unsigned player_id, PropertySet set, int number)
+template <std::size_t N>
+Result can_build_houses(const BasicGame<N>& game, unsigned player_id, PropertySetOf<N> set, int number)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     assert(number >= 0);
 
-    if ((set | PropertySet::station) != 0) {
-        return {false, "Can't build on stations"};
+    if (set.none()) {
+        return {false, Result::Code::no_properties_selected};
     }
 
-    if ((set | PropertySet::utility) != 0) {
-        return {false, "Can't build on utilities"};
+    if ((set & game.stations()).any()) {
+        return {false, Result::Code::cannot_build_on_stations};
+    }
+
+    if ((set & game.utilities()).any()) {
+        return {false, Result::Code::cannot_build_on_utilities};
     }
 
     /*
@@ -194,25 +372,25 @@ Result can_build_houses(const Game& game, unsigned player_id, PropertySet set, i
     */
 
     if ((game.player(player_id).properties & set) != set) {
-        return {false, game.player(player_id).name + " doesn't own all properties in set"};
+        return {false, Result::Code::set_not_owned, {player_id, 0, 0, 0, 0, set}};
     }
 
-    const int house_price = game.properties[property_id(set)].house_price;
+    const int house_price = game.properties[property_id(set)].house_price();
     CHECK_PLAYER_HAS_CASH(player_id, house_price * number);
 
     const int max_houses = set.count() * 5;
     int houses_sum = 0;
-    for_each_property(set, game, [&houses_sum](const Property& p) { houses_sum += p.houses; });
+    for_each_property(set, game, [&houses_sum](const auto& p) { houses_sum += p.houses; });
     if (houses_sum + number > max_houses) {
-        return {false,
-                std::to_string(houses_sum) + " already built, maximum is " +
-                    std::to_string(max_houses)};
+        return {false, Result::Code::too_many_houses,
+                {player_id, 0, 0, houses_sum, max_houses, set}};
     }
 
     return true;
 }
 
-Result can_sell_houses(const Game& game, unsigned player_id, PropertySet set, int number)
+template <std::size_t N>
+Result can_sell_houses(const BasicGame<N>& game, unsigned player_id, PropertySetOf<N> set, int number)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     assert(number >= 0);
@@ -223,20 +401,25 @@ Result can_sell_houses(const Game& game, unsigned player_id, PropertySet set, in
     }
     */
 
+    if (set.none()) {
+        return {false, Result::Code::no_properties_selected};
+    }
+
     if ((game.player(player_id).properties & set) != set) {
-        return {false, game.player(player_id).name + " doesn't own all properties in set"};
+        return {false, Result::Code::set_not_owned, {player_id, 0, 0, 0, 0, set}};
     }
 
     int houses_sum = 0;
-    for_each_property(set, game, [&houses_sum](const Property& p) { houses_sum += p.houses; });
+    for_each_property(set, game, [&houses_sum](const auto& p) { houses_sum += p.houses; });
     if (houses_sum - number < 0) {
-        return {false, "Can only remove " + std::to_string(houses_sum) + " houses"};
+        return {false, Result::Code::too_few_houses, {player_id, 0, 0, houses_sum, 0, set}};
     }
 
     return true;
 }
 
-Result can_pay_repairs(const Game& game, unsigned player_id, int cost_per_house, int cost_per_hotel)
+template <std::size_t N>
+Result can_pay_repairs(const BasicGame<N>& game, unsigned player_id, int cost_per_house, int cost_per_hotel)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     assert(cost_per_house >= 0);
@@ -244,7 +427,7 @@ Result can_pay_repairs(const Game& game, unsigned player_id, int cost_per_house,
 
     int amount_to_pay = 0;
     for_each_property(game.player(player_id).properties, game,
-                      [&amount_to_pay, cost_per_house, cost_per_hotel](const Property& p) {
+                      [&amount_to_pay, cost_per_house, cost_per_hotel](const auto& p) {
                           if (p.houses == 5) {
                               amount_to_pay += cost_per_hotel;
                           } else {
@@ -256,7 +439,8 @@ Result can_pay_repairs(const Game& game, unsigned player_id, int cost_per_house,
     return true;
 }
 
-Result can_pay_to_bank(const Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result can_pay_to_bank(const BasicGame<N>& game, unsigned player_id, int amount)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     CHECK_PLAYER_HAS_CASH(player_id, amount);
@@ -264,7 +448,8 @@ Result can_pay_to_bank(const Game& game, unsigned player_id, int amount)
     return true;
 }
 
-Result can_pay_to_player(const Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result can_pay_to_player(const BasicGame<N>& game, unsigned player_id, int amount)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     assert(amount >= 0);
@@ -272,23 +457,25 @@ Result can_pay_to_player(const Game& game, unsigned player_id, int amount)
     return true;
 }
 
-Result can_transfer(const Game& game, unsigned from_player_id, unsigned to_player_id, int amount,
-                    PropertySet properties)
+template <std::size_t N>
+Result can_transfer(const BasicGame<N>& game, unsigned from_player_id, unsigned to_player_id, int amount,
+                    PropertySetOf<N> properties)
 {
     CHECK_PLAYER_ID_IN_RANGE(from_player_id);
     CHECK_PLAYER_ID_IN_RANGE(to_player_id);
     assert(amount >= 0);
     
     if ((game.player(from_player_id).properties & properties) != properties) {
-        return {false, game.player(from_player_id).name + " doesn't own all of those properties"};
+        return {false, Result::Code::properties_not_owned,
+                {from_player_id, to_player_id, 0, amount, 0, properties}};
     }
 
     bool houses_on_properties = false;
-    for_each_property(properties, game, [&houses_on_properties](const Property& p) {
+    for_each_property(properties, game, [&houses_on_properties](const auto& p) {
         if (p.houses > 0) houses_on_properties = true;
     });
     if (houses_on_properties) {
-        return {false, "Cannot transfer properties with houses on them"};
+        return {false, Result::Code::houses_on_properties};
     }
 
     CHECK_PLAYER_HAS_CASH(from_player_id, amount);
@@ -296,39 +483,42 @@ Result can_transfer(const Game& game, unsigned from_player_id, unsigned to_playe
     return true;
 }
 
-Result can_take_out_secured_debt(const Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result can_take_out_secured_debt(const BasicGame<N>& game, unsigned player_id, int amount)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     assert(amount >= 0);
 
     if (game.player(player_id).secured_debt + amount >
         max_secured_debt(game.player(player_id), game)) {
-        return {false, game.player(player_id).name + " cannot take out that much secured debt"};
+        return {false, Result::Code::too_much_secured_debt, {player_id, 0, 0, amount}};
     }
 
     return true;
 }
 
-Result can_take_out_unsecured_debt(const Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result can_take_out_unsecured_debt(const BasicGame<N>& game, unsigned player_id, int amount)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     assert(amount >= 0);
 
     if (game.player(player_id).unsecured_debt + amount >
         max_unsecured_debt(game.player(player_id), game)) {
-        return {false, game.player(player_id).name + " cannot take out that much unsecured debt"};
+        return {false, Result::Code::too_much_unsecured_debt, {player_id, 0, 0, amount}};
     }
 
     return true;
 }
 
-Result can_pay_off_secured_debt(const Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result can_pay_off_secured_debt(const BasicGame<N>& game, unsigned player_id, int amount)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     assert(amount >= 0);
 
     if (game.player(player_id).secured_debt < amount) {
-        return {false, "Cannot overpay debt"};
+        return {false, Result::Code::overpaying_debt, {player_id, 0, 0, amount}};
     }
 
     CHECK_PLAYER_HAS_CASH(player_id, amount);
@@ -336,13 +526,14 @@ Result can_pay_off_secured_debt(const Game& game, unsigned player_id, int amount
     return true;
 }
 
-Result can_pay_off_unsecured_debt(const Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result can_pay_off_unsecured_debt(const BasicGame<N>& game, unsigned player_id, int amount)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
     assert(amount >= 0);
 
     if (game.player(player_id).unsecured_debt < amount) {
-        return {false, "Cannot overpay debt"};
+        return {false, Result::Code::overpaying_debt, {player_id, 0, 0, amount}};
     }
 
     CHECK_PLAYER_HAS_CASH(player_id, amount);
@@ -350,24 +541,26 @@ Result can_pay_off_unsecured_debt(const Game& game, unsigned player_id, int amou
     return true;
 }
 
-Result can_concede_to_player(const Game& game, unsigned loser, unsigned victor)
+template <std::size_t N>
+Result can_concede_to_player(const BasicGame<N>& game, unsigned loser, unsigned victor)
 {
     CHECK_PLAYER_ID_IN_RANGE(loser);
     CHECK_PLAYER_ID_IN_RANGE(victor);
 
     bool houses_on_properties = false;
     for_each_property(game.player(loser).properties, game,
-                      [&houses_on_properties](const Property& p) {
+                      [&houses_on_properties](const auto& p) {
                           if (p.houses > 0) houses_on_properties = true;
                       });
     if (houses_on_properties) {
-        return {false, "Cannot transfer properties with houses on them"};
+        return {false, Result::Code::houses_on_properties};
     }
 
     return true;
 }
 
-Result can_concede_to_bank(const Game& game, unsigned player_id)
+template <std::size_t N>
+Result can_concede_to_bank(const BasicGame<N>& game, unsigned player_id)
 {
     CHECK_PLAYER_ID_IN_RANGE(player_id);
 
@@ -377,27 +570,30 @@ Result can_concede_to_bank(const Game& game, unsigned player_id)
 
 // Major functions ------------------------------------------------------------
 
-Result raise_interest(Game& game)
+template <std::size_t N>
+Result raise_interest(BasicGame<N>& game)
 {
     const auto result = can_raise_interest(game);
     if (!result) return result;
 
     game.raise_interest();
 
-    return {true, "Interest rates raised"};
+    return {true, Result::Code::raised_interest};
 }
 
-Result lower_interest(Game& game)
+template <std::size_t N>
+Result lower_interest(BasicGame<N>& game)
 {
     const auto result = can_lower_interest(game);
     if (!result) return result;
 
     game.lower_interest();
 
-    return {true, "Interest rates lowered"};
+    return {true, Result::Code::lowered_interest};
 }
 
-Result passgo(Game& game, unsigned player_id)
+template <std::size_t N>
+Result passgo(BasicGame<N>& game, unsigned player_id)
 {
     const auto result = can_passgo(game, player_id);
     if (!result) return result;
@@ -405,48 +601,49 @@ Result passgo(Game& game, unsigned player_id)
     const int net_gain = game.player(player_id).salary
                          - interest_to_pay(game.player(player_id), game);
     game.player(player_id).cash += net_gain;
+    game.player_changed(player_id);
 
-    return {true,
-            game.player(player_id).name + " passed go, netting £"
-                + std::to_string(net_gain)};
+    return {true, Result::Code::passed_go, {player_id, 0, 0, net_gain}};
 }
 
-Result buy_property(Game& game, unsigned player_id, unsigned property_id, int price)
+template <std::size_t N>
+Result buy_property(BasicGame<N>& game, unsigned player_id, unsigned property_id, int price)
 {
     const auto result = can_buy_property(game, player_id, property_id, price);
     if (!result) return result;
 
     game.properties[property_id].owner_id = player_id;
-    game.player(player_id).properties[property_id] = true;
+    game.player(player_id).properties.set(property_id);
+    game.properties_changed(BasicPropertySet<N>::only(property_id));
 
     game.player(player_id).cash -= price;
+    game.player_changed(player_id);
 
-    game.ppi = update_ppi(game.ppi, price, game.properties[property_id].guide_price);
+    game.ppi = update_ppi(game.ppi, price, game.properties[property_id].guide_price(),
+                          game.rules().ppi_memory);
 
-    return {true,
-            game.player(player_id).name + " bought "
-                + game.properties[property_id].name + " for £"
-                + std::to_string(price)};
+    return {true, Result::Code::bought_property, {player_id, 0, property_id, price}};
 }
 
-Result sell_property(Game& game, unsigned player_id, unsigned property_id)
+template <std::size_t N>
+Result sell_property(BasicGame<N>& game, unsigned player_id, unsigned property_id)
 {
     const auto result = can_sell_property(game, player_id, property_id);
     if (!result) return result;
 
     game.properties[property_id].owner_id = {};
-    game.player(player_id).properties[property_id] = false;
+    game.player(player_id).properties.reset(property_id);
+    game.properties_changed(BasicPropertySet<N>::only(property_id));
 
-    const int price = game.ppi * game.properties[property_id].guide_price;
+    const int price = game.ppi * game.properties[property_id].guide_price();
     game.player(player_id).cash += price;
+    game.player_changed(player_id);
 
-    return {true,
-            game.player(player_id).name + " sold "
-                + game.properties[property_id].name + " to the bank for £"
-                + std::to_string(price)};
+    return {true, Result::Code::sold_property, {player_id, 0, property_id, price}};
 }
 
-Result mortgage(Game& game, unsigned player_id, unsigned property_id)
+template <std::size_t N>
+Result mortgage(BasicGame<N>& game, unsigned player_id, unsigned property_id)
 {
     const auto result = can_mortgage(game, player_id, property_id);
     if (!result) return result;
@@ -454,17 +651,17 @@ Result mortgage(Game& game, unsigned player_id, unsigned property_id)
     auto& player = game.player(player_id);
     auto& property = game.properties[property_id];
 
-    const int amount = property.guide_price * game.ppi / 2.0;
+    const int amount = property.guide_price() * game.ppi / 2;
     property.mortgage(amount);
     player.cash += amount;
+    game.player_changed(player_id);
+    game.properties_changed(BasicPropertySet<N>::only(property_id));
 
-    return {true,
-            game.player(player_id).name + " mortgaged "
-                + game.properties[property_id].name + " for £"
-                + std::to_string(amount)};
+    return {true, Result::Code::mortgaged, {player_id, 0, property_id, amount}};
 }
 
-Result unmortgage(Game& game, unsigned player_id, unsigned property_id)
+template <std::size_t N>
+Result unmortgage(BasicGame<N>& game, unsigned player_id, unsigned property_id)
 {
     const auto result = can_unmortgage(game, player_id, property_id);
     if (!result) return result;
@@ -472,94 +669,94 @@ Result unmortgage(Game& game, unsigned player_id, unsigned property_id)
     auto& player = game.player(player_id);
     auto& property = game.properties[property_id];
 
-    const int price = property.mortgage_amount() * 1.1;
+    const int price = property.mortgage_amount() * game.rules().unmortgage_factor;
     player.cash -= price;
     property.unmortgage();
+    game.player_changed(player_id);
+    game.properties_changed(BasicPropertySet<N>::only(property_id));
 
-    return {true,
-            game.player(player_id).name + " unmortgaged "
-                + game.properties[property_id].name + " for £"
-                + std::to_string(price)};
+    return {true, Result::Code::unmortgaged, {player_id, 0, property_id, price}};
 }
 
-Result build_houses(Game& game, unsigned player_id, PropertySet set, int number)
+template <std::size_t N>
+Result build_houses(BasicGame<N>& game, unsigned player_id, PropertySetOf<N> set, int number)
 {
     const auto result = can_build_houses(game, player_id, set, number);
     if (!result) return result;
 
     auto& player = game.player(player_id);
-    const int house_price = game.properties[property_id(set)].house_price;
+    const int house_price = game.properties[property_id(set)].house_price();
 
     player.cash -= number * house_price;
+    game.player_changed(player_id);
 
-    std::vector<unsigned> ids = property_ids(set);
+    auto ids = property_ids(set);
     // Sort by number of houses already on property ascending, then by property index descending.
     // The idea is to first put houses on properties with fewer houses, and if two properties have
     // the same number of houses then to first put houses on the more valuable property.
     std::sort(ids.begin(), ids.end(), [&game](unsigned ida, unsigned idb) {
-        if (game.properties[ida].houses < game.properties[idb].houses) return true;
+        const int housesa = game.properties[ida].houses;
+        const int housesb = game.properties[idb].houses;
+        if (housesa != housesb) return housesa < housesb;
         return ida > idb;
     });
 
-    for (unsigned i = 0; number > 0;) {
-        game.properties[ids[i]].houses++;
-
-        --number;
+    for (unsigned i = 0, remaining = number; remaining > 0;) {
+        // Skip over properties that already have a hotel
+        if (game.properties[ids[i]].houses < 5) {
+            game.properties[ids[i]].houses++;
+            --remaining;
+        }
         i = (i + 1) % ids.size();
     }
+    game.properties_changed(set);
 
-    std::string description = game.player(player_id).name + " built "
-                              + std::to_string(number) + "house"
-                              + (number == 1 ? "" : "s") + " on ";
-    for (const unsigned id : ids) description += game.properties[id].name + ", ";
-    description.pop_back();
-    description.pop_back();
-
-    return {true, std::move(description)};
+    return {true, Result::Code::built_houses, {player_id, 0, 0, number, 0, set}};
 }
 
-Result sell_houses(Game& game, unsigned player_id, PropertySet set, int number)
+template <std::size_t N>
+Result sell_houses(BasicGame<N>& game, unsigned player_id, PropertySetOf<N> set, int number)
 {
     const auto result = can_sell_houses(game, player_id, set, number);
     if (!result) return result;
 
     auto& player = game.player(player_id);
-    const int house_price = game.properties[property_id(set)].house_price;
+    const int house_price = game.properties[property_id(set)].house_price();
 
     player.cash += (number * house_price) / 2;
+    game.player_changed(player_id);
 
-    std::vector<unsigned> ids = property_ids(set);
+    auto ids = property_ids(set);
     // Sell houses in the opposite order to buying them...
     std::sort(ids.begin(), ids.end(), [&game](unsigned ida, unsigned idb) {
-        if (game.properties[ida].houses > game.properties[idb].houses) return true;
+        const int housesa = game.properties[ida].houses;
+        const int housesb = game.properties[idb].houses;
+        if (housesa != housesb) return housesa > housesb;
         return ida < idb;
     });
 
-    for (unsigned i = 0; number > 0;) {
-        game.properties[ids[i]].houses--;
-
-        --number;
+    for (unsigned i = 0, remaining = number; remaining > 0;) {
+        // Skip over properties that have nothing left to sell
+        if (game.properties[ids[i]].houses > 0) {
+            game.properties[ids[i]].houses--;
+            --remaining;
+        }
         i = (i + 1) % ids.size();
     }
+    game.properties_changed(set);
 
-    std::string description = game.player(player_id).name + " sold "
-                              + std::to_string(number) + "house"
-                              + (number == 1 ? "" : "s") + " from ";
-    for (const unsigned id : ids) description += game.properties[id].name + ", ";
-    description.pop_back();
-    description.pop_back();
-
-    return {true, std::move(description)};
+    return {true, Result::Code::sold_houses, {player_id, 0, 0, number, 0, set}};
 }
 
-Result pay_repairs(Game& game, unsigned player_id, int cost_per_house, int cost_per_hotel)
+template <std::size_t N>
+Result pay_repairs(BasicGame<N>& game, unsigned player_id, int cost_per_house, int cost_per_hotel)
 {
     const auto result = can_pay_repairs(game, player_id, cost_per_house, cost_per_hotel);
     if (!result) return result;
 
     int amount_to_pay = 0;
     for_each_property(game.player(player_id).properties, game,
-                      [&amount_to_pay, cost_per_house, cost_per_hotel](const Property& p) {
+                      [&amount_to_pay, cost_per_house, cost_per_hotel](const auto& p) {
                           if (p.houses == 5) {
                               amount_to_pay += cost_per_hotel;
                           } else {
@@ -567,38 +764,38 @@ Result pay_repairs(Game& game, unsigned player_id, int cost_per_house, int cost_
                           }
                       });
     game.player(player_id).cash -= amount_to_pay;
+    game.player_changed(player_id);
 
-    return {true,
-            game.player(player_id).name + " payed £"
-                + std::to_string(amount_to_pay) + " in building repairs"};
+    return {true, Result::Code::paid_repairs, {player_id, 0, 0, amount_to_pay}};
 }
 
-Result pay_to_bank(Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result pay_to_bank(BasicGame<N>& game, unsigned player_id, int amount)
 {
     const auto result = can_pay_to_bank(game, player_id, amount);
     if (!result) return result;
 
     game.player(player_id).cash -= amount;
+    game.player_changed(player_id);
 
-    return {true,
-            game.player(player_id).name + " payed £" + std::to_string(amount)
-                + " to the bank"};
+    return {true, Result::Code::paid_to_bank, {player_id, 0, 0, amount}};
 }
 
-Result pay_to_player(Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result pay_to_player(BasicGame<N>& game, unsigned player_id, int amount)
 {
     const auto result = can_pay_to_player(game, player_id, amount);
     if (!result) return result;
 
     game.player(player_id).cash += amount;
+    game.player_changed(player_id);
 
-    return {true,
-            "The bank payed out £" + std::to_string(amount) + " to "
-                + game.player(player_id).name};
+    return {true, Result::Code::paid_to_player, {player_id, 0, 0, amount}};
 }
 
-Result transfer(Game& game, unsigned from_player_id, unsigned to_player_id, int amount,
-                PropertySet properties)
+template <std::size_t N>
+Result transfer(BasicGame<N>& game, unsigned from_player_id, unsigned to_player_id, int amount,
+                PropertySetOf<N> properties)
 {
     const auto result = can_transfer(game, from_player_id, to_player_id, amount, properties);
     if (!result) return result;
@@ -608,72 +805,75 @@ Result transfer(Game& game, unsigned from_player_id, unsigned to_player_id, int
 
     from_player.cash -= amount;
     to_player.cash += amount;
+    game.player_changed(from_player_id);
+    game.player_changed(to_player_id);
 
     from_player.properties ^= properties;
     to_player.properties ^= properties;
 
-    for_each_property(properties, game, [to_player_id](Property& p) {
+    for_each_property(properties, game, [to_player_id](auto& p) {
         p.owner_id = to_player_id;
     });
+    game.properties_changed(properties);
 
-    return {true,
-            game.player(from_player_id).name + " made a transfer to "
-                + game.player(to_player_id).name};
+    return {true, Result::Code::transferred,
+            {from_player_id, to_player_id, 0, amount, 0, properties}};
 }
 
-Result take_out_secured_debt(Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result take_out_secured_debt(BasicGame<N>& game, unsigned player_id, int amount)
 {
     const auto result = can_take_out_secured_debt(game, player_id, amount);
     if (!result) return result;
 
     game.player(player_id).secured_debt += amount;
     game.player(player_id).cash += amount;
+    game.player_changed(player_id);
 
-    return {true,
-            game.player(player_id).name + " took out £"
-                + std::to_string(amount) + " of secured debt"};
+    return {true, Result::Code::took_out_secured_debt, {player_id, 0, 0, amount}};
 }
 
-Result take_out_unsecured_debt(Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result take_out_unsecured_debt(BasicGame<N>& game, unsigned player_id, int amount)
 {
     const auto result = can_take_out_unsecured_debt(game, player_id, amount);
     if (!result) return result;
 
     game.player(player_id).unsecured_debt += amount;
     game.player(player_id).cash += amount;
+    game.player_changed(player_id);
 
-    return {true,
-            game.player(player_id).name + " took out £"
-                + std::to_string(amount) + " of unsecured debt"};
+    return {true, Result::Code::took_out_unsecured_debt, {player_id, 0, 0, amount}};
 }
 
-Result pay_off_secured_debt(Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result pay_off_secured_debt(BasicGame<N>& game, unsigned player_id, int amount)
 {
     const auto result = can_pay_off_secured_debt(game, player_id, amount);
     if (!result) return result;
 
     game.player(player_id).secured_debt -= amount;
     game.player(player_id).cash -= amount;
+    game.player_changed(player_id);
 
-    return {true,
-            game.player(player_id).name + " payed off £"
-                + std::to_string(amount) + " of secured debt"};
+    return {true, Result::Code::paid_off_secured_debt, {player_id, 0, 0, amount}};
 }
 
-Result pay_off_unsecured_debt(Game& game, unsigned player_id, int amount)
+template <std::size_t N>
+Result pay_off_unsecured_debt(BasicGame<N>& game, unsigned player_id, int amount)
 {
     const auto result = can_pay_off_unsecured_debt(game, player_id, amount);
     if (!result) return result;
 
     game.player(player_id).unsecured_debt -= amount;
     game.player(player_id).cash -= amount;
+    game.player_changed(player_id);
 
-    return {true,
-            game.player(player_id).name + " payed off £"
-                + std::to_string(amount) + " of unsecured debt"};
+    return {true, Result::Code::paid_off_unsecured_debt, {player_id, 0, 0, amount}};
 }
 
-Result concede_to_player(Game& game, unsigned loser, unsigned victor)
+template <std::size_t N>
+Result concede_to_player(BasicGame<N>& game, unsigned loser, unsigned victor)
 {
     const auto result = can_concede_to_player(game, loser, victor);
     if (!result) return result;
@@ -682,21 +882,555 @@ Result concede_to_player(Game& game, unsigned loser, unsigned victor)
 
     // Don't erase player, just leave them there, otherwise all player ids are invalidated
 
-    return {true,
-            game.player(loser).name + " went bankrupt, "
-                + game.player(victor).name + " has taken all assets"};
+    return {true, Result::Code::conceded_to_player, {loser, victor}};
 }
 
-Result concede_to_bank(Game& game, unsigned player_id)
+template <std::size_t N>
+Result concede_to_bank(BasicGame<N>& game, unsigned player_id)
 {
     const auto result = can_concede_to_bank(game, player_id);
     if (!result) return result;
 
+    for_each_property(game.player(player_id).properties, game, [](auto& p) {
+        p.owner_id = {};
+        p.houses = 0;
+        p.unmortgage();
+    });
+
+    const BasicPropertySet<N> properties = game.player(player_id).properties;
     game.player(player_id).cash = 0;
     game.player(player_id).properties = 0;
+    game.player_changed(player_id);
+    game.properties_changed(properties);
+
+    return {true, Result::Code::conceded_to_bank, {player_id}};
+}
+
+namespace {
+    // Every leg, without checking any of them. Players may be left with
+    // negative cash or debt part way through, but not once all are done if
+    // can_trade allowed it.
+    template <std::size_t N>
+    void apply_trade(BasicGame<N>& game, const BasicTrade<N>& deal)
+    {
+        for (const auto& leg : deal.legs) {
+            auto& from_player = game.player(leg.from);
+            auto& to_player = game.player(leg.to);
+
+            from_player.cash -= leg.cash;
+            to_player.cash += leg.cash;
+            from_player.secured_debt -= leg.secured_debt;
+            to_player.secured_debt += leg.secured_debt;
+            from_player.unsecured_debt -= leg.unsecured_debt;
+            to_player.unsecured_debt += leg.unsecured_debt;
+            game.player_changed(leg.from);
+            game.player_changed(leg.to);
+
+            from_player.properties ^= leg.properties;
+            to_player.properties |= leg.properties;
+            for_each_property(leg.properties, game, [to = leg.to](auto& p) { p.owner_id = to; });
+            game.properties_changed(leg.properties);
+        }
+    }
+}
+
+template <std::size_t N>
+Result can_trade(const BasicGame<N>& game, const BasicTrade<N>& deal)
+{
+    if (deal.legs.empty()) return {false, Result::Code::empty_trade};
+
+    // What the trade does to each player, every leg at once
+    std::vector<int> cash(game.num_players());
+    std::vector<int> secured_debt(game.num_players());
+    std::vector<int> unsecured_debt(game.num_players());
+    BasicPropertySet<N> given = 0;
+
+    for (const auto& leg : deal.legs) {
+        CHECK_PLAYER_ID_IN_RANGE(leg.from);
+        CHECK_PLAYER_ID_IN_RANGE(leg.to);
+        assert(leg.from != leg.to);
+        assert(leg.cash >= 0 && leg.secured_debt >= 0 && leg.unsecured_debt >= 0);
+
+        // Each property can only be given once, by whoever owns it now
+        if ((game.player(leg.from).properties & leg.properties) != leg.properties
+            || (given & leg.properties).any()) {
+            return {false, Result::Code::properties_not_owned,
+                    {leg.from, leg.to, 0, leg.cash, 0, leg.properties}};
+        }
+        given |= leg.properties;
+
+        cash[leg.from] -= leg.cash;
+        cash[leg.to] += leg.cash;
+        secured_debt[leg.from] -= leg.secured_debt;
+        secured_debt[leg.to] += leg.secured_debt;
+        unsecured_debt[leg.from] -= leg.unsecured_debt;
+        unsecured_debt[leg.to] += leg.unsecured_debt;
+    }
+
+    bool houses_on_properties = false;
+    for_each_property(given, game, [&houses_on_properties](const auto& p) {
+        if (p.houses > 0) houses_on_properties = true;
+    });
+    if (houses_on_properties) {
+        return {false, Result::Code::houses_on_properties};
+    }
+
+    bool takes_on_debt = false;
+    for (unsigned player_id = 0; player_id < game.num_players(); ++player_id) {
+        const auto& player = game.player(player_id);
+        if (player.cash + cash[player_id] < 0) {
+            return {false, Result::Code::not_enough_cash, {player_id}};
+        }
+        if (player.secured_debt + secured_debt[player_id] < 0
+            || player.unsecured_debt + unsecured_debt[player_id] < 0) {
+            return {false, Result::Code::debt_not_owed, {player_id}};
+        }
+        takes_on_debt = takes_on_debt || secured_debt[player_id] > 0
+                        || unsecured_debt[player_id] > 0;
+    }
+
+    // How much debt a player can carry depends on what they own, so is
+    // checked on the game as it would be after the trade
+    if (takes_on_debt) {
+        BasicGame<N> after = game;
+        apply_trade(after, deal);
+        for (unsigned player_id = 0; player_id < game.num_players(); ++player_id) {
+            const auto& player = after.player(player_id);
+            if (secured_debt[player_id] > 0
+                && player.secured_debt > max_secured_debt(player, after)) {
+                return {false, Result::Code::too_much_secured_debt,
+                        {player_id, 0, 0, secured_debt[player_id]}};
+            }
+            if (unsecured_debt[player_id] > 0
+                && player.unsecured_debt > max_unsecured_debt(player, after)) {
+                return {false, Result::Code::too_much_unsecured_debt,
+                        {player_id, 0, 0, unsecured_debt[player_id]}};
+            }
+        }
+    }
+
+    return true;
+}
+
+template <std::size_t N>
+Result trade(BasicGame<N>& game, const BasicTrade<N>& deal)
+{
+    const auto result = can_trade(game, deal);
+    if (!result) return result;
+
+    apply_trade(game, deal);
+
+    std::vector<bool> party(game.num_players());
+    for (const auto& leg : deal.legs) party[leg.from] = party[leg.to] = true;
+    const int parties = std::count(party.begin(), party.end(), true);
+
+    const auto& first = deal.legs.front();
+    return {true, Result::Code::traded, {first.from, first.to, 0, parties}};
+}
+
+// Descriptions ---------------------------------------------------------------
+
+namespace {
+
+std::string money(int amount)
+{
+    return "£" + std::to_string(amount);
+}
+
+template <std::size_t N>
+std::string property_names(const BasicGame<N>& game,
+                           const BasicPropertySet<max_board_properties>& set)
+{
+    std::string names;
+    for_each_property_id(set, [&game, &names](unsigned id) {
+        if (!names.empty()) names += ", ";
+        names += game.properties[id].name();
+    });
+    return names;
+}
+
+}
+
+template <std::size_t N>
+std::string Result::description(const BasicGame<N>& game) const
+{
+    const auto player = [this, &game]() -> const std::string& {
+        return game.player(args_.player).name;
+    };
+    const auto other_player = [this, &game]() -> const std::string& {
+        return game.player(args_.other_player).name;
+    };
+    const auto property = [this, &game]() -> const std::string& {
+        return game.properties[args_.property].name();
+    };
+    const auto houses = [](int number) {
+        return std::to_string(number) + (number == 1 ? " house" : " houses");
+    };
+
+    switch (code_) {
+    case Code::none: return "";
+    case Code::text: return text_;
+
+    case Code::not_enough_cash: return player() + " doesn't have enough cash";
+    case Code::cannot_pay_interest: return "Not enough funds to pay interest";
+    case Code::property_not_available: return property() + " is not available";
+    case Code::property_not_owned: return player() + " doesn't own " + property();
+    case Code::already_mortgaged: return property() + " is already mortgaged";
+    case Code::not_mortgaged: return "Cannot unmortgage - " + property() + " is not mortgaged";
+    case Code::no_properties_selected: return "No properties selected";
+    case Code::cannot_build_on_stations: return "Can't build on stations";
+    case Code::cannot_build_on_utilities: return "Can't build on utilities";
+    case Code::set_not_owned: return player() + " doesn't own all properties in set";
+    case Code::too_many_houses:
+        return std::to_string(args_.amount) + " already built, maximum is "
+               + std::to_string(args_.limit);
+    case Code::too_few_houses: return "Can only remove " + houses(args_.amount);
+    case Code::properties_not_owned: return player() + " doesn't own all of those properties";
+    case Code::houses_on_properties: return "Cannot transfer properties with houses on them";
+    case Code::too_much_secured_debt:
+        return player() + " cannot take out that much secured debt";
+    case Code::too_much_unsecured_debt:
+        return player() + " cannot take out that much unsecured debt";
+    case Code::overpaying_debt: return "Cannot overpay debt";
+    case Code::debt_not_owed: return player() + " doesn't owe that much debt to hand over";
+    case Code::empty_trade: return "Nothing to trade";
+
+    case Code::raised_interest: return "Interest rates raised";
+    case Code::lowered_interest: return "Interest rates lowered";
+    case Code::passed_go: return player() + " passed go, netting " + money(args_.amount);
+    case Code::bought_property:
+        return player() + " bought " + property() + " for " + money(args_.amount);
+    case Code::sold_property:
+        return player() + " sold " + property() + " to the bank for " + money(args_.amount);
+    case Code::mortgaged:
+        return player() + " mortgaged " + property() + " for " + money(args_.amount);
+    case Code::unmortgaged:
+        return player() + " unmortgaged " + property() + " for " + money(args_.amount);
+    case Code::built_houses:
+        return player() + " built " + houses(args_.amount) + " on "
+               + property_names(game, args_.properties);
+    case Code::sold_houses:
+        return player() + " sold " + houses(args_.amount) + " from "
+               + property_names(game, args_.properties);
+    case Code::paid_repairs:
+        return player() + " payed " + money(args_.amount) + " in building repairs";
+    case Code::paid_to_bank: return player() + " payed " + money(args_.amount) + " to the bank";
+    case Code::paid_to_player:
+        return "The bank payed out " + money(args_.amount) + " to " + player();
+    case Code::transferred: return player() + " made a transfer to " + other_player();
+    case Code::took_out_secured_debt:
+        return player() + " took out " + money(args_.amount) + " of secured debt";
+    case Code::took_out_unsecured_debt:
+        return player() + " took out " + money(args_.amount) + " of unsecured debt";
+    case Code::paid_off_secured_debt:
+        return player() + " payed off " + money(args_.amount) + " of secured debt";
+    case Code::paid_off_unsecured_debt:
+        return player() + " payed off " + money(args_.amount) + " of unsecured debt";
+    case Code::conceded_to_player:
+        return player() + " went bankrupt, " + other_player() + " has taken all assets";
+    case Code::conceded_to_bank:
+        return player() + " went bankrupt, the bank has taken all assets";
+    case Code::traded:
+        if (args_.amount <= 2) return player() + " traded with " + other_player();
+        return player() + " traded with " + other_player() + " and "
+               + std::to_string(args_.amount - 2)
+               + (args_.amount == 3 ? " other player" : " other players");
+    }
+    return "";
+}
+
+// Player index ---------------------------------------------------------------
 
-    return {true,
-            game.player(player_id).name
-                + " went bankrupt, the bank has taken all assets"};
+namespace {
+    constexpr std::uint32_t no_player = UINT32_MAX;
 }
 
+template <std::size_t N>
+std::optional<unsigned> BasicGame<N>::find_player(std::string_view name) const noexcept
+{
+    if (player_index_.empty()) return {};
+
+    const std::size_t mask = player_index_.size() - 1;
+    for (std::size_t slot = std::hash<std::string_view>{}(name) & mask;;
+         slot = (slot + 1) & mask) {
+        const std::uint32_t id = player_index_[slot];
+        if (id == no_player) return {};
+        if (players_[id].name == name) return id;
+    }
+}
+
+template <std::size_t N>
+void BasicGame<N>::index_players()
+{
+    std::size_t size = 8;
+    while (size < 2 * players_.size()) size *= 2;
+
+    player_index_.assign(size, no_player);
+    for (unsigned id = 0; id < players_.size(); ++id) this->index_player(id);
+}
+
+template <std::size_t N>
+void BasicGame<N>::index_player(unsigned player_id) noexcept
+{
+    const std::size_t mask = player_index_.size() - 1;
+    std::size_t slot = std::hash<std::string_view>{}(players_[player_id].name) & mask;
+    while (player_index_[slot] != no_player) slot = (slot + 1) & mask;
+    player_index_[slot] = player_id;
+}
+
+// State hash -----------------------------------------------------------------
+
+namespace {
+
+// The splitmix64 finaliser
+constexpr std::uint64_t mix(std::uint64_t x) noexcept
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Fold one more field into a hash
+constexpr std::uint64_t combine(std::uint64_t hash, std::int64_t value) noexcept
+{
+    return mix(hash ^ (static_cast<std::uint64_t>(value) + 0x9e3779b97f4a7c15ull));
+}
+
+// Each player, each property and the rest of the game start from their own
+// key, so that the same values in different places hash differently
+constexpr std::uint64_t player_key = 1ull << 32;
+constexpr std::uint64_t property_key = 2ull << 32;
+constexpr std::uint64_t globals_key = 3ull << 32;
+
+template <std::size_t N>
+std::uint64_t hash_player(unsigned player_id, const BasicPlayer<N>& player) noexcept
+{
+    std::uint64_t hash = mix(player_key + player_id);
+    hash = combine(hash, player.salary);
+    hash = combine(hash, player.cash);
+    hash = combine(hash, player.secured_debt);
+    return combine(hash, player.unsecured_debt);
+}
+
+// Which player owns a property is part of its hash, so the player's own set
+// of properties, which always agrees with it, is left out of theirs
+template <std::size_t N>
+std::uint64_t hash_property(unsigned property_id, const BasicProperty<N>& property) noexcept
+{
+    std::uint64_t hash = mix(property_key + property_id);
+    hash = combine(hash, property.owner_id ? *property.owner_id + 1ll : 0ll);
+    hash = combine(hash, property.houses);
+    return combine(hash, property.mortgaged() ? property.mortgage_amount() : -1);
+}
+
+}
+
+template <std::size_t N>
+void BasicGame<N>::player_changed(unsigned player_id) noexcept
+{
+    auto& player = players_[player_id];
+    hash_ ^= player.hash_;
+    player.hash_ = hash_player(player_id, player);
+    hash_ ^= player.hash_;
+}
+
+// There are only three of these, so they're hashed on every call rather than
+// tracked through every change
+template <std::size_t N>
+std::uint64_t BasicGame<N>::hash() const noexcept
+{
+    std::uint64_t globals = mix(globals_key);
+    globals = combine(globals, ppi.raw());
+    globals = combine(globals, secured_interest_);
+    globals = combine(globals, unsecured_interest_);
+    return hash_ ^ globals;
+}
+
+template <std::size_t N>
+bool BasicGame<N>::hash_valid() const noexcept
+{
+    std::uint64_t expected = 0;
+    for (unsigned id = 0; id < players_.size(); ++id) {
+        expected ^= hash_player(id, players_[id]);
+    }
+    for (unsigned id = 0; id < properties.size(); ++id) {
+        expected ^= hash_property(id, properties[id]);
+    }
+    return hash_ == expected;
+}
+
+// Player totals --------------------------------------------------------------
+
+namespace {
+
+// Recount one set of properties for one player, from scratch
+template <std::size_t N>
+void count_set(const BasicGame<N>& game, const BasicPlayer<N>& player, const BasicPropertySet<N>& set,
+               std::uint8_t& owned, int& guide_price, int& weighted_income) noexcept
+{
+    const auto owned_properties = player.properties & set;
+
+    owned = owned_properties.count();
+    guide_price = 0;
+    weighted_income = 0;
+    for_each_property_id(owned_properties, [&](unsigned id) {
+        guide_price += game.properties[id].guide_price();
+        weighted_income += expected_rent(game.properties[id], game)
+                           * game.properties[id].landing_weight();
+    });
+}
+
+}
+
+template <std::size_t N>
+void BasicGame<N>::properties_changed(Set changed) noexcept
+{
+    Set sets = 0;
+    for_each_property_id(changed, [this, &sets](unsigned id) {
+        sets |= properties[id].set();
+
+        hash_ ^= properties[id].hash_;
+        properties[id].hash_ = hash_property(id, properties[id]);
+        hash_ ^= properties[id].hash_;
+    });
+
+    while (sets.any()) {
+        const unsigned leader = property_id(sets);
+        const Set set = properties[leader].set();
+        sets &= ~set;
+
+        // The counts of every player must be in place before any rent in the
+        // set is worked out, as rent depends on the owner's count
+        for (auto& player : players_) {
+            player.totals_.owned_in_set[leader] = (player.properties & set).count();
+        }
+
+        for (auto& player : players_) {
+            auto& totals = player.totals_;
+            totals.guide_price -= totals.guide_price_in_set[leader];
+            totals.weighted_income -= totals.weighted_income_in_set[leader];
+
+            count_set(*this, player, set, totals.owned_in_set[leader],
+                      totals.guide_price_in_set[leader], totals.weighted_income_in_set[leader]);
+
+            totals.guide_price += totals.guide_price_in_set[leader];
+            totals.weighted_income += totals.weighted_income_in_set[leader];
+        }
+    }
+
+    assert(this->totals_valid());
+}
+
+template <std::size_t N>
+bool BasicGame<N>::totals_valid() const noexcept
+{
+    for (const auto& player : players_) {
+        BasicPlayerTotals<N> expected;
+        for (unsigned leader = 0; leader < properties.size(); ++leader) {
+            const Set set = properties[leader].set();
+            if (property_id(set) != leader) continue;
+
+            count_set(*this, player, set, expected.owned_in_set[leader],
+                      expected.guide_price_in_set[leader],
+                      expected.weighted_income_in_set[leader]);
+            expected.guide_price += expected.guide_price_in_set[leader];
+            expected.weighted_income += expected.weighted_income_in_set[leader];
+        }
+
+        const auto& actual = player.totals();
+        if (actual.guide_price != expected.guide_price
+            || actual.weighted_income != expected.weighted_income
+            || actual.owned_in_set != expected.owned_in_set
+            || actual.guide_price_in_set != expected.guide_price_in_set
+            || actual.weighted_income_in_set != expected.weighted_income_in_set) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Accounting functions -------------------------------------------------------
+
+template <std::size_t N>
+std::size_t memory_usage(const BasicGame<N>& game) noexcept
+{
+    std::size_t bytes = sizeof(BasicGame<N>) + heap_usage(game.players()) + heap_usage(game.player_index());
+    for (const auto& player : game.players()) bytes += heap_usage(player.name);
+    return bytes;
+}
+
+template <std::size_t N>
+std::size_t memory_usage(const BasicRuleset<N>& ruleset) noexcept
+{
+    std::size_t bytes = sizeof(BasicRuleset<N>) + heap_usage(ruleset.name())
+                        + heap_usage(ruleset.property_index());
+    for (const auto& property : ruleset.properties()) bytes += heap_usage(property.name);
+    return bytes;
+}
+
+// Board sizes ----------------------------------------------------------------
+
+// Each board size that games are played on gets its own copy of everything
+// above, so the standard board keeps its single word property sets
+#define INSTANTIATE_BOARD(N)                                                                      \
+    template struct BasicRuleset<N>;                                                              \
+    template struct BasicGame<N>;                                                                 \
+    template std::string Result::description(const BasicGame<N>&) const;                          \
+    template std::size_t memory_usage(const BasicGame<N>&) noexcept;                              \
+    template std::size_t memory_usage(const BasicRuleset<N>&) noexcept;                           \
+                                                                                                  \
+    template int rent(const BasicProperty<N>&, const BasicGame<N>&, int) noexcept;                \
+    template int expected_rent(const BasicProperty<N>&, const BasicGame<N>&) noexcept;            \
+    template int asset_value(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;                \
+    template int expected_income(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;            \
+    template int interest_to_pay(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;            \
+    template int max_secured_debt(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;           \
+    template int max_unsecured_debt(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;         \
+                                                                                                  \
+    template Result can_raise_interest(const BasicGame<N>&);                                      \
+    template Result can_lower_interest(const BasicGame<N>&);                                      \
+    template Result can_passgo(const BasicGame<N>&, unsigned);                                    \
+    template Result can_buy_property(const BasicGame<N>&, unsigned, unsigned, int);               \
+    template Result can_sell_property(const BasicGame<N>&, unsigned, unsigned);                   \
+    template Result can_mortgage(const BasicGame<N>&, unsigned, unsigned);                        \
+    template Result can_unmortgage(const BasicGame<N>&, unsigned, unsigned);                      \
+    template Result can_build_houses(const BasicGame<N>&, unsigned, PropertySetOf<N>, int);       \
+    template Result can_sell_houses(const BasicGame<N>&, unsigned, PropertySetOf<N>, int);        \
+    template Result can_pay_repairs(const BasicGame<N>&, unsigned, int, int);                     \
+    template Result can_pay_to_bank(const BasicGame<N>&, unsigned, int);                          \
+    template Result can_pay_to_player(const BasicGame<N>&, unsigned, int);                        \
+    template Result can_transfer(const BasicGame<N>&, unsigned, unsigned, int,                    \
+                                 PropertySetOf<N>);                                               \
+    template Result can_take_out_secured_debt(const BasicGame<N>&, unsigned, int);                \
+    template Result can_take_out_unsecured_debt(const BasicGame<N>&, unsigned, int);              \
+    template Result can_pay_off_secured_debt(const BasicGame<N>&, unsigned, int);                 \
+    template Result can_pay_off_unsecured_debt(const BasicGame<N>&, unsigned, int);               \
+    template Result can_concede_to_player(const BasicGame<N>&, unsigned, unsigned);               \
+    template Result can_concede_to_bank(const BasicGame<N>&, unsigned);                           \
+    template Result can_trade(const BasicGame<N>&, const BasicTrade<N>&);                         \
+                                                                                                  \
+    template Result raise_interest(BasicGame<N>&);                                                \
+    template Result lower_interest(BasicGame<N>&);                                                \
+    template Result passgo(BasicGame<N>&, unsigned);                                              \
+    template Result buy_property(BasicGame<N>&, unsigned, unsigned, int);                         \
+    template Result sell_property(BasicGame<N>&, unsigned, unsigned);                             \
+    template Result mortgage(BasicGame<N>&, unsigned, unsigned);                                  \
+    template Result unmortgage(BasicGame<N>&, unsigned, unsigned);                                \
+    template Result build_houses(BasicGame<N>&, unsigned, PropertySetOf<N>, int);                 \
+    template Result sell_houses(BasicGame<N>&, unsigned, PropertySetOf<N>, int);                  \
+    template Result pay_repairs(BasicGame<N>&, unsigned, int, int);                               \
+    template Result pay_to_bank(BasicGame<N>&, unsigned, int);                                    \
+    template Result pay_to_player(BasicGame<N>&, unsigned, int);                                  \
+    template Result transfer(BasicGame<N>&, unsigned, unsigned, int, PropertySetOf<N>);           \
+    template Result take_out_secured_debt(BasicGame<N>&, unsigned, int);                          \
+    template Result take_out_unsecured_debt(BasicGame<N>&, unsigned, int);                        \
+    template Result pay_off_secured_debt(BasicGame<N>&, unsigned, int);                           \
+    template Result pay_off_unsecured_debt(BasicGame<N>&, unsigned, int);                         \
+    template Result concede_to_player(BasicGame<N>&, unsigned, unsigned);                         \
+    template Result concede_to_bank(BasicGame<N>&, unsigned);                                     \
+    template Result trade(BasicGame<N>&, const BasicTrade<N>&)
+
+INSTANTIATE_BOARD(num_standard_properties);
+INSTANTIATE_BOARD(64);
+INSTANTIATE_BOARD(max_board_properties);
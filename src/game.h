@@ -1,6 +1,9 @@
 #pragma once
 
 #include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 #include <functional>
 #include <unordered_map>
 #include <cassert>
@@ -8,10 +11,152 @@
 #include <set>
 #include <bitset>
 #include <array>
+#include <string>
+#include <utility>
+#include <optional>
+#include <algorithm>
 
-struct PropertySet : std::bitset<28> {
-    constexpr PropertySet(unsigned long long bits = 0)
-        : std::bitset<28>{bits}
+// Number of properties on the standard board
+constexpr std::size_t num_standard_properties = 28;
+// Largest board that games can be played on. Every board size in between
+// that is used must be instantiated at the bottom of game.cpp.
+constexpr std::size_t max_board_properties = 128;
+
+// Landing weights are in units of 1/landing_weight_scale
+constexpr int landing_weight_scale = 1000;
+
+template <std::size_t N> struct BasicGame;
+
+// Returns the smallest property id in a set of bits
+constexpr unsigned lowest_property_id(unsigned long long bits) noexcept
+{
+    // There must be some bits set, or the result is undefined
+    assert(bits);
+    return __builtin_ctzll(bits);
+}
+
+// A set of properties on a board of N properties, held as whole machine
+// words so that set operations work a word at a time. Boards of up to 32
+// properties, like the standard one, take a single 32 bit word.
+template <std::size_t N>
+struct BasicPropertySet {
+    using Word = std::conditional_t<(N <= 32), std::uint32_t, std::uint64_t>;
+    static constexpr std::size_t word_bits = sizeof(Word) * CHAR_BIT;
+    static constexpr std::size_t num_words = (N + word_bits - 1) / word_bits;
+
+    // Properties 0 to 63 only, which is all of them on most boards
+    constexpr BasicPropertySet(unsigned long long bits = 0) noexcept {
+        words_[0] = static_cast<Word>(bits);
+        this->trim();
+    }
+
+    // The same properties, on a bigger board
+    template <std::size_t M, typename = std::enable_if_t<(M < N)>>
+    constexpr BasicPropertySet(const BasicPropertySet<M>& set) noexcept {
+        for (std::size_t i = 0; i < set.num_words; ++i) {
+            const std::size_t bit = i * set.word_bits;
+            words_[bit / word_bits] |= Word(set.word(i)) << (bit % word_bits);
+        }
+    }
+
+    static constexpr BasicPropertySet only(std::size_t id) noexcept {
+        return BasicPropertySet{}.set(id);
+    }
+
+    constexpr std::size_t size() const noexcept { return N; }
+    constexpr Word word(std::size_t i) const noexcept { return words_[i]; }
+
+    constexpr bool test(std::size_t id) const noexcept {
+        return (words_[id / word_bits] >> (id % word_bits)) & 1;
+    }
+    constexpr bool operator[](std::size_t id) const noexcept { return this->test(id); }
+
+    constexpr BasicPropertySet& set(std::size_t id, bool value = true) noexcept {
+        const Word bit = Word(1) << (id % word_bits);
+        Word& word = words_[id / word_bits];
+        word = value ? (word | bit) : (word & ~bit);
+        return *this;
+    }
+    constexpr BasicPropertySet& reset(std::size_t id) noexcept { return this->set(id, false); }
+
+    std::size_t count() const noexcept {
+        std::size_t count = 0;
+        for (const Word word : words_) count += __builtin_popcountll(word);
+        return count;
+    }
+    constexpr bool any() const noexcept {
+        for (const Word word : words_) {
+            if (word) return true;
+        }
+        return false;
+    }
+    constexpr bool none() const noexcept { return !this->any(); }
+
+    // Only for boards that fit in one 64 bit word
+    constexpr unsigned long long to_ullong() const noexcept {
+        static_assert(N <= 64);
+        return words_[0];
+    }
+    constexpr unsigned long to_ulong() const noexcept {
+        static_assert(N <= sizeof(unsigned long) * CHAR_BIT);
+        return words_[0];
+    }
+
+    constexpr BasicPropertySet& operator&=(const BasicPropertySet& other) noexcept {
+        for (std::size_t i = 0; i < num_words; ++i) words_[i] &= other.words_[i];
+        return *this;
+    }
+    constexpr BasicPropertySet& operator|=(const BasicPropertySet& other) noexcept {
+        for (std::size_t i = 0; i < num_words; ++i) words_[i] |= other.words_[i];
+        return *this;
+    }
+    constexpr BasicPropertySet& operator^=(const BasicPropertySet& other) noexcept {
+        for (std::size_t i = 0; i < num_words; ++i) words_[i] ^= other.words_[i];
+        return *this;
+    }
+    constexpr BasicPropertySet operator~() const noexcept {
+        BasicPropertySet result;
+        for (std::size_t i = 0; i < num_words; ++i) result.words_[i] = ~words_[i];
+        result.trim();
+        return result;
+    }
+
+    friend constexpr BasicPropertySet operator&(BasicPropertySet a, const BasicPropertySet& b) noexcept {
+        return a &= b;
+    }
+    friend constexpr BasicPropertySet operator|(BasicPropertySet a, const BasicPropertySet& b) noexcept {
+        return a |= b;
+    }
+    friend constexpr BasicPropertySet operator^(BasicPropertySet a, const BasicPropertySet& b) noexcept {
+        return a ^= b;
+    }
+    friend constexpr bool operator==(const BasicPropertySet& a, const BasicPropertySet& b) noexcept {
+        for (std::size_t i = 0; i < num_words; ++i) {
+            if (a.words_[i] != b.words_[i]) return false;
+        }
+        return true;
+    }
+    friend constexpr bool operator!=(const BasicPropertySet& a, const BasicPropertySet& b) noexcept {
+        return !(a == b);
+    }
+private:
+    // Clear the bits past the last property
+    constexpr void trim() noexcept {
+        if constexpr (N % word_bits != 0) {
+            words_[num_words - 1] &= (Word(1) << (N % word_bits)) - 1;
+        }
+    }
+
+    std::array<Word, num_words> words_ = {};
+};
+
+// A set of properties on the standard board
+struct PropertySet : BasicPropertySet<num_standard_properties> {
+    constexpr PropertySet(unsigned long long bits = 0) noexcept
+        : BasicPropertySet{bits}
+    {}
+    constexpr PropertySet(const BasicPropertySet& set) noexcept
+        : BasicPropertySet{set}
     {}
 
     static const PropertySet brown;
@@ -26,8 +171,24 @@ struct PropertySet : std::bitset<28> {
     static const PropertySet utility;
 };
 
-struct Player {
-    Player(std::string name)
+// Sums over a player's properties, so that the information functions don't
+// have to look at every property. Per set entries are indexed by the lowest
+// property id in the set.
+template <std::size_t N>
+struct BasicPlayerTotals {
+    int guide_price = 0;
+    // Expected rent weighted by how often each property is landed on, in units
+    // of 1/landing_weight_scale
+    int weighted_income = 0;
+
+    std::array<std::uint8_t, N> owned_in_set = {};
+    std::array<int, N> guide_price_in_set = {};
+    std::array<int, N> weighted_income_in_set = {};
+};
+
+template <std::size_t N>
+struct BasicPlayer {
+    BasicPlayer(std::string name)
         : name{std::move(name)}
     {}
 
@@ -37,16 +198,64 @@ struct Player {
     int cash = 200;
     int secured_debt = 0;
     int unsecured_debt = 0;
-    PropertySet properties = 0;
+    BasicPropertySet<N> properties = 0;
+
+    // Kept up to date by Game::properties_changed
+    const BasicPlayerTotals<N>& totals() const noexcept { return totals_; }
+private:
+    friend struct BasicGame<N>;
+    BasicPlayerTotals<N> totals_;
+    // This player's part of Game::hash, kept up to date by Game::player_changed
+    std::uint64_t hash_ = 0;
 };
 
-struct Property {
-    Property(std::string name, int guide_price, int house_price, PropertySet set,
-             std::array<int, 6> rents)
+// Decides how rent is worked out, and whether houses can be built
+enum class PropertyKind { street, station, utility };
+
+// What never changes about a property during a game. Held once by the
+// ruleset the game is played with, and shared by all of its games.
+template <std::size_t N>
+struct BasicPropertyInfo {
+    BasicPropertyInfo(std::string name, int guide_price, int house_price, BasicPropertySet<N> set,
+                      std::array<int, 6> rents, PropertyKind kind = PropertyKind::street,
+                      int landing_weight = landing_weight_scale)
         : name{std::move(name)}, guide_price{guide_price},
-          house_price{house_price}, set{set}, rents{rents}
+          house_price{house_price}, set{set}, rents{rents}, kind{kind},
+          landing_weight{landing_weight}
     {}
 
+    std::string name;
+    int guide_price;
+    int house_price;
+    BasicPropertySet<N> set;
+    std::array<int, 6> rents;
+    PropertyKind kind;
+    // How often the property is landed on compared to a square picked
+    // uniformly at random, in units of 1/landing_weight_scale
+    int landing_weight;
+
+    // Filled in by the ruleset: the lowest property id in the set, and the
+    // number of properties in it
+    unsigned set_leader = 0;
+    unsigned set_size = 0;
+};
+
+// A property as it stands in one game
+template <std::size_t N>
+struct BasicProperty {
+    explicit BasicProperty(const BasicPropertyInfo<N>& info)
+        : info_{&info}
+    {}
+
+    const BasicPropertyInfo<N>& info() const noexcept { return *info_; }
+    const std::string& name() const noexcept { return info_->name; }
+    int guide_price() const noexcept { return info_->guide_price; }
+    int house_price() const noexcept { return info_->house_price; }
+    const BasicPropertySet<N>& set() const noexcept { return info_->set; }
+    const std::array<int, 6>& rents() const noexcept { return info_->rents; }
+    PropertyKind kind() const noexcept { return info_->kind; }
+    int landing_weight() const noexcept { return info_->landing_weight; }
+
     void mortgage(int amount) noexcept {
         assert(!mortgaged_);
 
@@ -66,26 +275,154 @@ struct Property {
         mortgaged_ = false;
     }
 
-    std::string name;
-    int guide_price;
-    int house_price;
-    PropertySet set;
-    std::array<int, 6> rents;
-
     int houses = 0;
     std::optional<unsigned> owner_id = {};
 private:
+    friend struct BasicGame<N>;
+    const BasicPropertyInfo<N>* info_;
     bool mortgaged_ = false;
     int mortgage_amount_ = 0;
+    // This property's part of Game::hash, kept up to date by Game::properties_changed
+    std::uint64_t hash_ = 0;
+};
+
+using PlayerTotals = BasicPlayerTotals<num_standard_properties>;
+using Player = BasicPlayer<num_standard_properties>;
+using PropertyInfo = BasicPropertyInfo<num_standard_properties>;
+using Property = BasicProperty<num_standard_properties>;
+
+// Fixed point ratio, such as the ppi, in units of 1/Ratio::scale. All money
+// is scaled with integer arithmetic only, so games come out exactly the same
+// on every machine.
+struct Ratio {
+    static constexpr std::int64_t scale = 10000;
+
+    constexpr Ratio() = default;
+
+    static constexpr Ratio from_raw(std::int64_t raw) noexcept {
+        Ratio r;
+        r.raw_ = raw;
+        return r;
+    }
+    // Rounded down to the nearest 1/scale
+    static constexpr Ratio from_fraction(std::int64_t numerator, std::int64_t denominator) noexcept {
+        return from_raw(numerator * scale / denominator);
+    }
+    // Decimal with at most four places, such as "1.1"
+    static std::optional<Ratio> parse(const std::string&);
+
+    constexpr std::int64_t raw() const noexcept { return raw_; }
+    // Only for showing to people, never for game arithmetic
+    double to_double() const noexcept { return double(raw_) / scale; }
+    // Shortest exact decimal, such as "1.1"
+    std::string to_string() const;
+
+    friend constexpr bool operator==(Ratio a, Ratio b) noexcept { return a.raw_ == b.raw_; }
+    friend constexpr bool operator!=(Ratio a, Ratio b) noexcept { return a.raw_ != b.raw_; }
+    friend constexpr bool operator<(Ratio a, Ratio b) noexcept { return a.raw_ < b.raw_; }
+private:
+    std::int64_t raw_ = scale;
+};
+
+// An amount of money scaled by a ratio, rounded towards zero
+constexpr int operator*(int amount, Ratio r) noexcept
+{
+    return static_cast<int>(amount * r.raw() / Ratio::scale);
+}
+constexpr int operator*(Ratio r, int amount) noexcept
+{
+    return amount * r;
+}
+
+// The constants of the modified rules, so they can be tuned per game
+struct Rules {
+    // How much of the old ppi is kept when a property is bought, the rest
+    // comes from the price paid relative to the guide price
+    Ratio ppi_memory = Ratio::from_fraction(1, 2);
+
+    int starting_secured_interest = 5;
+    int starting_unsecured_interest = 25;
+
+    int max_unsecured_debt = 200;
+    // Players can take out this many salaries of secured debt, on top of
+    // what their properties are worth
+    int secured_debt_salaries = 5;
+
+    // Multiple of the mortgage that must be paid back to unmortgage
+    Ratio unmortgage_factor = Ratio::from_fraction(11, 10);
 };
 
-struct Game {
-    Game(std::vector<Player> players = {}) : players_(std::move(players)) {}
+// Set a rule from its name, as used in config files and on command lines.
+// Returns false if there's no rule by that name or the value doesn't parse.
+bool set_rule(Rules&, const std::string& name, const std::string& value);
+
+// A board and the rules it is played with, under one name. Built once, when
+// it is loaded, then shared read only by every game played with it, so games
+// hold no copy of the board. It must not move while any game is using it.
+template <std::size_t N>
+struct BasicRuleset {
+    using Set = BasicPropertySet<N>;
+    using PropertyInfo = BasicPropertyInfo<N>;
+
+    // Every property must be in its own set
+    BasicRuleset(std::string name, std::array<PropertyInfo, N> properties, Rules rules = {});
+
+    const std::string& name() const noexcept { return name_; }
+    const Rules& rules() const noexcept { return rules_; }
+    const PropertyInfo& property(unsigned property_id) const noexcept {
+        return properties_[property_id];
+    }
+    const std::array<PropertyInfo, N>& properties() const noexcept { return properties_; }
 
-    Game(const Game&) = default;
-    Game& operator=(const Game&) = default;
-    Game(Game&&) = default;
-    Game& operator=(Game&&) = default;
+    // Every property that is a station or a utility respectively
+    const Set& stations() const noexcept { return stations_; }
+    const Set& utilities() const noexcept { return utilities_; }
+
+    // Id of the property with this name, if any
+    std::optional<unsigned> find_property(std::string_view name) const noexcept;
+    const std::vector<std::uint8_t>& property_index() const noexcept { return property_index_; }
+private:
+    std::string name_;
+    Rules rules_;
+    std::array<PropertyInfo, N> properties_;
+    Set stations_;
+    Set utilities_;
+    // Open addressed hash table of property ids by name, a power of two in size
+    std::vector<std::uint8_t> property_index_;
+};
+
+using Ruleset = BasicRuleset<num_standard_properties>;
+
+// The standard board with the default rules, named "Standard"
+const Ruleset& standard_ruleset();
+
+// The finances of a game played on a board of N properties. Game is a game
+// on the standard board; bigger boards pay for their size only in their own
+// games. Instantiated in game.cpp for each board size that is played on.
+template <std::size_t N>
+struct BasicGame {
+    static_assert(N <= max_board_properties);
+
+    static constexpr std::size_t num_properties = N;
+    using Set = BasicPropertySet<N>;
+    using Player = BasicPlayer<N>;
+    using Property = BasicProperty<N>;
+
+    // A game on the standard board, with the default rules
+    template <std::size_t M = N, typename = std::enable_if_t<M == num_standard_properties>>
+    BasicGame(std::vector<Player> players = {})
+        : BasicGame(standard_ruleset(), std::move(players))
+    {}
+
+    // The ruleset must outlive the game and every copy of it
+    BasicGame(const BasicRuleset<N>& ruleset, std::vector<Player> players = {})
+        : BasicGame(ruleset, std::move(players), std::make_index_sequence<N>{})
+    {}
+
+    BasicGame(const BasicGame&) = default;
+    BasicGame& operator=(const BasicGame&) = default;
+    BasicGame(BasicGame&&) = default;
+    BasicGame& operator=(BasicGame&&) = default;
 
     void raise_interest() noexcept {
         ++secured_interest_;
@@ -104,173 +441,394 @@ struct Game {
         return unsecured_interest_;
     }
 
+    const BasicRuleset<N>& ruleset() const noexcept { return *ruleset_; }
+    const Rules& rules() const noexcept { return ruleset_->rules(); }
+    const Set& stations() const noexcept { return ruleset_->stations(); }
+    const Set& utilities() const noexcept { return ruleset_->utilities(); }
+
     const Player& player(unsigned player_id) const noexcept { return players_[player_id]; }
     Player& player(unsigned player_id) noexcept { return players_[player_id]; }
     unsigned num_players() const noexcept { return players_.size(); }
     const std::vector<Player>& players() const noexcept { return players_; }
+    const std::vector<std::uint32_t>& player_index() const noexcept { return player_index_; }
 
     void add_player(const Player& player) {
-        players_.push_back(player);
+        this->add_player(Player{player});
     }
     void add_player(Player&& player) {
         players_.push_back(std::move(player));
+        players_.back().totals_ = {};
+        players_.back().hash_ = 0;
+        this->properties_changed(players_.back().properties);
+        this->player_changed(players_.size() - 1);
+
+        // Keep the index at most half full
+        if (2 * players_.size() > player_index_.size()) {
+            this->index_players();
+        } else {
+            this->index_player(players_.size() - 1);
+        }
     }
 
-    unsigned id_of_player(const std::string& name) const noexcept {
-        const auto it = std::find_if(begin(players_), end(players_),
-                                     [&name](const Player& p) { return p.name == name; });
-        assert(it != end(players_));
-        return std::distance(begin(players_), it);
-    }
+    // Must be called after changing the owner, houses or mortgage of any of
+    // these properties, to bring the players' totals and the hash up to date.
+    // Only the sets containing them are recounted.
+    void properties_changed(Set properties) noexcept;
 
-    unsigned id_of_property(const std::string& name) const noexcept {
-        const auto it = std::find_if(begin(properties), end(properties),
-                                     [&name](const Property& p) { return p.name == name; });
-        assert(it != end(properties));
-        return std::distance(begin(properties), it);
-    }
+    // Must be called after changing the salary, cash or debt of a player, to
+    // bring the hash up to date
+    void player_changed(unsigned player_id) noexcept;
 
-    std::array<Property, 28> properties = {{
-        {"Old Kent Road",         60,  50,  PropertySet::brown,   {{2,  10, 30,  90,  160, 250}}},
-        {"Whitechapel Road",      60,  50,  PropertySet::brown,   {{4,  20, 60,  180, 360, 450}}},
+    // Whether every player's totals match a count from scratch. Checked after
+    // every change in debug builds.
+    bool totals_valid() const noexcept;
 
-        {"The Angel Islington",   100, 50,  PropertySet::lblue,   {{6,  30, 90,  270, 400, 550}}},
-        {"Euston Road",           100, 50,  PropertySet::lblue,   {{6,  30, 90,  270, 400, 550}}},
-        {"Pentonville Road",      120, 50,  PropertySet::lblue,   {{8,  40, 100, 300, 450, 600}}},
+    // Zobrist style hash of everything play can change: money, debt, owners,
+    // houses, mortgages, interest rates and the ppi. Games that play the same
+    // have the same hash. Names and the board aren't included. Each player
+    // and property contributes its own hash, which is swapped out whenever it
+    // changes, so reading this is O(1).
+    std::uint64_t hash() const noexcept;
 
-        {"Pall Mall",             140, 100, PropertySet::pink,    {{10, 50, 150, 450, 625, 750}}},
-        {"Whitehall",             140, 100, PropertySet::pink,    {{10, 50, 150, 450, 625, 750}}},
-        {"Northumberland Avenue", 160, 100, PropertySet::pink,    {{12, 60, 180, 500, 700, 900}}},
+    // Whether hash() matches a hash of the whole game from scratch
+    bool hash_valid() const noexcept;
 
-        {"Bow Street",            140, 100, PropertySet::orange,  {{10, 50, 150, 450, 625, 750}}},
-        {"Marlborough Street",    140, 100, PropertySet::orange,  {{10, 50, 150, 450, 625, 750}}},
-        {"Vine Street",           160, 100, PropertySet::orange,  {{12, 60, 180, 500, 700, 900}}},
+    // Id of the first player with this name, if any
+    std::optional<unsigned> find_player(std::string_view name) const noexcept;
 
-        {"Strand",                140, 100, PropertySet::red,     {{10, 50, 150, 450, 625, 750}}},
-        {"Fleet Street",          140, 100, PropertySet::red,     {{10, 50, 150, 450, 625, 750}}},
-        {"Trafalgar Square",      160, 100, PropertySet::red,     {{12, 60, 180, 500, 700, 900}}},
+    unsigned id_of_player(std::string_view name) const noexcept {
+        const auto id = this->find_player(name);
+        assert(id);
+        return *id;
+    }
 
-        {"Leicester Square",      140, 100, PropertySet::yellow,  {{10, 50, 150, 450, 625, 750}}},
-        {"Coventry Street",       140, 100, PropertySet::yellow,  {{10, 50, 150, 450, 625, 750}}},
-        {"Piccadiliy",            160, 100, PropertySet::yellow,  {{12, 60, 180, 500, 700, 900}}},
+    unsigned id_of_property(std::string_view name) const noexcept {
+        const auto id = ruleset_->find_property(name);
+        assert(id);
+        return *id;
+    }
 
-        {"Regent Street",         140, 100, PropertySet::green,   {{10, 50, 150, 450, 625, 750}}},
-        {"Oxford Street",         140, 100, PropertySet::green,   {{10, 50, 150, 450, 625, 750}}},
-        {"Bond Street",           160, 100, PropertySet::green,   {{12, 60, 180, 500, 700, 900}}},
+    std::array<Property, N> properties;
+    Ratio ppi = {};
+private:
+    template <std::size_t... Ids>
+    BasicGame(const BasicRuleset<N>& ruleset, std::vector<Player> players,
+              std::index_sequence<Ids...>)
+        : properties{{Property{ruleset.property(Ids)}...}}, ruleset_{&ruleset},
+          players_(std::move(players)),
+          secured_interest_{ruleset.rules().starting_secured_interest},
+          unsecured_interest_{ruleset.rules().starting_unsecured_interest}
+    {
+        for (auto& player : players_) player.totals_ = {};
+        this->properties_changed(~Set{});
+        for (unsigned id = 0; id < players_.size(); ++id) this->player_changed(id);
+        this->index_players();
+    }
 
-        {"Park lane",             140, 100, PropertySet::dblue,   {{10, 50, 150, 450, 625, 750}}},
-        {"Mayfair",               160, 100, PropertySet::dblue,   {{12, 60, 180, 500, 700, 900}}},
+    void index_players();
+    void index_player(unsigned player_id) noexcept;
 
-        {"Kings Cross Station",   200, 0,   PropertySet::station, {{25, 50, 100, 200, 0,   0  }}},
-        {"Marylebone Station",    200, 0,   PropertySet::station, {{25, 50, 100, 200, 0,   0  }}},
-        {"Fenchurch St. Station", 200, 0,   PropertySet::station, {{25, 50, 100, 200, 0,   0  }}},
-        {"Liverpool St. Station", 200, 0,   PropertySet::station, {{25, 50, 100, 200, 0,   0  }}},
+    const BasicRuleset<N>* ruleset_;
+    std::vector<Player> players_;
+    // Every player's and property's hash xored together
+    std::uint64_t hash_ = 0;
+    // Open addressed hash table of player ids by name, a power of two in size
+    std::vector<std::uint32_t> player_index_;
+    int secured_interest_;
+    int unsecured_interest_;
+};
 
-        {"Electric Company",      150, 0,   PropertySet::utility, {{10, 50, 150, 450, 625, 750}}},
-        {"Water Works",           150, 0,   PropertySet::utility, {{12, 60, 180, 500, 700, 900}}},
+using Game = BasicGame<num_standard_properties>;
+
+// The set type of a board, spelled so that it is never deduced from an
+// argument. Functions taking a game and a set then accept anything that
+// converts to the game's set, such as a PropertySet or 1ull << id.
+template <std::size_t N>
+using PropertySetOf = typename BasicGame<N>::Set;
+
+// Everything one player hands to another in a trade
+template <std::size_t N>
+struct BasicTradeLeg {
+    unsigned from = 0;
+    unsigned to = 0;
+    int cash = 0;
+    BasicPropertySet<N> properties = 0;
+    // Debt the receiving player takes over from the giving one
+    int secured_debt = 0;
+    int unsecured_debt = 0;
+};
 
-    }};
-    double ppi = 1.0;
-private:
-    std::vector<Player> players_;
-    int secured_interest_ = 5;
-    int unsecured_interest_ = 25;
+// Any number of players handing things to each other, all at once. Cash and
+// debt are netted, so a player can pay with cash they're given in the same
+// trade, but properties must be owned by whoever gives them beforehand.
+template <std::size_t N>
+struct BasicTrade {
+    std::vector<BasicTradeLeg<N>> legs;
 };
 
-inline double update_ppi(double old_ppi, int bought_for, int guide_price) noexcept
+using TradeLeg = BasicTradeLeg<num_standard_properties>;
+using Trade = BasicTrade<num_standard_properties>;
+
+inline Ratio update_ppi(Ratio old_ppi, int bought_for, int guide_price, Ratio memory) noexcept
 {
-    return 0.5 * old_ppi + 0.5 * double(bought_for) / double(guide_price);
+    const Ratio paid = Ratio::from_fraction(bought_for, guide_price);
+    return Ratio::from_raw((memory.raw() * old_ppi.raw()
+                            + (Ratio::scale - memory.raw()) * paid.raw()) / Ratio::scale);
 }
 
-// Returns the smallest property id of all properties in the set
-inline unsigned property_id(PropertySet set) noexcept
+// Returns the smallest property id of all properties in the set, which
+// must not be empty
+template <std::size_t N>
+unsigned property_id(const BasicPropertySet<N>& set) noexcept
 {
-    static_assert(sizeof(unsigned) >= 28 / CHAR_BIT);
-    unsigned l = set.to_ulong();
-    // There must be some bits set, or the result is undefined
-    assert(l);
-
-    return __builtin_clz(l);
+    assert(set.any());
+    std::size_t i = 0;
+    while (!set.word(i)) ++i;
+    return i * set.word_bits + lowest_property_id(set.word(i));
 }
 
-template <typename F_of_Property>
-void for_each_property(PropertySet set, Game& game, F_of_Property function) noexcept
+// Visits the ids of the properties in the set in ascending order, skipping
+// straight from one set bit to the next
+template <std::size_t N, typename F_of_unsigned>
+void for_each_property_id(BasicPropertySet<N> set, F_of_unsigned function) noexcept
 {
-    // Not the fastest but it should work
-    for (unsigned i = 0; i < set.size(); ++i) {
-        if (set[i]) function(game.properties[i]);
+    for (std::size_t i = 0; i < set.num_words; ++i) {
+        for (auto bits = set.word(i); bits; bits &= bits - 1) {
+            function(unsigned(i * set.word_bits) + lowest_property_id(bits));
+        }
     }
 }
 
-template <typename F_of_Property>
-void for_each_property(PropertySet set, const Game& game, F_of_Property function) noexcept
+template <std::size_t N, typename F_of_Property>
+void for_each_property(PropertySetOf<N> set, BasicGame<N>& game,
+                       F_of_Property function) noexcept
 {
-    // Not the fastest but it should work
-    for (unsigned i = 0; i < set.size(); ++i) {
-        if (set[i]) function(game.properties[i]);
-    }
+    for_each_property_id(set, [&game, &function](unsigned id) { function(game.properties[id]); });
 }
 
-inline std::vector<unsigned> property_ids(PropertySet set) noexcept
+template <std::size_t N, typename F_of_Property>
+void for_each_property(PropertySetOf<N> set, const BasicGame<N>& game,
+                       F_of_Property function) noexcept
 {
-    std::vector<unsigned> ids;
-    for (unsigned id = 0; id < set.size(); ++id) {
-        if (set[id]) ids.push_back(id);
+    for_each_property_id(set, [&game, &function](unsigned id) { function(game.properties[id]); });
+}
+
+// The ids of a set of properties in ascending order, held inline so that
+// listing them never allocates
+template <std::size_t N>
+struct BasicPropertyIds {
+    BasicPropertyIds(const BasicPropertySet<N>& set) noexcept {
+        for_each_property_id(set, [this](unsigned id) { ids_[size_++] = id; });
     }
-    return ids;
+
+    std::uint8_t* begin() noexcept { return ids_.data(); }
+    std::uint8_t* end() noexcept { return ids_.data() + size_; }
+    const std::uint8_t* begin() const noexcept { return ids_.data(); }
+    const std::uint8_t* end() const noexcept { return ids_.data() + size_; }
+
+    unsigned operator[](std::size_t i) const noexcept { return ids_[i]; }
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+private:
+    std::array<std::uint8_t, N> ids_;
+    std::uint8_t size_ = 0;
+};
+
+template <std::size_t N>
+BasicPropertyIds<N> property_ids(const BasicPropertySet<N>& set) noexcept
+{
+    return BasicPropertyIds<N>{set};
 }
 
 // Information functions ------------------------------------------------------
 
-int expected_rent(const Property&) noexcept;
-int asset_value(const Player&, const Game&) noexcept;
-int expected_income(const Player&, const Game&) noexcept;
-int interest_to_pay(const Player&, const Game&) noexcept;
-
-int max_secured_debt(const Player&, const Game&) noexcept;
-int max_unsecured_debt(const Player&, const Game&) noexcept;
+template <std::size_t N>
+int rent(const BasicProperty<N>&, const BasicGame<N>&, int dice_total) noexcept;
+template <std::size_t N>
+int expected_rent(const BasicProperty<N>&, const BasicGame<N>&) noexcept;
+template <std::size_t N>
+int asset_value(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;
+template <std::size_t N>
+int expected_income(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;
+template <std::size_t N>
+int interest_to_pay(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;
+
+template <std::size_t N>
+int max_secured_debt(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;
+template <std::size_t N>
+int max_unsecured_debt(const BasicPlayer<N>&, const BasicGame<N>&) noexcept;
 
 // Checking functions ---------------------------------------------------------
 
+// What a game function did, or why it couldn't. Carries only a code and its
+// arguments, so checking a Result never allocates. It is put into words only
+// when somebody asks for its description.
 struct Result {
-    Result(bool result, std::string description = "")
-        : result_{result}, description_{description}
+    enum class Code : std::uint8_t {
+        none,
+        // Made from text, rather than by a game function
+        text,
+
+        // Reasons for failing
+        not_enough_cash, cannot_pay_interest, property_not_available, property_not_owned,
+        already_mortgaged, not_mortgaged, no_properties_selected, cannot_build_on_stations,
+        cannot_build_on_utilities, set_not_owned, too_many_houses, too_few_houses,
+        properties_not_owned, houses_on_properties, too_much_secured_debt,
+        too_much_unsecured_debt, overpaying_debt, debt_not_owed, empty_trade,
+
+        // Things done
+        raised_interest, lowered_interest, passed_go, bought_property, sold_property,
+        mortgaged, unmortgaged, built_houses, sold_houses, paid_repairs, paid_to_bank,
+        paid_to_player, transferred, took_out_secured_debt, took_out_unsecured_debt,
+        paid_off_secured_debt, paid_off_unsecured_debt, conceded_to_player, conceded_to_bank,
+        traded,
+    };
+
+    // Whatever the code needs to be described
+    struct Args {
+        unsigned player = 0;
+        unsigned other_player = 0;
+        unsigned property = 0;
+        int amount = 0;
+        int limit = 0;
+        BasicPropertySet<max_board_properties> properties = 0;
+    };
+
+    Result(bool result, Code code = Code::none) noexcept
+        : result_{result}, code_{code}
+    {}
+
+    Result(bool result, Code code, Args args) noexcept
+        : result_{result}, code_{code}, args_{args}
+    {}
+
+    Result(bool result, std::string text)
+        : result_{result}, code_{Code::text}, text_{std::move(text)}
     {}
 
     constexpr operator bool() const noexcept {
         return result_;
     }
 
-    const std::string& description() const noexcept {
-        return description_;
+    Code code() const noexcept { return code_; }
+    const Args& args() const noexcept { return args_; }
+
+    // In words, naming the players and properties from the game. Any version
+    // of the game the result came from will do, as names never change.
+    template <std::size_t N>
+    std::string description(const BasicGame<N>&) const;
+
+    // The description of a result made from text, such as those returned by
+    // the servers, which have already been put into words
+    const std::string& text() const noexcept {
+        assert(code_ == Code::text || code_ == Code::none);
+        return text_;
     }
 private:
     bool result_;
-    std::string description_;
+    Code code_;
+    Args args_ = {};
+    std::string text_ = {};
 };
 
+// Each major function below has a matching check, which says whether it
+// would succeed without changing anything
+
+template <std::size_t N>
+Result can_raise_interest(const BasicGame<N>& game);
+template <std::size_t N>
+Result can_lower_interest(const BasicGame<N>& game);
+template <std::size_t N>
+Result can_passgo(const BasicGame<N>& game, unsigned player);
+template <std::size_t N>
+Result can_buy_property(const BasicGame<N>& game, unsigned player, unsigned property, int price);
+template <std::size_t N>
+Result can_sell_property(const BasicGame<N>& game, unsigned player, unsigned property);
+template <std::size_t N>
+Result can_mortgage(const BasicGame<N>& game, unsigned player, unsigned property);
+template <std::size_t N>
+Result can_unmortgage(const BasicGame<N>& game, unsigned player, unsigned property);
+template <std::size_t N>
+Result can_build_houses(const BasicGame<N>& game, unsigned player, PropertySetOf<N> set, int number);
+template <std::size_t N>
+Result can_sell_houses(const BasicGame<N>& game, unsigned player, PropertySetOf<N> set, int number);
+template <std::size_t N>
+Result can_pay_repairs(const BasicGame<N>& game, unsigned player, int cost_per_house, int cost_per_hotel);
+template <std::size_t N>
+Result can_pay_to_bank(const BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result can_pay_to_player(const BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result can_transfer(const BasicGame<N>& game, unsigned from_player, unsigned to_player, int amount,
+                    PropertySetOf<N> properties);
+template <std::size_t N>
+Result can_take_out_secured_debt(const BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result can_take_out_unsecured_debt(const BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result can_pay_off_secured_debt(const BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result can_pay_off_unsecured_debt(const BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result can_concede_to_player(const BasicGame<N>& game, unsigned loser, unsigned victor);
+template <std::size_t N>
+Result can_concede_to_bank(const BasicGame<N>& game, unsigned player);
+template <std::size_t N>
+Result can_trade(const BasicGame<N>& game, const BasicTrade<N>& deal);
+
 // Major functions ------------------------------------------------------------
 
 // TODO more control over house building functions
 
-Result raise_interest(Game& game);
-Result lower_interest(Game& game);
-Result passgo(Game& game, unsigned player);
-Result buy_property(Game& game, unsigned player, unsigned property, int price);
-Result sell_property(Game& game, unsigned player, unsigned property);
-Result mortgage(Game& game, unsigned player, unsigned property);
-Result unmortgage(Game& game, unsigned player, unsigned property);
-Result build_houses(Game& game, unsigned player, PropertySet set, int number);
-Result sell_houses(Game& game, unsigned player, PropertySet set, int number);
-Result pay_repairs(Game& game, unsigned player, int cost_per_house, int cost_per_hotel);
-Result pay_to_bank(Game& game, unsigned player, int amount);
-Result pay_to_player(Game& game, unsigned player, int amount);
-Result transfer(Game& game, unsigned from_player, unsigned to_player, int amount,
-                PropertySet properties);
-Result take_out_secured_debt(Game& game, unsigned player, int amount);
-Result take_out_unsecured_debt(Game& game, unsigned player, int amount);
-Result pay_off_secured_debt(Game& game, unsigned player, int amount);
-Result pay_off_unsecured_debt(Game& game, unsigned player, int amount);
-Result concede_to_player(Game& game, unsigned loser, unsigned victor);
-Result concede_to_bank(Game& game, unsigned player);
+template <std::size_t N>
+Result raise_interest(BasicGame<N>& game);
+template <std::size_t N>
+Result lower_interest(BasicGame<N>& game);
+template <std::size_t N>
+Result passgo(BasicGame<N>& game, unsigned player);
+template <std::size_t N>
+Result buy_property(BasicGame<N>& game, unsigned player, unsigned property, int price);
+template <std::size_t N>
+Result sell_property(BasicGame<N>& game, unsigned player, unsigned property);
+template <std::size_t N>
+Result mortgage(BasicGame<N>& game, unsigned player, unsigned property);
+template <std::size_t N>
+Result unmortgage(BasicGame<N>& game, unsigned player, unsigned property);
+template <std::size_t N>
+Result build_houses(BasicGame<N>& game, unsigned player, PropertySetOf<N> set, int number);
+template <std::size_t N>
+Result sell_houses(BasicGame<N>& game, unsigned player, PropertySetOf<N> set, int number);
+template <std::size_t N>
+Result pay_repairs(BasicGame<N>& game, unsigned player, int cost_per_house, int cost_per_hotel);
+template <std::size_t N>
+Result pay_to_bank(BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result pay_to_player(BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result transfer(BasicGame<N>& game, unsigned from_player, unsigned to_player, int amount,
+                PropertySetOf<N> properties);
+template <std::size_t N>
+Result take_out_secured_debt(BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result take_out_unsecured_debt(BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result pay_off_secured_debt(BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result pay_off_unsecured_debt(BasicGame<N>& game, unsigned player, int amount);
+template <std::size_t N>
+Result concede_to_player(BasicGame<N>& game, unsigned loser, unsigned victor);
+template <std::size_t N>
+Result concede_to_bank(BasicGame<N>& game, unsigned player);
+// Every leg of the trade or none of them
+template <std::size_t N>
+Result trade(BasicGame<N>& game, const BasicTrade<N>& deal);
+
+// Accounting functions -------------------------------------------------------
+
+// Approximate number of bytes used by a game, including heap allocations.
+// The ruleset it is played with is shared, so isn't included.
+template <std::size_t N>
+std::size_t memory_usage(const BasicGame<N>&) noexcept;
+template <std::size_t N>
+std::size_t memory_usage(const BasicRuleset<N>&) noexcept;
 
@@ -0,0 +1,292 @@
+#include "game_batch.h"
+
+#include <algorithm>
+
+// The kernels are compiled for AVX2, SSE4.1 and plain scalar code, and the
+// best the machine running them supports is picked at run time, so the
+// program itself can be built for any x86-64. Only GCC on x86 gets the
+// vector versions.
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define GAME_BATCH_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+
+static_assert(sizeof(int) == sizeof(std::int32_t));
+
+// Widest vector of any instruction set, which every column is padded to
+constexpr unsigned max_width = 8;
+
+constexpr double ratio_scale = Ratio::scale;
+constexpr double income_scale = landing_weight_scale;
+
+// One instruction set's kernels, see game_batch_kernels.h
+struct Kernels {
+    const char* name;
+    unsigned width;
+    void (*asset_value)(std::size_t, const std::int32_t*, const double*, std::int32_t*);
+    void (*expected_income)(std::size_t, const std::int32_t*, std::int32_t*);
+    void (*interest_to_pay)(std::size_t, const std::int32_t*, const std::int32_t*,
+                            const std::int32_t*, const std::int32_t*, std::int32_t*);
+    void (*max_secured_debt)(std::size_t, const std::int32_t*, const double*,
+                             const std::int32_t*, const std::int32_t*, const std::int32_t*,
+                             std::int32_t*);
+};
+
+// Each instruction set defines a vector of 32 bit ints with the same
+// interface, then includes the kernels written against it
+
+namespace scalar {
+
+struct Vec {
+    static constexpr unsigned width = 1;
+    static constexpr const char* name = "scalar";
+
+    std::int32_t v;
+
+    static Vec load(const std::int32_t* p) { return {*p}; }
+    void store(std::int32_t* p) const { *p = v; }
+    static Vec broadcast(std::int32_t x) { return {x}; }
+};
+
+Vec operator+(Vec a, Vec b) { return {a.v + b.v}; }
+Vec operator*(Vec a, Vec b) { return {a.v * b.v}; }
+Vec min(Vec a, Vec b) { return {a.v < b.v ? a.v : b.v}; }
+
+Vec mul_div_trunc(Vec x, const double* m, double d)
+{
+    return {static_cast<std::int32_t>(x.v * *m / d)};
+}
+
+Vec div_trunc(Vec x, double d) { return {static_cast<std::int32_t>(x.v / d)}; }
+
+#include "game_batch_kernels.h"
+
+}
+
+#ifdef GAME_BATCH_DISPATCH
+
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+
+namespace sse41 {
+
+struct Vec {
+    static constexpr unsigned width = 4;
+    static constexpr const char* name = "sse4.1";
+
+    __m128i v;
+
+    static Vec load(const std::int32_t* p) {
+        return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))};
+    }
+    void store(std::int32_t* p) const {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    }
+    static Vec broadcast(std::int32_t x) { return {_mm_set1_epi32(x)}; }
+};
+
+Vec operator+(Vec a, Vec b) { return {_mm_add_epi32(a.v, b.v)}; }
+Vec operator*(Vec a, Vec b) { return {_mm_mullo_epi32(a.v, b.v)}; }
+Vec min(Vec a, Vec b) { return {_mm_min_epi32(a.v, b.v)}; }
+
+// Each lane of x times each of m, divided by d and rounded towards zero. Both
+// the product and the quotient are exact in double precision for the values
+// used here, so this is the same as integer arithmetic.
+Vec mul_div_trunc(Vec x, const double* m, double d)
+{
+    const __m128d div = _mm_set1_pd(d);
+    const __m128d lo = _mm_div_pd(_mm_mul_pd(_mm_cvtepi32_pd(x.v), _mm_loadu_pd(m)), div);
+    const __m128d hi = _mm_div_pd(
+        _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(x.v, x.v)), _mm_loadu_pd(m + 2)), div);
+    return {_mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi))};
+}
+
+// x / d rounded towards zero, the same as integer division
+Vec div_trunc(Vec x, double d)
+{
+    const __m128d div = _mm_set1_pd(d);
+    const __m128d lo = _mm_div_pd(_mm_cvtepi32_pd(x.v), div);
+    const __m128d hi = _mm_div_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(x.v, x.v)), div);
+    return {_mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi))};
+}
+
+#include "game_batch_kernels.h"
+
+}
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+namespace avx2 {
+
+struct Vec {
+    static constexpr unsigned width = 8;
+    static constexpr const char* name = "avx2";
+
+    __m256i v;
+
+    static Vec load(const std::int32_t* p) {
+        return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))};
+    }
+    void store(std::int32_t* p) const {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+    static Vec broadcast(std::int32_t x) { return {_mm256_set1_epi32(x)}; }
+};
+
+Vec operator+(Vec a, Vec b) { return {_mm256_add_epi32(a.v, b.v)}; }
+Vec operator*(Vec a, Vec b) { return {_mm256_mullo_epi32(a.v, b.v)}; }
+Vec min(Vec a, Vec b) { return {_mm256_min_epi32(a.v, b.v)}; }
+
+Vec mul_div_trunc(Vec x, const double* m, double d)
+{
+    const __m256d div = _mm256_set1_pd(d);
+    const __m256d lo = _mm256_div_pd(
+        _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x.v)), _mm256_loadu_pd(m)), div);
+    const __m256d hi = _mm256_div_pd(
+        _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x.v, 1)), _mm256_loadu_pd(m + 4)),
+        div);
+    return {_mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(lo)),
+                                    _mm256_cvttpd_epi32(hi), 1)};
+}
+
+Vec div_trunc(Vec x, double d)
+{
+    const __m256d div = _mm256_set1_pd(d);
+    const __m256d lo = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x.v)), div);
+    const __m256d hi = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x.v, 1)), div);
+    return {_mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(lo)),
+                                    _mm256_cvttpd_epi32(hi), 1)};
+}
+
+#include "game_batch_kernels.h"
+
+}
+
+#pragma GCC pop_options
+
+#endif
+
+// The widest kernels this machine can run, picked the first time any are
+const Kernels& best_kernels()
+{
+    static const Kernels& kernels = [] () -> const Kernels& {
+#ifdef GAME_BATCH_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return avx2::kernels;
+        if (__builtin_cpu_supports("sse4.1")) return sse41::kernels;
+#endif
+        return scalar::kernels;
+    }();
+    return kernels;
+}
+
+std::size_t padded(std::size_t lanes)
+{
+    return (lanes + max_width - 1) / max_width * max_width;
+}
+
+}
+
+// Filling the batch ----------------------------------------------------------
+
+template <typename F>
+void GameBatch::for_each_column(F function)
+{
+    for (auto* column : {&guide_price_, &weighted_income_, &secured_debt_, &unsecured_debt_,
+                         &salary_, &secured_interest_, &unsecured_interest_,
+                         &secured_debt_salaries_}) {
+        function(*column);
+    }
+    function(ppi_);
+}
+
+unsigned GameBatch::add(const Game& game)
+{
+    const unsigned first_lane = lanes_;
+    lanes_ += game.num_players();
+
+    const auto size = padded(lanes_);
+    this->for_each_column([size](auto& column) { column.resize(size, 0); });
+
+    this->write(first_lane, game);
+    return first_lane;
+}
+
+void GameBatch::update(unsigned first_lane, const Game& game)
+{
+    assert(first_lane + game.num_players() <= lanes_);
+    this->write(first_lane, game);
+}
+
+void GameBatch::clear()
+{
+    lanes_ = 0;
+    this->for_each_column([](auto& column) { column.clear(); });
+}
+
+void GameBatch::write(unsigned first_lane, const Game& game)
+{
+    for (unsigned player_id = 0; player_id < game.num_players(); ++player_id) {
+        const auto& player = game.player(player_id);
+        const unsigned lane = first_lane + player_id;
+
+        guide_price_[lane] = player.totals().guide_price;
+        weighted_income_[lane] = player.totals().weighted_income;
+        secured_debt_[lane] = player.secured_debt;
+        unsecured_debt_[lane] = player.unsecured_debt;
+        salary_[lane] = player.salary;
+        ppi_[lane] = game.ppi.raw();
+        secured_interest_[lane] = game.secured_interest();
+        unsecured_interest_[lane] = game.unsecured_interest();
+        secured_debt_salaries_[lane] = game.rules().secured_debt_salaries;
+    }
+}
+
+// Kernels --------------------------------------------------------------------
+
+void GameBatch::asset_value(std::vector<int>& out) const
+{
+    out.resize(padded(lanes_));
+    best_kernels().asset_value(lanes_, guide_price_.data(), ppi_.data(), out.data());
+    out.resize(lanes_);
+}
+
+void GameBatch::expected_income(std::vector<int>& out) const
+{
+    out.resize(padded(lanes_));
+    best_kernels().expected_income(lanes_, weighted_income_.data(), out.data());
+    out.resize(lanes_);
+}
+
+void GameBatch::interest_to_pay(std::vector<int>& out) const
+{
+    out.resize(padded(lanes_));
+    best_kernels().interest_to_pay(lanes_, secured_debt_.data(), secured_interest_.data(),
+                                   unsecured_debt_.data(), unsecured_interest_.data(),
+                                   out.data());
+    out.resize(lanes_);
+}
+
+void GameBatch::max_secured_debt(std::vector<int>& out) const
+{
+    out.resize(padded(lanes_));
+    best_kernels().max_secured_debt(lanes_, guide_price_.data(), ppi_.data(),
+                                    weighted_income_.data(), secured_debt_salaries_.data(),
+                                    salary_.data(), out.data());
+    out.resize(lanes_);
+}
+
+const char* GameBatch::instruction_set() noexcept
+{
+    return best_kernels().name;
+}
+
+unsigned GameBatch::width() noexcept
+{
+    return best_kernels().width;
+}
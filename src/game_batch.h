@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+// Many games side by side, one lane per player of every game, laid out as
+// structure of arrays so the information functions from game.cpp can be
+// evaluated for every lane in one vectorised pass. Gives exactly the same
+// answers as calling the scalar functions on each player.
+//
+// Each lane holds the player's property totals, as the scalar functions read
+// them, rather than the properties themselves, so a kernel is a few
+// arithmetic operations on contiguous columns.
+struct GameBatch {
+    // Add every player of the game, returning the lane of its first player
+    unsigned add(const Game&);
+    // Overwrite the lanes of a game previously added at first_lane
+    void update(unsigned first_lane, const Game&);
+    void clear();
+
+    // Number of lanes
+    std::size_t size() const noexcept { return lanes_; }
+
+    // Each of these writes one value per lane to out, resizing it to size()
+    void asset_value(std::vector<int>& out) const;
+    void expected_income(std::vector<int>& out) const;
+    void interest_to_pay(std::vector<int>& out) const;
+    void max_secured_debt(std::vector<int>& out) const;
+
+    // Instruction set of the kernels picked for this machine: "avx2",
+    // "sse4.1" or "scalar"
+    static const char* instruction_set() noexcept;
+    // Lanes evaluated together
+    static unsigned width() noexcept;
+private:
+    void write(unsigned first_lane, const Game&);
+    // Calls the function on every column, which are all resized together
+    template <typename F>
+    void for_each_column(F);
+
+    std::size_t lanes_ = 0;
+
+    // Per lane, padded with zeros to a whole number of vectors
+    std::vector<std::int32_t> guide_price_;
+    std::vector<std::int32_t> weighted_income_;
+    std::vector<std::int32_t> secured_debt_;
+    std::vector<std::int32_t> unsecured_debt_;
+    std::vector<std::int32_t> salary_;
+    // Raw fixed point ppi, held as doubles as it is multiplied in double precision
+    std::vector<double> ppi_;
+    std::vector<std::int32_t> secured_interest_;
+    std::vector<std::int32_t> unsecured_interest_;
+    std::vector<std::int32_t> secured_debt_salaries_;
+};
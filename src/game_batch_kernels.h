@@ -0,0 +1,54 @@
+// The GameBatch kernels, written once against a Vec type with mul_div_trunc
+// and div_trunc. game_batch.cpp includes this once per instruction set,
+// inside a namespace defining those for it and compiled for it, so there is
+// deliberately no include guard. Use nothing from outside that namespace
+// that could be compiled here, or code for one instruction set could end up
+// shared with the rest of the program.
+//
+// Each mirrors the scalar function of the same name in game.cpp, operation
+// for operation, so that rounding and overflow behave identically. Columns
+// are padded to a whole number of vectors.
+
+void asset_value(std::size_t lanes, const std::int32_t* guide_price, const double* ppi,
+                 std::int32_t* out)
+{
+    for (std::size_t lane = 0; lane < lanes; lane += Vec::width) {
+        mul_div_trunc(Vec::load(guide_price + lane), ppi + lane, ratio_scale).store(out + lane);
+    }
+}
+
+void expected_income(std::size_t lanes, const std::int32_t* weighted_income, std::int32_t* out)
+{
+    for (std::size_t lane = 0; lane < lanes; lane += Vec::width) {
+        div_trunc(Vec::load(weighted_income + lane), income_scale).store(out + lane);
+    }
+}
+
+void interest_to_pay(std::size_t lanes, const std::int32_t* secured_debt,
+                     const std::int32_t* secured_interest, const std::int32_t* unsecured_debt,
+                     const std::int32_t* unsecured_interest, std::int32_t* out)
+{
+    for (std::size_t lane = 0; lane < lanes; lane += Vec::width) {
+        const Vec secured = Vec::load(secured_debt + lane) * Vec::load(secured_interest + lane);
+        const Vec unsecured
+            = Vec::load(unsecured_debt + lane) * Vec::load(unsecured_interest + lane);
+        div_trunc(secured + unsecured, 100).store(out + lane);
+    }
+}
+
+// In one pass, rather than going through memory for income and assets
+void max_secured_debt(std::size_t lanes, const std::int32_t* guide_price, const double* ppi,
+                      const std::int32_t* weighted_income,
+                      const std::int32_t* secured_debt_salaries, const std::int32_t* salary,
+                      std::int32_t* out)
+{
+    for (std::size_t lane = 0; lane < lanes; lane += Vec::width) {
+        const Vec income = div_trunc(Vec::load(weighted_income + lane), income_scale);
+        const Vec assets = mul_div_trunc(Vec::load(guide_price + lane), ppi + lane, ratio_scale);
+        (Vec::load(secured_debt_salaries + lane) * Vec::load(salary + lane)
+         + min(Vec::broadcast(3) * income, assets)).store(out + lane);
+    }
+}
+
+const Kernels kernels = {Vec::name, Vec::width, asset_value, expected_income, interest_to_pay,
+                         max_secured_debt};
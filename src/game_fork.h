@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "event.h"
+#include "game.h"
+#include "memory_usage.h"
+
+// A private copy of a game to try things out on, such as a big build or a
+// trade, before doing them for real. The game it was forked from is shared
+// with the history and every other fork of it, and is only copied the first
+// time the fork changes. An unused fork costs a pointer, a used one a single
+// game plus the descriptions of what was done to it.
+struct GameFork {
+    explicit GameFork(std::shared_ptr<const Game> base)
+        : base_{std::move(base)}
+    {
+        assert(base_);
+    }
+
+    const Game& game() const noexcept { return game_ ? *game_ : *base_; }
+
+    // The game as it was when forked, which merging checks is still current
+    const std::shared_ptr<const Game>& base() const noexcept { return base_; }
+
+    bool changed() const noexcept { return !descriptions_.empty(); }
+
+    // Returns the result already put into words, like GameHistory::apply.
+    // Copies the base the first time only, then changes the copy in place,
+    // as game functions leave the game alone when they fail.
+    Result apply(const GameEvent& event) {
+        const bool first = !game_;
+        if (first) game_ = std::make_unique<Game>(*base_);
+        const auto result = event.function()(*game_);
+        assert(game_->hash_valid());
+        auto description = result.description(*game_);
+
+        if (result) {
+            descriptions_.push_back(description);
+        } else if (first) {
+            game_.reset();
+        }
+        return {bool(result), std::move(description)};
+    }
+
+    // Back to the game as it was forked, dropping the copy
+    void reset() noexcept {
+        game_.reset();
+        descriptions_.clear();
+    }
+
+    // What has been done to the fork, in order
+    const std::vector<std::string>& descriptions() const noexcept { return descriptions_; }
+
+    // Bytes used by the fork itself, not counting the shared base
+    std::size_t memory_usage() const noexcept {
+        std::size_t bytes = sizeof(GameFork) + heap_usage(descriptions_);
+        if (game_) bytes += ::memory_usage(*game_);
+        for (const auto& description : descriptions_) bytes += heap_usage(description);
+        return bytes;
+    }
+private:
+    std::shared_ptr<const Game> base_;
+    // Only once the fork has changed
+    std::unique_ptr<Game> game_;
+    std::vector<std::string> descriptions_;
+};
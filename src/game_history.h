@@ -1,84 +1,174 @@
 #pragma once
 
 #include "game.h"
+#include "game_fork.h"
 #include "event.h"
+#include "memory_usage.h"
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <cassert>
 
+// Games in the history are never changed once stored, so forks can share
+// them. Changing the current game stores a new one.
 struct GameHistory {
     GameHistory(const Game& game)
     {
-        history_[0] = game;
+        history_[0] = std::make_shared<const Game>(game);
         descriptions_[0] = "Game started";
     }
     GameHistory(Game&& game = Game())
     {
-        history_[0] = std::move(game);
+        history_[0] = std::make_shared<const Game>(std::move(game));
         descriptions_[0] = "Game started";
     }
 
-    Game& current_game() noexcept
+    const Game& current_game() const noexcept
     {
-        return history_[current_game_index_];
+        return *history_[current_game_index_];
     }
-    const Game& current_game() const noexcept
+
+    // A fork of the current game, sharing it rather than copying it
+    GameFork fork() const
     {
-        return history_[current_game_index_];
+        return GameFork{history_[current_game_index_]};
     }
 
     // Adding a player resets the undo/redo for now
     void add_player(const AddPlayerEvent& event) {
         assert(event.player_id == this->current_game().num_players());
 
-        history_[current_game_index_].add_player(event.name);
+        // Copied, as forks may be sharing the current game
+        auto game = std::make_shared<Game>(this->current_game());
+        game->add_player(event.name);
+        history_[current_game_index_] = std::move(game);
         descriptions_[current_game_index_] = "Player " + event.name + " added to game";
 
         past_games_ = 0;
         future_games_ = 0;
     }
 
+    // Properties nobody can take until they're released, such as one being
+    // auctioned. Any step that would give one of them an owner is refused,
+    // whether it's an event, an undo, a redo or a merge.
+    void reserve(Game::Set properties) noexcept { reserved_ |= properties; }
+    void release(Game::Set properties) noexcept { reserved_ &= ~properties; }
+    Game::Set reserved() const noexcept { return reserved_; }
+
+    // Returns the result already put into words, as the game it refers to
+    // may have moved on by the time anyone reads it
     Result apply(const GameEvent& event) {
-        Game new_game = history_[current_game_index_];
+        Game new_game = this->current_game();
         const auto result = event.function()(new_game);
+        assert(new_game.hash_valid());
+        if (result) {
+            const auto reserved = this->check_reserved(new_game);
+            if (!reserved) return {false, reserved.description(new_game)};
+        }
+        auto description = result.description(new_game);
 
         if (result) {
-            current_game_index_ = (current_game_index_ + 1) % games_stored;
-            history_[current_game_index_] = std::move(new_game);
-            descriptions_[current_game_index_] = result.description();
+            this->push(std::make_shared<const Game>(std::move(new_game)), description);
+        }
 
-            past_games_ = std::min(past_games_ + 1, games_stored - 1);
-            future_games_ = 0;
+        return {bool(result), std::move(description)};
+    }
+
+    // Everything done on the fork becomes a single step, which one undo
+    // takes back. Refused if the current game isn't the one the fork was
+    // made from, as the fork's changes would then undo whatever happened
+    // in between.
+    Result merge(const GameFork& fork) {
+        if (!fork.changed()) return {false, "Nothing has been tried out to keep"};
+        if (fork.base() != history_[current_game_index_]) {
+            return {false, "The game has moved on since this was tried out"};
         }
 
-        return result;
+        const auto reserved = this->check_reserved(fork.game());
+        if (!reserved) return {false, reserved.description(fork.game())};
+
+        std::string description = "Kept what was tried out:";
+        for (const auto& step : fork.descriptions()) description += " " + step + ".";
+
+        this->push(std::make_shared<const Game>(fork.game()), description);
+        return {true, std::move(description)};
     }
 
-    Result undo() noexcept {
+    Result undo() {
         if (past_games_ == 0) return {false, "Cannot undo here"};
 
-        auto description = "Undo: " + descriptions_[current_game_index_];
-        current_game_index_ =
+        const unsigned previous_index =
             (current_game_index_ > 0 ? current_game_index_ - 1 : games_stored - 1);
+        const auto reserved = this->check_reserved(*history_[previous_index]);
+        if (!reserved) return {false, reserved.description(*history_[previous_index])};
+
+        auto description = "Undo: " + descriptions_[current_game_index_];
+        current_game_index_ = previous_index;
         --past_games_;
         ++future_games_;
         return {true, std::move(description)};
     }
 
-    Result redo() noexcept {
+    Result redo() {
         if (future_games_ == 0) return {false, "Cannot redo here"};
 
-        current_game_index_ = (current_game_index_ + 1) % games_stored;
+        const unsigned next_index = (current_game_index_ + 1) % games_stored;
+        const auto reserved = this->check_reserved(*history_[next_index]);
+        if (!reserved) return {false, reserved.description(*history_[next_index])};
+
+        current_game_index_ = next_index;
         ++past_games_;
         --future_games_;
 
         auto description = "Redo: " + descriptions_[current_game_index_];
         return {true, std::move(description)};
     }
+
+    // Bytes used by the stored games and by their descriptions respectively
+    std::size_t history_memory_usage() const noexcept {
+        // memory_usage(game) already includes sizeof(Game)
+        std::size_t bytes = heap_usage(history_);
+        for (const auto& game : history_) {
+            if (game) bytes += memory_usage(*game) + shared_control_block_size;
+        }
+        return bytes;
+    }
+    std::size_t description_memory_usage() const noexcept {
+        std::size_t bytes = heap_usage(descriptions_);
+        for (const auto& description : descriptions_) bytes += heap_usage(description);
+        return bytes;
+    }
 private:
     static const unsigned games_stored = 100;
+    // Reference counts stored alongside each game by make_shared
+    static constexpr std::size_t shared_control_block_size = 2 * sizeof(long) + sizeof(void*);
+
+    // Fails if the game gives an owner to a reserved property that the
+    // current game doesn't
+    Result check_reserved(const Game& game) const noexcept {
+        Game::Set owned;
+        for (const auto& player : game.players()) owned |= player.properties;
+        for (const auto& player : this->current_game().players()) owned &= ~player.properties;
+        owned &= reserved_;
+        if (owned.none()) return true;
+
+        unsigned property_id = 0;
+        for_each_property_id(owned, [&property_id](unsigned id) { property_id = id; });
+        return {false, Result::Code::property_not_available, {0, 0, property_id}};
+    }
 
-    std::vector<Game> history_ = std::vector<Game>(games_stored);
+    void push(std::shared_ptr<const Game> game, const std::string& description) {
+        current_game_index_ = (current_game_index_ + 1) % games_stored;
+        history_[current_game_index_] = std::move(game);
+        descriptions_[current_game_index_] = description;
+
+        past_games_ = std::min(past_games_ + 1, games_stored - 1);
+        future_games_ = 0;
+    }
+
+    // Empty until used
+    std::vector<std::shared_ptr<const Game>> history_
+        = std::vector<std::shared_ptr<const Game>>(games_stored);
 
     // Description of the event that resulted in that game
     std::vector<std::string> descriptions_ = std::vector<std::string>(games_stored);
@@ -86,5 +176,7 @@ private:
     unsigned current_game_index_ = 0;
     unsigned past_games_ = 0;
     unsigned future_games_ = 0;
+
+    Game::Set reserved_;
 };
 
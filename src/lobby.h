@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// What the lobby shows about a game. Each game replaces its summary whenever
+// the game or its clients change, and never changes one once made, so the
+// lobby can read them without taking any game's lock.
+struct GameSummary {
+    std::string name;
+    std::string ruleset;
+    unsigned players = 0;
+    unsigned clients = 0;
+    std::chrono::system_clock::time_point created;
+    // The player with the highest net worth (cash and assets less debt), empty
+    // if there are no players
+    std::string leader;
+    int leader_net_worth = 0;
+};
+
+// Summaries of every game at one moment, most active first
+struct LobbySnapshot {
+    std::chrono::steady_clock::time_point taken;
+    std::vector<std::shared_ptr<const GameSummary>> games;
+};
+
+// Part of a snapshot, for showing a page at a time
+struct LobbyPage {
+    std::vector<std::shared_ptr<const GameSummary>> games;
+    // Index of the first game on the page, and the number of games in all
+    std::size_t first = 0;
+    std::size_t total = 0;
+    std::chrono::steady_clock::time_point taken;
+};
+
+// Orders games by how many people are there, then by name
+inline bool more_active(const GameSummary& a, const GameSummary& b) noexcept
+{
+    if (a.clients != b.clients) return a.clients > b.clients;
+    if (a.players != b.players) return a.players > b.players;
+    return a.name < b.name;
+}
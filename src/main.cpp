@@ -15,6 +15,7 @@
 #include "servers.h"
 #include "event.h"
 #include "widgets.h"
+#include "metrics.h"
 
 namespace Const {
     const char* proper_name = "Modified Monopoly";
@@ -35,14 +36,18 @@ struct Application : Wt::WApplication {
         this->root()->addWidget(std::make_unique<Wt::WBreak>());
 
         const auto login_function = [this](LoginWidget* lw) {
-            game_server_ = server_.login(lw->game_name());
+            game_server_ = server_.login(lw->game_name(), lw->ruleset_name());
+            if (!game_server_) {
+                lw->bad_login();
+                return;
+            }
 
             const bool banker = lw->banker();
             const bool player = !lw->user_name().empty();
             const GameWidget::Type type = banker * GameWidget::Type::banker
                                           | player * GameWidget::Type::player;
 
-            int player_id = 0;
+            unsigned player_id = 0;
 
             if (player) {
                 const std::optional<int> id
@@ -56,24 +61,42 @@ struct Application : Wt::WApplication {
 
             game_widget_ = this->root()->addWidget(
                 std::make_unique<GameWidget>(*game_server_, type, player_id));
-            game_server_->connect(game_widget_);
+            game_widget_->connect(player ? game_server_->resume_cursor(player_id) : 0);
+            if (player) player_id_ = player_id;
             lw->hide();
+            lobby_widget_->hide();
         };
 
-        login_widget_ = this->root()->addWidget(std::make_unique<LoginWidget>(login_function));
+        login_widget_ = this->root()->addWidget(
+            std::make_unique<LoginWidget>(login_function, server_.rulesets().names()));
+        lobby_widget_ = this->root()->addWidget(std::make_unique<LobbyWidget>(
+            server_, [this](const std::string& name) { login_widget_->set_game_name(name); }));
+    }
+
+    // Called however the session ends, including when the browser window is
+    // closed and the session times out, while the widgets still exist
+    void finalize() override
+    {
+        if (!game_server_ || !game_widget_) return;
+        game_server_->disconnect(game_widget_);
+        if (player_id_) game_server_->logout(*player_id_);
     }
 private:
     MainServer& server_;
     GameServer* game_server_ = nullptr;
+    std::optional<unsigned> player_id_ = {};
 
     LoginWidget* login_widget_ = nullptr;
+    LobbyWidget* lobby_widget_ = nullptr;
     GameWidget* game_widget_ = nullptr;
 };
 
 int main(int argc, char** argv)
 try {
     Wt::WServer wserver(argc, argv, WTHTTP_CONFIGURATION);
-    MainServer main_server{wserver};
+    MainServer main_server{wserver, "rulesets", "chat"};
+    MetricsResource metrics{main_server};
+    wserver.addResource(&metrics, "/metrics");
 
     std::thread thread([&main_server] { main_server.interaction_loop(); });
 
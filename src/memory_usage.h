@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Helpers for explicit memory accounting. These only count memory owned
+// through the heap, the caller is responsible for adding sizeof(object).
+
+inline std::size_t heap_usage(const std::string& s) noexcept
+{
+    // Short strings live in the string object itself and don't allocate
+    static const std::size_t small_string_capacity = std::string().capacity();
+    return s.capacity() > small_string_capacity ? s.capacity() + 1 : 0;
+}
+
+template <typename T>
+std::size_t heap_usage(const std::vector<T>& v) noexcept
+{
+    return v.capacity() * sizeof(T);
+}
+
+// Rough per-node overhead of node based containers (std::map, std::set),
+// three pointers and a colour for a red-black tree
+constexpr std::size_t tree_node_overhead = 4 * sizeof(void*);
+
+// Memory used by a single client session, as reported by the session itself
+struct SessionMemoryUsage {
+    std::size_t widgets = 0;
+    std::size_t message_lines = 0;
+    std::size_t message_bytes = 0;
+};
@@ -0,0 +1,63 @@
+#include "metrics.h"
+
+#include "servers.h"
+
+namespace {
+    // Game names are made up by users, so may hold anything
+    std::string escape(const std::string& value)
+    {
+        std::string escaped;
+        for (const char c : value) {
+            switch (c) {
+                case '\\': escaped += "\\\\"; break;
+                case '"': escaped += "\\\""; break;
+                case '\n': escaped += "\\n"; break;
+                default: escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    std::string labels(const std::string& game, const std::string& key,
+                       const std::string& value)
+    {
+        return "{game=\"" + escape(game) + "\"," + key + "=\"" + escape(value) + "\"}";
+    }
+}
+
+void MetricsResource::handleRequest(const Wt::Http::Request&, Wt::Http::Response& response)
+{
+    response.setMimeType("text/plain");
+    auto& out = response.out();
+
+    server_.for_each_game_server([&out](GameServer& server) {
+        const auto& name = server.name();
+        const auto usage = server.memory_usage();
+
+        out << "monopoly_game_memory_bytes" << labels(name, "part", "history") << ' '
+            << usage.history << '\n'
+            << "monopoly_game_memory_bytes" << labels(name, "part", "descriptions") << ' '
+            << usage.descriptions << '\n'
+            << "monopoly_game_memory_bytes" << labels(name, "part", "clients") << ' '
+            << usage.clients << '\n'
+            << "monopoly_game_memory_bytes" << labels(name, "part", "message_log") << ' '
+            << usage.message_log << '\n'
+            << "monopoly_game_memory_bytes" << labels(name, "part", "replay") << ' '
+            << usage.replay << '\n'
+            << "monopoly_game_memory_bytes" << labels(name, "part", "outboxes") << ' '
+            << usage.outboxes << '\n'
+            << "monopoly_game_memory_bytes" << labels(name, "part", "chat") << ' '
+            << usage.chat << '\n';
+
+        // Numbered rather than named by session id, which would let anyone
+        // who can see the metrics take the session over
+        for (const auto& [number, session] : server.session_memory_usage()) {
+            const auto session_labels = labels(name, "session", std::to_string(number));
+            out << "monopoly_session_widgets" << session_labels << ' ' << session.widgets << '\n'
+                << "monopoly_session_message_lines" << session_labels << ' '
+                << session.message_lines << '\n'
+                << "monopoly_session_message_bytes" << session_labels << ' '
+                << session.message_bytes << '\n';
+        }
+    });
+}
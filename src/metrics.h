@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Wt/WResource.h>
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+
+struct MainServer;
+
+// Plain text metrics about every game, served at a fixed url so they can be
+// scraped by monitoring tools
+struct MetricsResource : Wt::WResource {
+    MetricsResource(MainServer& server)
+        : server_{server}
+    {}
+    ~MetricsResource() { this->beingDeleted(); }
+
+    void handleRequest(const Wt::Http::Request&, Wt::Http::Response&) override;
+private:
+    MainServer& server_;
+};
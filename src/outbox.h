@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <vector>
+
+#include "event.h"
+#include "replay_buffer.h"
+
+// Events waiting to be sent to one client, which may be slow to take them.
+// They only tell the client to look at the game again, so a new one replaces
+// one of the same type still waiting, and there's never more than one of each
+// type queued. Text never comes here, it goes through the chat log.
+struct Outbox {
+    void push(SequencedEvent event) {
+        assert(!event.event.text());
+        const auto it = std::find_if(
+            events_.begin(), events_.end(),
+            [type = event.event.type()](const SequencedEvent& waiting) {
+                return waiting.event.type() == type;
+            });
+        if (it != events_.end()) events_.erase(it);
+        events_.push_back(std::move(event));
+    }
+
+    // Everything waiting, in order
+    std::vector<SequencedEvent> take() {
+        std::vector<SequencedEvent> events{std::make_move_iterator(events_.begin()),
+                                           std::make_move_iterator(events_.end())};
+        events_.clear();
+        return events;
+    }
+
+    bool empty() const noexcept { return events_.empty(); }
+    std::size_t size() const noexcept { return events_.size(); }
+
+    std::size_t memory_usage() const noexcept {
+        return events_.size() * sizeof(SequencedEvent);
+    }
+private:
+    std::deque<SequencedEvent> events_;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "event.h"
+
+// An event as posted to a game, numbered in the order it was posted.
+// Sequence numbers start at 1, so a cursor of 0 has seen nothing.
+struct SequencedEvent {
+    std::uint64_t sequence;
+    Event event;
+};
+
+// The events missed by a client, since the cursor it last saw
+struct CatchUp {
+    std::vector<SequencedEvent> events;
+    // False if some of the missed events had already been dropped, in which
+    // case events holds only those still kept, and the client must rebuild
+    // from the current game rather than from what it had
+    bool complete = true;
+    // Sequence number of the last event posted, which the client is up to
+    // date with once it has handled these
+    std::uint64_t last = 0;
+};
+
+// The most recent events posted to a game, so that a client that reconnects
+// gets only what it missed
+struct ReplayBuffer {
+    explicit ReplayBuffer(std::size_t capacity)
+        : capacity_{capacity}
+    {
+        assert(capacity > 0);
+    }
+
+    // Returns the sequence number given to the event
+    std::uint64_t push(const Event& event) {
+        if (events_.size() == capacity_) events_.pop_front();
+        events_.push_back({++last_sequence_, event});
+        return last_sequence_;
+    }
+
+    // Sequence number of the last event pushed, 0 if none
+    std::uint64_t last_sequence() const noexcept { return last_sequence_; }
+
+    // Every event after the cursor that is still kept. A cursor ahead of the
+    // last event, such as one from before a restart, is treated as too old.
+    CatchUp since(std::uint64_t cursor) const {
+        CatchUp catch_up;
+        catch_up.last = last_sequence_;
+        const std::uint64_t first = last_sequence_ - events_.size() + 1;
+        if (cursor > last_sequence_) cursor = 0;
+        catch_up.complete = cursor + 1 >= first;
+
+        const std::uint64_t from = std::max(cursor + 1, first);
+        catch_up.events.assign(events_.begin() + (from - first), events_.end());
+        return catch_up;
+    }
+
+    // Only game events are counted, text goes through the chat log
+    std::size_t memory_usage() const noexcept {
+        // A deque allocates in blocks, roughly the size of its elements
+        return events_.size() * sizeof(SequencedEvent);
+    }
+private:
+    std::size_t capacity_;
+    std::deque<SequencedEvent> events_;
+    std::uint64_t last_sequence_ = 0;
+};
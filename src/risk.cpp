@@ -0,0 +1,126 @@
+#include "risk.h"
+
+#include <atomic>
+
+#include "simulation.h"
+#include "thread_pool.h"
+
+struct BankruptcyRiskEstimator::Job {
+    Job(std::uint64_t version, const Game& game)
+        : version{version}, game{game}, strategies(game.num_players(), hold_strategy()),
+          bankruptcies(game.num_players(), 0)
+    {}
+
+    const std::uint64_t version;
+    const Game game;
+    const std::vector<Strategy> strategies;
+
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<unsigned> tasks_left{0};
+
+    std::mutex mutex;
+    std::uint64_t games = 0;
+    std::vector<std::uint64_t> bankruptcies;
+};
+
+BankruptcyRiskEstimator::BankruptcyRiskEstimator(ThreadPool& pool, Callback on_update)
+    : pool_{pool}, on_update_{std::move(on_update)}
+{}
+
+BankruptcyRiskEstimator::~BankruptcyRiskEstimator()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiting_ = nullptr;
+    idle_.wait(lock, [this] { return !running_; });
+}
+
+void BankruptcyRiskEstimator::request(std::uint64_t version, const Game& game)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (requested_version_ == version) return;
+    requested_version_ = version;
+
+    // Only the newest request is worth running once the current one finishes
+    auto job = std::make_shared<Job>(version, game);
+    if (running_) {
+        waiting_ = std::move(job);
+    } else {
+        running_ = true;
+        lock.unlock();
+        this->start(std::move(job));
+    }
+}
+
+std::optional<std::vector<double>> BankruptcyRiskEstimator::estimate(std::uint64_t version) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!estimate_ || estimate_version_ != version) return {};
+    return estimate_;
+}
+
+void BankruptcyRiskEstimator::start(std::shared_ptr<Job> job)
+{
+    job->deadline = std::chrono::steady_clock::now() + budget;
+
+    const unsigned tasks = pool_.size();
+    job->tasks_left = tasks;
+
+    for (unsigned task = 0; task < tasks; ++task) {
+        pool_.submit([this, job, task, tasks] {
+            SimulationOptions options;
+            options.max_laps = laps;
+
+            Rng rng{job->version * tasks + task};
+            std::uint64_t games = 0;
+            std::vector<std::uint64_t> bankruptcies(job->game.num_players(), 0);
+
+            while (games < max_games / tasks && std::chrono::steady_clock::now() < job->deadline) {
+                const auto outcome = simulate_game(job->game, job->strategies, rng, options);
+                ++games;
+                for (unsigned i = 0; i < outcome.bankrupt.size(); ++i) {
+                    bankruptcies[i] += outcome.bankrupt[i];
+                }
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(job->mutex);
+                job->games += games;
+                for (unsigned i = 0; i < bankruptcies.size(); ++i) {
+                    job->bankruptcies[i] += bankruptcies[i];
+                }
+            }
+
+            if (--job->tasks_left == 0) this->finish(*job);
+        });
+    }
+}
+
+void BankruptcyRiskEstimator::finish(const Job& job)
+{
+    std::vector<double> estimate(job.bankruptcies.size(), 0.0);
+    for (unsigned i = 0; i < estimate.size() && job.games > 0; ++i) {
+        estimate[i] = double(job.bankruptcies[i]) / job.games;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        estimate_version_ = job.version;
+        estimate_ = std::move(estimate);
+    }
+
+    // Still counts as running until the callback returns, so the destructor
+    // can't pull the rug out from under it
+    if (on_update_) on_update_();
+
+    std::shared_ptr<Job> next;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        next = std::move(waiting_);
+        waiting_ = nullptr;
+        running_ = next != nullptr;
+        if (!running_) idle_.notify_all();
+    }
+
+    if (next) this->start(std::move(next));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "game.h"
+
+struct ThreadPool;
+
+// Monte Carlo estimate of each player's probability of going bankrupt within
+// the next few laps, if nobody buys or builds anything more. Estimates run in
+// the background on a shared pool, are limited to a time budget, and are
+// cached against the version of the game they were made for.
+struct BankruptcyRiskEstimator {
+    using Callback = std::function<void()>;
+
+    static constexpr unsigned laps = 3;
+    static constexpr std::chrono::milliseconds budget{200};
+    static constexpr unsigned max_games = 4000;
+
+    // on_update is called from a pool thread whenever a new estimate is ready
+    BankruptcyRiskEstimator(ThreadPool&, Callback on_update);
+    ~BankruptcyRiskEstimator();
+
+    BankruptcyRiskEstimator(const BankruptcyRiskEstimator&) = delete;
+    BankruptcyRiskEstimator& operator=(const BankruptcyRiskEstimator&) = delete;
+
+    // Start an estimate for this version of the game, unless there already is
+    // one. Never blocks on the estimate itself.
+    void request(std::uint64_t version, const Game&);
+
+    // Probability of each player going bankrupt, if the estimate for this
+    // version is ready
+    std::optional<std::vector<double>> estimate(std::uint64_t version) const;
+private:
+    struct Job;
+
+    void start(std::shared_ptr<Job>);
+    void finish(const Job&);
+
+    ThreadPool& pool_;
+    Callback on_update_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable idle_;
+    bool running_ = false;
+    std::shared_ptr<Job> waiting_ = nullptr;
+    std::optional<std::uint64_t> requested_version_ = {};
+
+    std::uint64_t estimate_version_ = 0;
+    std::optional<std::vector<double>> estimate_ = {};
+};
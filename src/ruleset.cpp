@@ -0,0 +1,215 @@
+#include "ruleset.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+// Parsing --------------------------------------------------------------------
+
+namespace {
+
+[[noreturn]] void fail(const std::string& source, const std::string& message)
+{
+    throw std::runtime_error(source + ": " + message);
+}
+
+[[noreturn]] void fail(const std::string& source, unsigned line, const std::string& message)
+{
+    fail(source + ":" + std::to_string(line), message);
+}
+
+// Whatever is left of the line, without the spaces around it
+std::string rest_of_line(std::istream& words)
+{
+    std::string rest;
+    std::getline(words >> std::ws, rest);
+    while (!rest.empty() && std::isspace(static_cast<unsigned char>(rest.back()))) {
+        rest.pop_back();
+    }
+    return rest;
+}
+
+std::optional<PropertyKind> parse_kind(const std::string& word)
+{
+    if (word == "street") return PropertyKind::street;
+    if (word == "station") return PropertyKind::station;
+    if (word == "utility") return PropertyKind::utility;
+    return {};
+}
+
+template <std::size_t N, std::size_t... Ids>
+BasicRuleset<N> make_ruleset(std::string name, std::vector<BasicPropertyInfo<N>>& properties,
+                             const Rules& rules, std::index_sequence<Ids...>)
+{
+    return {std::move(name), {{std::move(properties[Ids])...}}, rules};
+}
+
+}
+
+template <std::size_t N>
+BasicRuleset<N> parse_ruleset(std::istream& in, const std::string& source)
+{
+    struct Set {
+        PropertyKind kind;
+        int house_price;
+        BasicPropertySet<N> properties = 0;
+    };
+    std::map<std::string, Set> sets;
+
+    std::string name;
+    Rules rules;
+    std::vector<BasicPropertyInfo<N>> properties;
+    // Name of the set each property is in, by id
+    std::vector<std::string> property_sets;
+
+    std::string text;
+    for (unsigned line = 1; std::getline(in, text); ++line) {
+        std::istringstream words(text);
+        std::string keyword;
+        if (!(words >> keyword) || keyword[0] == '#') continue;
+
+        if (keyword == "name") {
+            if (!name.empty()) fail(source, line, "the ruleset already has a name");
+            name = rest_of_line(words);
+            if (name.empty()) fail(source, line, "expected name <name>");
+        } else if (keyword == "rule") {
+            std::string rule, value;
+            if (!(words >> rule >> value) || !rest_of_line(words).empty()) {
+                fail(source, line, "expected rule <rule> <value>");
+            }
+            if (!set_rule(rules, rule, value)) {
+                fail(source, line, "bad rule: " + rule + " " + value);
+            }
+        } else if (keyword == "set") {
+            std::string set_name, kind_name;
+            int house_price = 0;
+            if (!(words >> set_name >> kind_name >> house_price) || !rest_of_line(words).empty()
+                || house_price < 0) {
+                fail(source, line, "expected set <set> <street|station|utility> <house price>");
+            }
+            const auto kind = parse_kind(kind_name);
+            if (!kind) fail(source, line, "unknown kind of set: " + kind_name);
+            if (!sets.emplace(set_name, Set{*kind, house_price}).second) {
+                fail(source, line, "set " + set_name + " is already defined");
+            }
+        } else if (keyword == "property") {
+            std::string set_name;
+            int guide_price = 0;
+            std::array<int, 6> rents = {};
+            int landing_weight = 0;
+            words >> set_name >> guide_price;
+            for (auto& rent : rents) words >> rent;
+            words >> landing_weight;
+            const std::string property_name = words ? rest_of_line(words) : "";
+            if (property_name.empty() || guide_price <= 0 || landing_weight < 0
+                || std::any_of(rents.begin(), rents.end(), [](int rent) { return rent < 0; })) {
+                fail(source, line,
+                     "expected property <set> <guide price> <6 rents> <landing weight> <name>");
+            }
+
+            const auto set = sets.find(set_name);
+            if (set == sets.end()) fail(source, line, "unknown set: " + set_name);
+            if (properties.size() == N) {
+                fail(source, line, "more than " + std::to_string(N) + " properties");
+            }
+            for (const auto& property : properties) {
+                if (property.name == property_name) {
+                    fail(source, line, "property " + property_name + " is already defined");
+                }
+            }
+
+            set->second.properties.set(properties.size());
+            properties.emplace_back(property_name, guide_price, set->second.house_price, 0, rents,
+                                    set->second.kind, landing_weight);
+            property_sets.push_back(set_name);
+        } else {
+            fail(source, line, "unknown keyword: " + keyword);
+        }
+    }
+
+    if (name.empty()) fail(source, "the ruleset has no name");
+    if (properties.size() != N) {
+        fail(source, std::to_string(properties.size()) + " properties, where the board has "
+                     + std::to_string(N));
+    }
+
+    // Rent is only defined for owning up to four stations or two utilities
+    for (const auto& [set_name, set] : sets) {
+        const std::size_t count = set.properties.count();
+        if (count == 0) fail(source, "set " + set_name + " has no properties");
+        if ((set.kind == PropertyKind::station && count > 4)
+            || (set.kind == PropertyKind::utility && count > 2)) {
+            fail(source, "set " + set_name + " has too many properties for its kind");
+        }
+    }
+    for (unsigned id = 0; id < N; ++id) {
+        properties[id].set = sets.at(property_sets[id]).properties;
+    }
+
+    return make_ruleset<N>(std::move(name), properties, rules, std::make_index_sequence<N>{});
+}
+
+Ruleset load_ruleset(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) fail(path, "can't be opened");
+    return parse_ruleset<num_standard_properties>(file, path);
+}
+
+// Catalog --------------------------------------------------------------------
+
+RulesetCatalog::RulesetCatalog()
+{
+    by_name_[standard_ruleset().name()] = &standard_ruleset();
+}
+
+const Ruleset& RulesetCatalog::add(Ruleset&& ruleset)
+{
+    loaded_.push_back(std::move(ruleset));
+    by_name_[loaded_.back().name()] = &loaded_.back();
+    return loaded_.back();
+}
+
+void RulesetCatalog::load_directory(const std::string& path)
+{
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(path)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    for (const auto& file : files) this->add(load_ruleset(file.string()));
+}
+
+const Ruleset* RulesetCatalog::find(const std::string& name) const noexcept
+{
+    const auto it = by_name_.find(name);
+    return it == by_name_.end() ? nullptr : it->second;
+}
+
+const Ruleset& RulesetCatalog::standard() const noexcept
+{
+    return *this->find(standard_ruleset().name());
+}
+
+std::vector<std::string> RulesetCatalog::names() const
+{
+    std::vector<std::string> names;
+    for (const auto& [name, ruleset] : by_name_) {
+        (void)ruleset;
+        names.push_back(name);
+    }
+    return names;
+}
+
+// Board sizes ----------------------------------------------------------------
+
+template BasicRuleset<num_standard_properties> parse_ruleset(std::istream&, const std::string&);
+template BasicRuleset<64> parse_ruleset(std::istream&, const std::string&);
+template BasicRuleset<max_board_properties> parse_ruleset(std::istream&, const std::string&);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <deque>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Rulesets defined in text files, so that boards and house rules can be
+// changed without a rebuild. The format is described in rulesets/standard.txt.
+
+// Reads a ruleset for a board of N properties. Throws std::runtime_error,
+// naming the source and line, if it doesn't parse or isn't a playable board.
+template <std::size_t N>
+BasicRuleset<N> parse_ruleset(std::istream&, const std::string& source);
+
+// Reads a ruleset for the standard size of board from a file
+Ruleset load_ruleset(const std::string& path);
+
+// Every ruleset that new games can be played with, by name. Rulesets are
+// never removed or moved, so games can use them for as long as the catalog
+// exists.
+struct RulesetCatalog {
+    // Starts with just the standard ruleset
+    RulesetCatalog();
+    RulesetCatalog(const RulesetCatalog&) = delete;
+    RulesetCatalog& operator=(const RulesetCatalog&) = delete;
+
+    // A ruleset with the name of one already in the catalog replaces it for
+    // new games. Games already using the old one are unaffected.
+    const Ruleset& add(Ruleset&&);
+
+    // Loads every *.txt file in the directory, in order of file name
+    void load_directory(const std::string& path);
+
+    const Ruleset* find(const std::string& name) const noexcept;
+    const Ruleset& standard() const noexcept;
+
+    // In alphabetical order
+    std::vector<std::string> names() const;
+private:
+    std::deque<Ruleset> loaded_;
+    std::map<std::string, const Ruleset*> by_name_;
+};
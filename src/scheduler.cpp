@@ -0,0 +1,93 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+Scheduler::Scheduler(Clock::duration tick)
+    : tick_{std::max(tick, Clock::duration(1))}
+{
+    thread_ = std::thread([this] { this->run(); });
+}
+
+Scheduler::~Scheduler()
+{
+    this->stop();
+}
+
+Scheduler::Timer Scheduler::schedule(Clock::time_point when, Task task)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // The thread sleeps while there's nothing to do, so it's woken for the
+    // first task, having let the wheel catch up with the time
+    const bool was_empty = wheel_.empty();
+    if (was_empty) {
+        std::vector<TimerWheel::Callback> none;
+        wheel_.advance(this->ticks_until(Clock::now()), none);
+    }
+    const auto timer = wheel_.insert(this->ticks_until(when), std::move(task));
+
+    lock.unlock();
+    if (was_empty) wake_.notify_one();
+    return timer;
+}
+
+bool Scheduler::cancel(Timer timer)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return wheel_.cancel(timer);
+}
+
+void Scheduler::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+std::size_t Scheduler::pending()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return wheel_.size();
+}
+
+std::size_t Scheduler::memory_usage()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return wheel_.memory_usage();
+}
+
+TimerWheel::Tick Scheduler::ticks_until(Clock::time_point when) const
+{
+    if (when <= start_) return 0;
+    // Rounded up, so nothing runs early
+    return (when - start_ + tick_ - Clock::duration(1)) / tick_;
+}
+
+void Scheduler::run()
+{
+    std::vector<TimerWheel::Callback> due;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (wheel_.empty()) {
+            wake_.wait(lock, [this] { return stopping_ || !wheel_.empty(); });
+            continue;
+        }
+
+        const auto next_tick = start_ + tick_ * (wheel_.now() + 1);
+        if (wake_.wait_until(lock, next_tick, [this] { return stopping_; })) break;
+
+        // Rounded down, as a tick only passes once it's over
+        wheel_.advance((Clock::now() - start_) / tick_, due);
+        if (due.empty()) continue;
+
+        lock.unlock();
+        for (auto& task : due) task();
+        due.clear();
+        lock.lock();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "timer_wheel.h"
+
+// Runs tasks at given times on a thread of its own, to the nearest tick. One
+// is shared by every game, so however many timers are pending there is only
+// the one thread, and scheduling or cancelling a task never takes longer
+// with more of them.
+//
+// Tasks run one after another on the scheduler's thread, without its lock
+// held, so they may schedule and cancel other tasks. They should be quick,
+// as a slow one holds up every task due after it.
+struct Scheduler {
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+    // Identifies a task to cancel it. Never 0, so 0 can mean no task.
+    using Timer = TimerWheel::Id;
+
+    explicit Scheduler(Clock::duration tick = std::chrono::milliseconds(100));
+    // Tasks still pending are never run
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    Timer schedule(Clock::time_point when, Task);
+    Timer schedule_after(Clock::duration delay, Task task) {
+        return this->schedule(Clock::now() + delay, std::move(task));
+    }
+
+    // Returns false if the task has already been run or cancelled. A task
+    // that is just about to run may still run after being cancelled, so a
+    // task that mustn't should check it's still wanted when it does.
+    bool cancel(Timer);
+
+    // Stops running tasks, waiting for any that's running to finish. Call
+    // before destroying anything a pending task uses.
+    void stop();
+
+    std::size_t pending();
+    std::size_t memory_usage();
+private:
+    TimerWheel::Tick ticks_until(Clock::time_point) const;
+    void run();
+
+    const Clock::time_point start_ = Clock::now();
+    const Clock::duration tick_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    TimerWheel wheel_;
+    bool stopping_ = false;
+
+    // Started last, once everything it uses has been
+    std::thread thread_;
+};
@@ -1,5 +1,10 @@
 #include <Wt/WLogger.h>
 
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <sstream>
+
 #include "servers.h"
 
 #include "event.h"
@@ -11,36 +16,155 @@ namespace {
 
 // GameServer -----------------------------------------------------------------
 
-bool GameServer::connect(GameWidget* client)
+GameServer::~GameServer()
+{
+    for (const auto& [routine, timer] : routines_) {
+        (void)routine;
+        scheduler_.cancel(timer.timer);
+    }
+    scheduler_.cancel(auction_timer_);
+}
+
+CatchUp GameServer::connect(GameWidget* client, std::optional<unsigned> player_id,
+                            std::uint64_t cursor)
 {
     std::unique_lock<std::recursive_mutex> lock(mutex_);
 
-    if (clients_.count(client) == 0) {
-        const auto session_id = Wt::WApplication::instance()->sessionId();
-        clients_[client] = ClientInfo{session_id};
-        return true;
-    } else {
-        return false;
-    }
+    // Registered in the same critical section as the catch up is taken, so
+    // every event is either caught up on or sent, never both or neither
+    const auto session_id = Wt::WApplication::instance()->sessionId();
+    clients_[client] = ClientInfo{session_id, player_id, std::chrono::steady_clock::now(),
+                                  replay_.last_sequence()};
+    clients_[client].number = ++connections_;
+
+    // Sent messages from now on. Anything older the client pages in from
+    // the history itself.
+    std::unique_lock<std::mutex> chat_lock(chat_mutex_);
+    chat_clients_[client] = ChatClient{session_id, chat_log_.size()};
+    chat_lock.unlock();
+
+    this->update_summary();
+
+    return replay_.since(cursor);
 }
 
 bool GameServer::disconnect(GameWidget* client)
 {
     std::unique_lock<std::recursive_mutex> lock(mutex_);
-    return clients_.erase(client) == 1;
+
+    const auto it = clients_.find(client);
+    if (it == clients_.end()) return false;
+
+    if (it->second.player_id) resume_cursors_[*it->second.player_id] = it->second.cursor;
+    clients_.erase(it);
+    this->update_summary();
+
+    std::unique_lock<std::mutex> chat_lock(chat_mutex_);
+    chat_clients_.erase(client);
+    return true;
 }
 
-std::optional<unsigned> GameServer::login(std::string username)
+Result GameServer::send_message(const MessageEvent& message)
+{
+    const Wt::WApplication* app = Wt::WApplication::instance();
+    const auto is_current = [app](const auto& client) {
+        return app && client.second.session_id == app->sessionId();
+    };
+
+    {
+        std::unique_lock<std::mutex> lock(chat_mutex_);
+
+        const auto now = std::chrono::steady_clock::now();
+        const auto client = std::find_if(chat_clients_.begin(), chat_clients_.end(), is_current);
+        const bool limited = client != chat_clients_.end();
+        if (limited && !client->second.input_limit.ready(now)) {
+            return {false, "Slow down, that was too many messages at once"};
+        }
+        if (app && !chat_limit_.ready(now)) {
+            return {false, "The chat is busy, try again in a moment"};
+        }
+        if (limited) client->second.input_limit.take();
+        if (app) chat_limit_.take();
+    }
+
+    if (!this->publish_message(message.text)) return {false, "The chat is full until the game is restarted"};
+    return true;
+}
+
+bool GameServer::publish_message(std::string text)
+{
+    const auto index = chat_log_.append(std::move(text));
+    if (!index) return false;
+
+    // As with game events, the sender gets their own message straight away
+    // and every other session is asked to come and take what's new
+    const Wt::WApplication* app = Wt::WApplication::instance();
+    GameWidget* current_client = nullptr;
+    std::vector<std::pair<GameWidget*, std::string>> too_far_behind;
+    {
+        std::unique_lock<std::mutex> lock(chat_mutex_);
+        for (auto& [client, info] : chat_clients_) {
+            if (app && info.session_id == app->sessionId()) {
+                current_client = client;
+            } else if (*index - info.cursor > chat_max_behind) {
+                too_far_behind.emplace_back(client, info.session_id);
+            } else if (!info.flush_posted) {
+                info.flush_posted = true;
+                wserver_.post(info.session_id,
+                              [this, client = client] { this->flush_chat(client); });
+            }
+        }
+    }
+
+    // The only time chat takes the game's lock, once the chat lock is let go.
+    // Ending the session logs out its player.
+    for (const auto& [client, session_id] : too_far_behind) {
+        this->disconnect(client);
+        wserver_.post(session_id, [] { Wt::WApplication::instance()->quit(); });
+    }
+
+    if (current_client) this->flush_chat(current_client);
+    return true;
+}
+
+void GameServer::flush_chat(GameWidget* client)
+{
+    std::uint64_t from = 0;
+    std::uint64_t to = 0;
+    {
+        std::unique_lock<std::mutex> lock(chat_mutex_);
+
+        const auto it = chat_clients_.find(client);
+        if (it == chat_clients_.end()) return;
+        it->second.flush_posted = false;
+        from = it->second.cursor;
+        to = chat_log_.size();
+        it->second.cursor = to;
+    }
+    if (from == to) return;
+
+    // Reading the history never waits, so is done without any lock. The
+    // client notices any older messages that were skipped.
+    const std::uint64_t first = std::max(from, to - std::min<std::uint64_t>(to, chat_batch_limit));
+    client->handle_messages(chat_log_.read(first, to));
+}
+
+std::uint64_t GameServer::resume_cursor(unsigned player_id)
 {
     std::unique_lock<std::recursive_mutex> lock(mutex_);
 
-    const auto it
-        = std::find_if(this->game().players().begin(), this->game().players().end(),
-                       [&username](auto& x) { return x.name == username; });
+    const auto it = resume_cursors_.find(player_id);
+    return it == resume_cursors_.end() ? 0 : it->second;
+}
+
+std::optional<unsigned> GameServer::login(std::string username)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
 
-    const unsigned player_id = std::distance(this->game().players().begin(), it);
-    if (it == this->game().players().end()) {
-        AddPlayerEvent e(username, this->game().players().size());
+    const auto existing_id = this->game().find_player(username);
+    const unsigned player_id = existing_id ? *existing_id : this->game().num_players();
+    if (!existing_id) {
+        AddPlayerEvent e(username, player_id);
         this->add_player(e);
         this->post(Event{e});
     }
@@ -65,61 +189,770 @@ void GameServer::logout(unsigned player_id)
 
     if (it != player_ids_.end()) {
         player_ids_.erase(it);
+
+        Event e{NotificationEvent{this->game().player(player_id).name + " logged out"}};
+        this->post(e);
     }
 }
 
+std::size_t GameServer::reap(const std::set<std::string>& live_session_ids,
+                             std::chrono::steady_clock::time_point listed_at)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    std::vector<std::pair<GameWidget*, std::optional<unsigned>>> dead;
+    for (const auto& [client, info] : clients_) {
+        if (info.connected < listed_at && live_session_ids.count(info.session_id) == 0) {
+            dead.emplace_back(client, info.player_id);
+        }
+    }
+
+    // Disconnected first, so the logout isn't sent to the dead sessions
+    for (const auto& [client, player_id] : dead) this->disconnect(client);
+    for (const auto& [client, player_id] : dead) {
+        (void)client;
+        if (player_id) this->logout(*player_id);
+    }
+    return dead.size();
+}
+
+Result GameServer::add_bot(std::string name)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    const auto player_id = this->login(name);
+    if (!player_id) return {false, name + " is already playing"};
+
+    bots_.push_back(std::make_unique<Bot>(*this, bot_pool_, *player_id));
+    bots_.back()->game_changed(version_, this->game());
+    return {true, name + " is now played by a bot"};
+}
+
+Result GameServer::admit_input()
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    const Wt::WApplication* app = Wt::WApplication::instance();
+    if (!app) return true;
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto client = std::find_if(clients_.begin(), clients_.end(), [app](const auto& c) {
+        return c.second.session_id == app->sessionId();
+    });
+    if (client != clients_.end() && !client->second.input_limit.ready(now)) {
+        return {false, "Slow down, that was too much at once"};
+    }
+    if (!input_limit_.ready(now)) {
+        return {false, "The game is busy, try again in a moment"};
+    }
+
+    if (client != clients_.end()) client->second.input_limit.take();
+    input_limit_.take();
+    return true;
+}
+
 void GameServer::add_player(const AddPlayerEvent& event)
 {
     std::unique_lock<std::recursive_mutex> lock(mutex_);
     game_history_.add_player(event);
+    this->game_changed();
 }
 
 Result GameServer::apply(const GameEvent& event)
 {
     std::unique_lock<std::recursive_mutex> lock(mutex_);
-    return game_history_.apply(event);
+
+    auto result = game_history_.apply(event);
+    if (result) this->game_changed();
+    return result;
+}
+
+Result GameServer::undo()
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    auto result = game_history_.undo();
+    if (result) this->game_changed();
+    return result;
+}
+
+Result GameServer::redo()
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    auto result = game_history_.redo();
+    if (result) this->game_changed();
+    return result;
+}
+
+GameFork GameServer::fork()
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    return game_history_.fork();
+}
+
+Result GameServer::merge(const GameFork& fork)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    auto result = game_history_.merge(fork);
+    if (result) this->game_changed();
+    return result;
+}
+
+void GameServer::game_changed()
+{
+    ++version_;
+    risk_estimator_.request(version_, this->game());
+    for (auto& bot : bots_) bot->game_changed(version_, this->game());
+    this->update_summary();
+    this->update_cash();
+
+    // Put off the idle warning, cancelling it and scheduling it again
+    if (!running_routine_ && routines_.count(Routine::idle_warning) > 0) {
+        this->schedule(Routine::idle_warning);
+    }
+}
+
+void GameServer::update_summary()
+{
+    const auto& game = this->game();
+
+    auto summary = std::make_shared<GameSummary>();
+    summary->name = name_;
+    summary->ruleset = game.ruleset().name();
+    summary->players = game.num_players();
+    summary->clients = clients_.size();
+    summary->created = created_;
+    for (const auto& player : game.players()) {
+        const int net_worth = player.cash + asset_value(player, game) - player.secured_debt
+                              - player.unsecured_debt;
+        if (summary->leader.empty() || net_worth > summary->leader_net_worth) {
+            summary->leader = player.name;
+            summary->leader_net_worth = net_worth;
+        }
+    }
+
+    std::atomic_store(&summary_, std::shared_ptr<const GameSummary>(std::move(summary)));
+}
+
+void GameServer::update_cash()
+{
+    auto cash = std::make_shared<std::vector<int>>();
+    for (const auto& player : this->game().players()) cash->push_back(player.cash);
+    std::atomic_store(&cash_, std::shared_ptr<const std::vector<int>>(std::move(cash)));
+}
+
+std::uint64_t GameServer::version()
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    return version_;
+}
+
+Result GameServer::play(const GameEvent& event)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    const Result r = this->apply(event);
+    if (!r) return r;
+    this->post(Event{event});
+    this->post(Event{NotificationEvent{r.text()}});
+    return r;
+}
+
+std::optional<std::vector<double>> GameServer::bankruptcy_risk()
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    return risk_estimator_.estimate(version_);
 }
 
 void GameServer::post(const Event& event)
 {
     std::unique_lock<std::recursive_mutex> lock(mutex_);
 
-    log("[Game " + name_ + "] " + event.description());
+    const bool ephemeral = event.type() == Event::Type::analysis
+                           || event.type() == Event::Type::auction
+                           || event.type() == Event::Type::trade;
+    if (!ephemeral) log("[Game " + name_ + "] " + event.description());
+
+    // Lines for the message box go into the history, which every client
+    // reads from, rather than the outboxes
+    if (const auto* text = event.text()) {
+        if (!this->publish_message(*text)) {
+            log("[Game " + name_ + "] Chat log full, not shown: " + *text);
+        }
+        return;
+    }
+
+    // Analysis results, auctions and trades on offer are only ever looked
+    // at as they are now, so there's nothing to catch up on
+    const std::uint64_t sequence = ephemeral ? replay_.last_sequence() : replay_.push(event);
+    const SequencedEvent sequenced{sequence, event};
 
     Wt::WApplication* app = Wt::WApplication::instance();
+    GameWidget* current_client = nullptr;
 
     for (auto& [client, info] : clients_) {
+        // Outboxes hold one event of each type at most, so however slow a
+        // client is it can't hold up anyone else or take more and more memory
+        info.outbox.push(sequenced);
+
         /*
          * If the user corresponds to the current application, we directly
          * call the call back method. This avoids an unnecessary delay for
          * the update to the user causing the event.
          *
-         * For other uses, we post it to their session. By posting the
-         * event, we avoid dead-lock scenarios, race conditions, and
+         * For other uses, we post to their session to take what's in the
+         * outbox, once for however many events arrive before it does. By
+         * posting, we avoid dead-lock scenarios, race conditions, and
          * delivering the event to a session that is just about to be
          * terminated.
          */
         if (app && app->sessionId() == info.session_id) {
-            client->handle_event(event);
-        } else {
-            // Must capture the event by value, or it may be destroyed before
-            // it can be used (client here is just a pointer)
-            wserver_.post(info.session_id,
-                          [client, event] { client->handle_event(event); });
+            current_client = client;
+        } else if (!info.flush_posted) {
+            info.flush_posted = true;
+            wserver_.post(info.session_id, [this, client = client] { this->flush(client); });
+        }
+    }
+
+    if (current_client) this->flush(current_client);
+}
+
+void GameServer::flush(GameWidget* client)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    const auto it = clients_.find(client);
+    if (it == clients_.end()) return;
+    it->second.flush_posted = false;
+    const auto events = it->second.outbox.take();
+
+    lock.unlock();
+    if (events.empty()) return;
+    client->handle_events(events);
+
+    // Whatever the client got through, which is where its player resumes
+    // from. It may have been disconnected while handling them.
+    lock.lock();
+    const auto handled = clients_.find(client);
+    if (handled != clients_.end()) handled->second.cursor = client->cursor();
+}
+
+GameServer::MemoryUsage GameServer::memory_usage()
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    MemoryUsage usage;
+    usage.history = game_history_.history_memory_usage();
+    usage.descriptions = game_history_.description_memory_usage();
+
+    usage.clients = player_ids_.size() * (tree_node_overhead + sizeof(unsigned));
+    for (const auto& [client, info] : clients_) {
+        (void)client;
+        usage.clients += tree_node_overhead + sizeof(GameWidget*) + sizeof(ClientInfo)
+                         + heap_usage(info.session_id);
+        usage.message_log += info.memory_usage.message_bytes;
+    }
+    usage.replay = replay_.memory_usage();
+    for (const auto& [client, info] : clients_) {
+        (void)client;
+        usage.outboxes += info.outbox.memory_usage();
+    }
+    usage.chat = chat_log_.memory_usage();
+
+    return usage;
+}
+
+void GameServer::report_memory_usage(GameWidget* client, const SessionMemoryUsage& usage)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    const auto it = clients_.find(client);
+    if (it != clients_.end()) it->second.memory_usage = usage;
+}
+
+std::vector<std::pair<std::uint64_t, SessionMemoryUsage>> GameServer::session_memory_usage()
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    std::vector<std::pair<std::uint64_t, SessionMemoryUsage>> sessions;
+    for (const auto& [client, info] : clients_) {
+        (void)client;
+        sessions.emplace_back(info.number, info.memory_usage);
+    }
+    std::sort(sessions.begin(), sessions.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    return sessions;
+}
+
+const char* GameServer::routine_name(Routine routine)
+{
+    switch (routine) {
+        case Routine::raise_interest: return "Raise interest rates";
+        case Routine::lower_interest: return "Lower interest rates";
+        case Routine::passgo_reminder: return "Pass go reminder";
+        case Routine::idle_warning: return "Idle warning";
+    }
+    return "";
+}
+
+Result GameServer::start_routine(Routine routine, std::chrono::minutes every)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    if (every.count() < 1 || every > max_routine_interval) {
+        return {false, "Routines can be done every 1 to "
+                           + std::to_string(max_routine_interval.count()) + " minutes"};
+    }
+
+    routines_[routine].every = every;
+    this->schedule(routine);
+
+    const std::string text = std::string(routine_name(routine))
+                             + (routine == Routine::idle_warning ? " after " : " every ")
+                             + std::to_string(every.count()) + " minutes";
+    this->post(Event{NotificationEvent{text}});
+    return {true, text};
+}
+
+Result GameServer::stop_routine(Routine routine)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    const auto it = routines_.find(routine);
+    if (it == routines_.end()) return {false, std::string(routine_name(routine)) + " isn't on"};
+
+    scheduler_.cancel(it->second.timer);
+    routines_.erase(it);
+
+    const std::string text = std::string(routine_name(routine)) + " stopped";
+    this->post(Event{NotificationEvent{text}});
+    return {true, text};
+}
+
+std::optional<std::chrono::minutes> GameServer::routine_interval(Routine routine)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    const auto it = routines_.find(routine);
+    if (it == routines_.end()) return {};
+    return it->second.every;
+}
+
+void GameServer::schedule(Routine routine)
+{
+    auto& timer = routines_.at(routine);
+    scheduler_.cancel(timer.timer);
+    timer.scheduled = ++routines_scheduled_;
+    timer.timer = scheduler_.schedule_after(
+        timer.every, [this, routine, scheduled = timer.scheduled] {
+            this->run_routine(routine, scheduled);
+        });
+}
+
+void GameServer::run_routine(Routine routine, std::uint64_t scheduled)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    // Stopped or rescheduled just as it was due
+    const auto it = routines_.find(routine);
+    if (it == routines_.end() || it->second.scheduled != scheduled) return;
+
+    const auto every = it->second.every;
+    if (routine == Routine::idle_warning) {
+        it->second.timer = 0;
+    } else {
+        this->schedule(routine);
+    }
+
+    // Nobody's there to see it, so the game is left as it is
+    if (clients_.empty()) return;
+
+    // Delivered just as if someone had clicked the button
+    const auto apply_event = [this](const GameEvent& event) {
+        running_routine_ = true;
+        const Result r = this->apply(event);
+        running_routine_ = false;
+
+        if (r) this->post(Event{event});
+        this->post(Event{NotificationEvent{r.text()}});
+    };
+
+    switch (routine) {
+        case Routine::raise_interest:
+            apply_event(GameEvent{[](Game& g) { return raise_interest(g); }});
+            break;
+        case Routine::lower_interest:
+            apply_event(GameEvent{[](Game& g) { return lower_interest(g); }});
+            break;
+        case Routine::passgo_reminder:
+            this->post(Event{NotificationEvent{
+                "Reminder: if you've passed go, collect your salary and pay your interest"}});
+            break;
+        case Routine::idle_warning:
+            this->post(Event{NotificationEvent{"Nothing has happened in the last "
+                                               + std::to_string(every.count()) + " minutes"}});
+            break;
+    }
+}
+
+Result GameServer::open_auction(unsigned property_id, int starting_bid)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    if (property_id >= Game::num_properties) return {false, "No such property"};
+    const auto& property = this->game().properties[property_id];
+    if (property.owner_id) return {false, property.name() + " is already owned"};
+    if (std::atomic_load(&auction_)) return {false, "There's already an auction on"};
+
+    // Nobody can buy it, or take it any other way, until the auction ends
+    game_history_.reserve(Game::Set::only(property_id));
+    auto auction = std::make_shared<Auction>(
+        property_id, starting_bid, auction_increment, this->game().num_players(),
+        Auction::Clock::now() + auction_duration);
+    std::atomic_store(&auction_, auction);
+    auction_timer_ = scheduler_.schedule(auction->deadline(),
+                                         [this, auction] { this->end_auction(auction); });
+
+    this->post(Event{AuctionEvent{}});
+    const std::string text = "Auction of " + property.name() + " opened, bids from "
+                             + std::to_string(auction->minimum_bid());
+    this->post(Event{NotificationEvent{text}});
+    return {true, text};
+}
+
+Result GameServer::bid(unsigned player_id, int amount)
+{
+    const auto auction = std::atomic_load(&auction_);
+    if (!auction) return {false, "There's no auction on"};
+    const auto cash = std::atomic_load(&cash_);
+    const int available = player_id < cash->size() ? (*cash)[player_id] : 0;
+
+    switch (auction->bid(player_id, amount, available)) {
+        case Auction::BidResult::accepted:
+            this->announce_auction();
+            return {true, "You're the highest bidder, at " + std::to_string(amount)};
+        case Auction::BidResult::too_low:
+            return {false, "Bids must be at least " + std::to_string(auction->minimum_bid())};
+        case Auction::BidResult::cannot_afford:
+            return {false, "You only have " + std::to_string(available)};
+        case Auction::BidResult::closed:
+            return {false, "The auction has ended"};
+        case Auction::BidResult::not_a_bidder:
+            return {false, "Only players in the game when the auction opened can bid"};
+    }
+    return false;
+}
+
+void GameServer::announce_auction()
+{
+    // However many bids arrive before the next tick, one update goes out
+    if (auction_announced_.exchange(true)) return;
+    scheduler_.schedule_after(Scheduler::Clock::duration::zero(), [this] {
+        auction_announced_ = false;
+        this->post(Event{AuctionEvent{}});
+    });
+}
+
+void GameServer::end_auction(const std::shared_ptr<Auction>& auction)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    if (std::atomic_load(&auction_) != auction) return;
+
+    // Bidding is still going, so give everyone the chance to answer
+    const auto extended = auction->last_bid() + auction_extension;
+    if (auction->bids() > 0 && extended > Auction::Clock::now()) {
+        auction->extend(extended);
+        auction_timer_ = scheduler_.schedule(extended,
+                                             [this, auction] { this->end_auction(auction); });
+        this->post(Event{AuctionEvent{}});
+        return;
+    }
+
+    // Closed first, so no bid can get in while it's being settled
+    auction->close();
+    std::atomic_store(&auction_, std::shared_ptr<Auction>());
+    auction_timer_ = 0;
+
+    const unsigned property_id = auction->property_id();
+    game_history_.release(Game::Set::only(property_id));
+    const std::string property_name = this->game().properties[property_id].name();
+    std::string text = "Nobody bought " + property_name + " at auction";
+
+    // Cash may have been spent since the bids were made, so the first
+    // bidder who can still pay gets it
+    for (const auto& bid : auction->ranking()) {
+        const GameEvent event{[property_id, bid](Game& g) {
+            return buy_property(g, bid.player_id, property_id, bid.amount);
+        }};
+        if (!this->apply(event)) continue;
+
+        this->post(Event{event});
+        text = this->game().player(bid.player_id).name + " won " + property_name
+               + " at auction for " + std::to_string(bid.amount);
+        break;
+    }
+
+    this->post(Event{AuctionEvent{}});
+    this->post(Event{NotificationEvent{text}});
+}
+
+Result GameServer::check_trade_players(const Trade& terms)
+{
+    for (const auto& leg : terms.legs) {
+        if (leg.from >= this->game().num_players() || leg.to >= this->game().num_players()) {
+            return {false, "No such player"};
         }
     }
+    return true;
+}
+
+Result GameServer::propose_trade(unsigned player_id, const Trade& terms)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    if (const Result r = this->check_trade_players(terms); !r) return r;
+    const Result r = trade_book_.propose(player_id, terms, version_);
+    if (!r) return r;
+
+    this->post(Event{TradeEvent{}});
+    this->post(Event{NotificationEvent{this->game().player(player_id).name + " offered a trade: "
+                                       + describe_trade(terms, this->game())}});
+    return r;
+}
+
+Result GameServer::counter_trade(unsigned player_id, std::uint64_t offer_id, const Trade& terms)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    if (const Result r = this->check_trade_players(terms); !r) return r;
+    const Result r = trade_book_.counter(player_id, offer_id, terms, version_);
+    if (!r) return r;
+
+    this->post(Event{TradeEvent{}});
+    this->post(Event{NotificationEvent{this->game().player(player_id).name + " countered trade "
+                                       + std::to_string(offer_id) + ": "
+                                       + describe_trade(terms, this->game())}});
+    return r;
+}
+
+Result GameServer::accept_trade(unsigned player_id, std::uint64_t offer_id)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    if (const Result r = trade_book_.accept(player_id, offer_id, version_); !r) return r;
+    const auto* offer = trade_book_.find(offer_id);
+    const std::string name = this->game().player(player_id).name;
+
+    // Everyone has accepted these terms with the game as it is now, so all
+    // that's left to check is the trade itself
+    if (!offer->agreed(version_)) {
+        this->post(Event{TradeEvent{}});
+        this->post(Event{NotificationEvent{name + " accepted trade " + std::to_string(offer_id)}});
+        return {true, "Accepted, waiting for the others"};
+    }
+
+    const GameEvent event{[terms = offer->terms](Game& g) { return trade(g, terms); }};
+    const Result r = this->apply(event);
+    if (r) {
+        trade_book_.remove(offer_id);
+        this->post(Event{event});
+        this->post(Event{NotificationEvent{r.text()}});
+    } else {
+        // It stays on offer, for everyone to accept again once it can be done
+        trade_book_.reset(offer_id);
+        this->post(Event{NotificationEvent{"Trade " + std::to_string(offer_id)
+                                           + " couldn't go through: " + r.text()}});
+    }
+    this->post(Event{TradeEvent{}});
+    return r;
+}
+
+Result GameServer::reject_trade(unsigned player_id, std::uint64_t offer_id)
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    const Result r = trade_book_.reject(player_id, offer_id);
+    if (!r) return r;
+
+    this->post(Event{TradeEvent{}});
+    this->post(Event{NotificationEvent{this->game().player(player_id).name + " turned down trade "
+                                       + std::to_string(offer_id)}});
+    return r;
+}
+
+GameServer::TradeOffers GameServer::trade_offers()
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    return {trade_book_.offers(), version_};
 }
 
 // MainServer -----------------------------------------------------------------
 
+MainServer::~MainServer()
+{
+    {
+        std::unique_lock<std::mutex> lock(reaper_mutex_);
+        stopping_ = true;
+    }
+    reaper_wake_.notify_one();
+    reaper_.join();
+
+    scheduler_.stop();
+}
+
+std::string MainServer::chat_log_path(const std::string& game_name) const
+{
+    if (chat_path_.empty() || !std::filesystem::is_directory(chat_path_)) return {};
+
+    // Game names are made up by users, so keep them from naming other files
+    std::string file_name = game_name;
+    for (auto& c : file_name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-') c = '_';
+    }
+    return (std::filesystem::path(chat_path_) / (file_name + ".log")).string();
+}
+
+LobbyPage MainServer::lobby_page(std::size_t first, std::size_t count)
+{
+    const auto snapshot = this->lobby_snapshot();
+
+    LobbyPage page;
+    page.total = snapshot->games.size();
+    page.first = std::min(first, page.total);
+    page.taken = snapshot->taken;
+    const auto begin = snapshot->games.begin() + page.first;
+    page.games.assign(begin, begin + std::min(count, page.total - page.first));
+    return page;
+}
+
+std::shared_ptr<const LobbySnapshot> MainServer::lobby_snapshot()
+{
+    auto snapshot = std::atomic_load(&lobby_);
+    const auto now = std::chrono::steady_clock::now();
+    if (snapshot && now - snapshot->taken < lobby_refresh_interval) return snapshot;
+
+    // Anyone finding it being rebuilt uses the old one, unless there isn't one
+    std::unique_lock<std::mutex> lock(lobby_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        if (snapshot) return snapshot;
+        lock.lock();
+    }
+    snapshot = std::atomic_load(&lobby_);
+    if (snapshot && now - snapshot->taken < lobby_refresh_interval) return snapshot;
+
+    auto fresh = std::make_shared<LobbySnapshot>();
+    fresh->taken = now;
+    this->for_each_game_server(
+        [&fresh](GameServer& server) { fresh->games.push_back(server.summary()); });
+    std::sort(fresh->games.begin(), fresh->games.end(),
+              [](const auto& a, const auto& b) { return more_active(*a, *b); });
+
+    snapshot = std::move(fresh);
+    std::atomic_store(&lobby_, snapshot);
+    return snapshot;
+}
+
+std::size_t MainServer::reap_sessions()
+{
+    // Listed before looking at any game, so a session that starts meanwhile
+    // is either listed or connected too late to be reaped
+    const auto listed_at = std::chrono::steady_clock::now();
+    std::set<std::string> live_session_ids;
+    for (const auto& session : wserver_.sessions()) live_session_ids.insert(session.sessionId);
+
+    std::size_t reaped = 0;
+    this->for_each_game_server([&](GameServer& server) {
+        reaped += server.reap(live_session_ids, listed_at);
+    });
+    return reaped;
+}
+
+void MainServer::reap_loop()
+{
+    std::unique_lock<std::mutex> lock(reaper_mutex_);
+    while (!reaper_wake_.wait_for(lock, reap_interval, [this] { return stopping_; })) {
+        lock.unlock();
+        const auto reaped = this->reap_sessions();
+        if (reaped > 0) log("Reaped " + std::to_string(reaped) + " dead sessions");
+        lock.lock();
+    }
+}
+
+std::string MainServer::memory_report()
+{
+    std::string report;
+    std::size_t total = 0;
+
+    this->for_each_game_server([&report, &total](GameServer& server) {
+        const auto usage = server.memory_usage();
+        total += usage.total();
+
+        report += "Game " + server.name() + ": " + std::to_string(usage.total())
+                  + " bytes (history " + std::to_string(usage.history)
+                  + ", descriptions " + std::to_string(usage.descriptions)
+                  + ", clients " + std::to_string(usage.clients)
+                  + ", message log " + std::to_string(usage.message_log)
+                  + ", replay " + std::to_string(usage.replay)
+                  + ", outboxes " + std::to_string(usage.outboxes)
+                  + ", chat " + std::to_string(usage.chat) + ")\n";
+
+        for (const auto& [number, session] : server.session_memory_usage()) {
+            report += "    Session " + std::to_string(number) + ": "
+                      + std::to_string(session.widgets) + " widgets, "
+                      + std::to_string(session.message_lines) + " messages ("
+                      + std::to_string(session.message_bytes) + " bytes)\n";
+        }
+    });
+
+    std::size_t rulesets = 0;
+    for (const auto& name : rulesets_.names()) rulesets += memory_usage(*rulesets_.find(name));
+    total += rulesets;
+    report += "Rulesets, shared by every game: " + std::to_string(rulesets) + " bytes\n";
+
+    const std::size_t scheduler = scheduler_.memory_usage();
+    total += scheduler;
+    report += "Scheduler, shared by every game: " + std::to_string(scheduler) + " bytes ("
+              + std::to_string(scheduler_.pending()) + " timers pending)\n";
+
+    report += "Total: " + std::to_string(total) + " bytes";
+    return report;
+}
+
 void MainServer::interaction_loop()
 {
     std::string line;
     while (std::getline(std::cin, line)) {
-        for (auto& [server_name, server] : game_servers_) {
-            (void)server_name;
-            server.post(Event{NotificationEvent{line}});
+        // Lines starting with a slash are admin commands, anything else is
+        // broadcast to every game
+        if (line == "/memory") {
+            log(this->memory_report());
+            continue;
         }
+        if (line == "/reap") {
+            log("Reaped " + std::to_string(this->reap_sessions()) + " dead sessions");
+            continue;
+        }
+        if (line.rfind("/bot ", 0) == 0) {
+            // /bot <game> <player name>
+            std::istringstream args(line.substr(5));
+            std::string game_name, player_name;
+            args >> game_name;
+            std::getline(args >> std::ws, player_name);
+            if (game_name.empty() || player_name.empty()) {
+                log("Usage: /bot <game> <player name>");
+            } else {
+                // Games created this way use the standard ruleset
+                const auto server = this->login(game_name, rulesets_.standard().name());
+                log(server->add_bot(player_name).text());
+            }
+            continue;
+        }
+
+        this->for_each_game_server([&line](GameServer& server) {
+            server.post(Event{NotificationEvent{line}});
+        });
     }
 }
 
@@ -6,29 +6,84 @@
 #include <Wt/WPushButton.h>
 #include <Wt/WLineEdit.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <memory>
 #include <optional>
+#include <set>
+#include <thread>
 
+#include "auction.h"
+#include "bot.h"
+#include "chat_log.h"
 #include "game.h"
 #include "game_history.h"
+#include "lobby.h"
+#include "memory_usage.h"
+#include "outbox.h"
+#include "replay_buffer.h"
+#include "risk.h"
+#include "ruleset.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+#include "token_bucket.h"
+#include "trade_book.h"
 
 struct GameWidget;
 struct Event;
 struct GameEvent;
 struct AddPlayerEvent;
+struct MessageEvent;
 
-struct GameServer {
-    GameServer(Wt::WServer& server, std::string name)
-        : wserver_{server}, name_{std::move(name)}
-    {}
+// Bots play through the server like any session would
+struct GameServer : BotHost {
+    // The ruleset must outlive the server, and the scheduler must be stopped
+    // before the server is destroyed. The message history is saved to
+    // chat_log_path, unless it's empty, and loaded from it if it exists.
+    GameServer(Wt::WServer& server, std::string name, const Ruleset& ruleset,
+               ThreadPool& analysis_pool, ThreadPool& bot_pool, Scheduler& scheduler,
+               const std::string& chat_log_path = {})
+        : game_history_{Game{ruleset}}, wserver_{server}, name_{std::move(name)},
+          chat_log_{chat_log_path},
+          risk_estimator_{analysis_pool, [this] { this->post(Event{AnalysisEvent{}}); }},
+          bot_pool_{bot_pool}, scheduler_{scheduler}
+    {
+        this->update_summary();
+        this->update_cash();
+    }
+    ~GameServer();
     GameServer(const GameServer&) = delete;
     GameServer& operator=(const GameServer&) = delete;
 
-    bool connect(GameWidget*);
+    // Start sending events to the client, returning the events it missed
+    // since the cursor: the sequence number of the last event it saw, or 0
+    // for a client that has seen nothing. Events after the cursor that are
+    // no longer kept can't be caught up on, see CatchUp.
+    CatchUp connect(GameWidget*, std::optional<unsigned> player_id, std::uint64_t cursor);
 
+    // Remembers how far a player's client got, for when they come back
     bool disconnect(GameWidget*);
 
+    // Chat has a channel of its own, which never takes the game's lock, so
+    // however busy the chat gets it can't hold up the game. Limited per
+    // session and per game like admit_input, but by separate buckets.
+    // Notifications posted to the game go through the same channel, so every
+    // line of the message box is kept in the game's history in order.
+    Result send_message(const MessageEvent&);
+
+    // Send the client the messages it hasn't seen yet. Call from its session.
+    void flush_chat(GameWidget*);
+
+    // Up to count messages from the history, just before the one at index
+    // end. Reads never wait on anyone, even sending a message.
+    ChatLog::Page messages_before(std::uint64_t end, std::size_t count) const {
+        return chat_log_.page_before(end, count);
+    }
+
+    // Cursor of the player's last client to disconnect, 0 if none has
+    std::uint64_t resume_cursor(unsigned player_id);
+
     // Login and, if necessary, create a new player in the game
     // Return the player_id if successful
     std::optional<unsigned> login(std::string username);
@@ -36,54 +91,382 @@ struct GameServer {
     // Logout but do not remove the user from the game
     void logout(unsigned player_id);
 
+    // Disconnect every client whose session is not in the list of live
+    // sessions, and log out its player. Sessions normally disconnect as they
+    // end, this catches any that didn't. Clients that connected after the
+    // list was taken are left alone. Returns the number disconnected.
+    std::size_t reap(const std::set<std::string>& live_session_ids,
+                     std::chrono::steady_clock::time_point listed_at);
+
+    // Login a computer player, which plays until the server shuts down
+    Result add_bot(std::string name);
+
+    // Call before acting on anything the user of the current session does,
+    // such as sending a message or clicking a button. Takes a token from the
+    // session and one from the game, or fails taking neither if either has
+    // run out, so no one session can flood the game and no crowd of them can
+    // either. Computer players and the admin aren't limited.
+    Result admit_input();
+
     void add_player(const AddPlayerEvent&);
     Result apply(const GameEvent&);
-    Result undo() { return game_history_.undo(); }
-    Result redo() { return game_history_.redo(); }
+    Result undo();
+    Result redo();
+
+    // A private copy of the current game to try things out on. Nothing done
+    // to it is seen by anyone else unless it is merged.
+    GameFork fork();
+    // Keep everything done to the fork, as a single step. Fails if the game
+    // has changed since the fork was made.
+    Result merge(const GameFork&);
 
     void post(const Event&);
 
+    // Things the banker can have done every so often, each of which is done
+    // as if someone had done it by hand, but only while someone is connected
+    // to see it. The idle warning is given once nothing has been done to the
+    // game for that long, rather than every so often.
+    enum class Routine { raise_interest, lower_interest, passgo_reminder, idle_warning };
+    static constexpr std::size_t num_routines = 4;
+    static const char* routine_name(Routine);
+
+    // Starts the routine, or changes how often it's done if already started
+    Result start_routine(Routine, std::chrono::minutes every);
+    Result stop_routine(Routine);
+    // Nothing if the routine isn't running
+    std::optional<std::chrono::minutes> routine_interval(Routine);
+
+    // Opens an auction of an unowned property, one at a time. It ends
+    // auction_duration later, or once auction_extension has passed without
+    // a bid, whichever is later, and the property goes to the highest
+    // bidder who can still pay, by buy_property like any other purchase.
+    // Until then the property is reserved in the history, so nothing else
+    // can give it an owner.
+    Result open_auction(unsigned property_id, int starting_bid);
+
+    // Never takes the game's lock: the bid is checked against the auction
+    // and every player's cash as of the last change to the game. Everyone
+    // is told about bids at most once a scheduler tick, however many there
+    // are. Not limited by admit_input, which would take the lock.
+    Result bid(unsigned player_id, int amount);
+
+    // The auction running now, if there is one. Never takes the lock.
+    std::shared_ptr<const Auction> auction() const {
+        return std::atomic_load(&auction_);
+    }
+
+    // Trades between any number of players, each giving cash, properties or
+    // debt to another. A trade goes through, as a single step, once every
+    // party to it has accepted the latest terms without the game changing
+    // since. The proposer of any terms is taken to accept them.
+    Result propose_trade(unsigned player_id, const Trade&);
+    // New terms in place of an offer's, which the other parties have to
+    // accept again
+    Result counter_trade(unsigned player_id, std::uint64_t offer_id, const Trade&);
+    Result accept_trade(unsigned player_id, std::uint64_t offer_id);
+    Result reject_trade(unsigned player_id, std::uint64_t offer_id);
+
+    struct TradeOffers {
+        std::vector<TradeBook::Offer> offers;
+        // Version of the game the offers are accepted against
+        std::uint64_t version = 0;
+    };
+    TradeOffers trade_offers();
+
     const Game& game() const {
         return game_history_.current_game();
     }
+
+    const std::string& name() const noexcept { return name_; }
+
+    // As of the last change to the game or its clients. Never takes the lock.
+    std::shared_ptr<const GameSummary> summary() const {
+        return std::atomic_load(&summary_);
+    }
+
+    // Incremented every time the game changes
+    std::uint64_t version() override;
+
+    // Applies the event, then posts it and what it did to every client
+    Result play(const GameEvent&) override;
+
+    // Probability of each player going bankrupt in the next few laps, if the
+    // estimate for the current version of the game is ready
+    std::optional<std::vector<double>> bankruptcy_risk();
+
+    // Approximate number of bytes used by each part of the game server
+    struct MemoryUsage {
+        std::size_t history = 0;
+        std::size_t descriptions = 0;
+        std::size_t clients = 0;
+        std::size_t message_log = 0;
+        std::size_t replay = 0;
+        std::size_t outboxes = 0;
+        std::size_t chat = 0;
+
+        std::size_t total() const noexcept {
+            return history + descriptions + clients + message_log + replay + outboxes + chat;
+        }
+    };
+    MemoryUsage memory_usage();
+
+    // Sessions can't be inspected from other threads, so each session reports
+    // its own usage whenever it handles an event. Sessions are listed by the
+    // order they connected in, as their ids would let anyone take them over.
+    void report_memory_usage(GameWidget*, const SessionMemoryUsage&);
+    std::vector<std::pair<std::uint64_t, SessionMemoryUsage>> session_memory_usage();
 private:
+    // Input allowed from each session, and from every session together, in
+    // actions a second and the most that can be done at once
+    static constexpr double session_input_rate = 5;
+    static constexpr double session_input_burst = 10;
+    static constexpr double game_input_rate = 20;
+    static constexpr double game_input_burst = 40;
+
     struct ClientInfo {
         std::string session_id;
+        std::optional<unsigned> player_id = {};
+        std::chrono::steady_clock::time_point connected = {};
+        // Sequence number of the last event the client has handled, as it
+        // reports after each batch. Events taken from the outbox but not yet
+        // handled don't count, so a player resuming never skips them.
+        std::uint64_t cursor = 0;
+        SessionMemoryUsage memory_usage = {};
+        TokenBucket input_limit{session_input_rate, session_input_burst};
+        Outbox outbox = {};
+        // Whether the session has been asked to take what's in the outbox
+        bool flush_posted = false;
+        // Counted up from 1 by every connection to the game
+        std::uint64_t number = 0;
     };
 
+    // Events kept for clients to catch up on
+    static constexpr std::size_t replay_capacity = 256;
+
+    // Chat allowed from each session and from every session together
+    static constexpr double session_chat_rate = 2;
+    static constexpr double session_chat_burst = 5;
+    static constexpr double game_chat_rate = 20;
+    static constexpr double game_chat_burst = 40;
+
+    // Most messages sent to a client at once, any older are skipped. A client
+    // more than chat_max_behind messages behind isn't keeping up at all, and
+    // is disconnected.
+    static constexpr std::size_t chat_batch_limit = 256;
+    static constexpr std::size_t chat_max_behind = 4 * chat_batch_limit;
+
+    struct ChatClient {
+        std::string session_id;
+        // Index of the next message to send
+        std::uint64_t cursor = 0;
+        TokenBucket input_limit{session_chat_rate, session_chat_burst};
+        bool flush_posted = false;
+    };
+
+    // Send the client everything in its outbox. Call from its session.
+    void flush(GameWidget*);
+
+    // Add to the history and tell every client. Fails if the history is full.
+    bool publish_message(std::string text);
+
+    // Call with the mutex held, after every change to the game
+    void game_changed();
+
+    // Call with the mutex held, after every change to the game or clients
+    void update_summary();
+
+    // Call with the mutex held, after every change to the game
+    void update_cash();
+
+    static constexpr std::chrono::seconds auction_duration{30};
+    static constexpr std::chrono::seconds auction_extension{10};
+    static constexpr int auction_increment = 1;
+
+    // Run when the auction is due to end, which may put it off
+    void end_auction(const std::shared_ptr<Auction>&);
+    // Tell everyone the auction has changed, on the next scheduler tick
+    void announce_auction();
+
+    // Fails if the trade names anyone not in the game. Call with the mutex
+    // held.
+    Result check_trade_players(const Trade&);
+
+    static constexpr std::chrono::minutes max_routine_interval{24 * 60};
+
+    struct RoutineTimer {
+        std::chrono::minutes every;
+        Scheduler::Timer timer = 0;
+        // Which run this is of every routine's, so a run that was cancelled
+        // just as it was due can tell it's no longer wanted
+        std::uint64_t scheduled = 0;
+    };
+
+    // Schedule the routine's next run in place of any already scheduled.
+    // Call with the mutex held.
+    void schedule(Routine);
+    void run_routine(Routine, std::uint64_t scheduled);
+
     GameHistory game_history_;
+    std::uint64_t version_ = 0;
 
     Wt::WServer& wserver_;
     std::string name_;
+    const std::chrono::system_clock::time_point created_ = std::chrono::system_clock::now();
+    // Only ever accessed with std::atomic_load and std::atomic_store
+    std::shared_ptr<const GameSummary> summary_;
     std::map<GameWidget*, ClientInfo> clients_;
+    std::uint64_t connections_ = 0;
+    TokenBucket input_limit_{game_input_rate, game_input_burst};
+    ReplayBuffer replay_{replay_capacity};
+    std::map<unsigned, std::uint64_t> resume_cursors_;
+
+    ChatLog chat_log_;
+    // Guards the chat clients. May be taken with the game's lock held, but
+    // the game's lock is never taken with this held.
+    std::mutex chat_mutex_;
+    std::map<GameWidget*, ChatClient> chat_clients_;
+    TokenBucket chat_limit_{game_chat_rate, game_chat_burst};
 
     // Set of connected player ids, a subset of the ids of the players in
     // the game.
     std::set<unsigned> player_ids_;
 
     std::recursive_mutex mutex_;
+
+    // Destroyed (waiting for any running estimate) after the bots, which
+    // may still be changing the game
+    BankruptcyRiskEstimator risk_estimator_;
+
+    ThreadPool& bot_pool_;
+    std::vector<std::unique_ptr<Bot>> bots_;
+
+    Scheduler& scheduler_;
+    std::map<Routine, RoutineTimer> routines_;
+    std::uint64_t routines_scheduled_ = 0;
+
+    // Only ever accessed with std::atomic_load and std::atomic_store, so
+    // bids can be checked without the lock. Every player's cash.
+    std::shared_ptr<const std::vector<int>> cash_;
+    std::shared_ptr<Auction> auction_;
+    // Guarded by the mutex
+    Scheduler::Timer auction_timer_ = 0;
+    std::atomic<bool> auction_announced_{false};
+    // Guarded by the mutex, and accepted against version_
+    TradeBook trade_book_;
+    // Set while a routine changes the game, which doesn't keep it from
+    // being idle
+    bool running_routine_ = false;
 };
 
 // The main job of the MainServer is to manage GameServers
 struct MainServer {
-    MainServer(Wt::WServer& server)
-        : wserver_{server}
-    {}
+    // Loads every ruleset in rulesets_path, throwing if any of them is bad.
+    // The chat of each game is saved in chat_path, if it's a directory.
+    MainServer(Wt::WServer& server, const std::string& rulesets_path,
+               const std::string& chat_path = {})
+        : wserver_{server}, chat_path_{chat_path},
+          analysis_pool_{std::max(std::thread::hardware_concurrency(), 2u) - 1},
+          bot_pool_{1}
+    {
+        rulesets_.load_directory(rulesets_path);
+        reaper_ = std::thread([this] { this->reap_loop(); });
+    }
+    ~MainServer();
     MainServer(const MainServer&) = delete;
     MainServer& operator=(const MainServer&) = delete;
 
-    GameServer* login(std::string game_name)
+    // The ruleset is only used if the game has to be created. Returns
+    // nullptr if it does and there's no ruleset by that name.
+    GameServer* login(std::string game_name, const std::string& ruleset_name)
     {
-        const auto it
-            = game_servers_.try_emplace(game_name, wserver_, game_name).first;
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        auto it = game_servers_.find(game_name);
+        if (it == game_servers_.end()) {
+            const Ruleset* ruleset = rulesets_.find(ruleset_name);
+            if (!ruleset) return nullptr;
+            it = game_servers_.try_emplace(game_name, wserver_, game_name, *ruleset,
+                                           analysis_pool_, bot_pool_, scheduler_,
+                                           this->chat_log_path(game_name)).first;
+        }
 
         return &(it->second);
     }
 
+    // Loaded once at startup and never changed, so safe to read from any thread
+    const RulesetCatalog& rulesets() const noexcept { return rulesets_; }
+
+    // Game servers are never destroyed, so it is safe for the function to
+    // keep hold of the GameServer after it returns
+    template <typename F_of_GameServer>
+    void for_each_game_server(F_of_GameServer function)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto& [name, server] : game_servers_) {
+            (void)name;
+            function(server);
+        }
+    }
+
+    // Human readable report of the memory used by every game and session
+    std::string memory_report();
+
+    // Disconnect clients of sessions that have ended, in every game. Returns
+    // the number disconnected.
+    std::size_t reap_sessions();
+
+    // Up to count games from the lobby, starting at index first, most active
+    // first. The list is rebuilt from the games' summaries at most once every
+    // lobby_refresh_interval however many sessions ask, by only one of them
+    // at a time, and never takes any game's lock.
+    LobbyPage lobby_page(std::size_t first, std::size_t count);
+
     void interaction_loop();
 private:
-    // Probably need a mutex here
+    // How often sessions that ended without disconnecting are looked for
+    static constexpr std::chrono::seconds reap_interval{60};
+
+    void reap_loop();
+
+    // Empty if chat isn't saved
+    std::string chat_log_path(const std::string& game_name) const;
+
+    static constexpr std::chrono::seconds lobby_refresh_interval{2};
+
+    std::shared_ptr<const LobbySnapshot> lobby_snapshot();
+
     Wt::WServer& wserver_;
+    std::string chat_path_;
+
+    // Declared before the game servers, which use the rulesets until they
+    // are destroyed
+    RulesetCatalog rulesets_;
+
+    // Shared by every game for background analysis. Leaves a core free so
+    // analysis never holds up event delivery.
+    ThreadPool analysis_pool_;
+
+    // Bots think on a single shared thread, so however many are playing they
+    // never take more than one core from the sessions
+    ThreadPool bot_pool_;
+
+    // Timers for every game, run on a single thread. Stopped before the game
+    // servers are destroyed, as its tasks use them.
+    Scheduler scheduler_;
+
     std::map<std::string, GameServer> game_servers_;
+
+    std::mutex mutex_;
+
+    // Only ever accessed with std::atomic_load and std::atomic_store
+    std::shared_ptr<const LobbySnapshot> lobby_;
+    // Held by whoever is rebuilding the lobby, everyone else uses the old one
+    std::mutex lobby_mutex_;
+
+    // Stopped before anything else is destroyed
+    std::thread reaper_;
+    std::mutex reaper_mutex_;
+    std::condition_variable reaper_wake_;
+    bool stopping_ = false;
 };
 
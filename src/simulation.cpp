@@ -0,0 +1,612 @@
+#include "simulation.h"
+
+#include <chrono>
+#include <numeric>
+
+#include "board.h"
+#include "thread_pool.h"
+
+// Strategies -----------------------------------------------------------------
+
+namespace {
+
+int market_price(const Game& game, unsigned property_id)
+{
+    return game.properties[property_id].guide_price() * game.ppi;
+}
+
+int houses_on(const Game& game, PropertySet set)
+{
+    int houses = 0;
+    for_each_property(set, game, [&houses](const Property& p) { houses += p.houses; });
+    return houses;
+}
+
+// Borrow, then sell houses, then mortgage, then sell properties, until the
+// player has enough cash or has nothing left
+void liquidate(Game& game, unsigned player_id, int amount)
+{
+    const auto short_by = [&game, player_id, amount] {
+        return amount - game.player(player_id).cash;
+    };
+    if (short_by() <= 0) return;
+
+    {
+        const auto& player = game.player(player_id);
+        const int available = max_unsecured_debt(player, game) - player.unsecured_debt;
+        if (available > 0) {
+            take_out_unsecured_debt(game, player_id, std::min(available, short_by()));
+        }
+    }
+    if (short_by() <= 0) return;
+
+    {
+        const auto& player = game.player(player_id);
+        const int available = max_secured_debt(player, game) - player.secured_debt;
+        if (available > 0) {
+            take_out_secured_debt(game, player_id, std::min(available, short_by()));
+        }
+    }
+    if (short_by() <= 0) return;
+
+    for (const auto set : colour_sets) {
+        while (short_by() > 0 && (game.player(player_id).properties & set) == set
+               && houses_on(game, set) > 0) {
+            sell_houses(game, player_id, set, 1);
+        }
+    }
+    if (short_by() <= 0) return;
+
+    for (const unsigned id : property_ids(game.player(player_id).properties)) {
+        if (short_by() <= 0) return;
+        if (!game.properties[id].mortgaged() && game.properties[id].houses == 0) {
+            mortgage(game, player_id, id);
+        }
+    }
+
+    for (const unsigned id : property_ids(game.player(player_id).properties)) {
+        if (short_by() <= 0) return;
+        if (!game.properties[id].mortgaged() && game.properties[id].houses == 0) {
+            sell_property(game, player_id, id);
+        }
+    }
+}
+
+// Pay off debt, most expensive first, with any cash above reserve
+void repay_debt(Game& game, unsigned player_id, int reserve)
+{
+    const auto spare = [&game, player_id, reserve] {
+        return game.player(player_id).cash - reserve;
+    };
+
+    if (spare() > 0 && game.player(player_id).unsecured_debt > 0) {
+        pay_off_unsecured_debt(game, player_id,
+                               std::min(spare(), game.player(player_id).unsecured_debt));
+    }
+    if (spare() > 0 && game.player(player_id).secured_debt > 0) {
+        pay_off_secured_debt(game, player_id,
+                             std::min(spare(), game.player(player_id).secured_debt));
+    }
+}
+
+// Build up to max_per_set houses on each complete colour set, while keeping
+// reserve in cash
+void build(Game& game, unsigned player_id, int reserve, int max_per_set)
+{
+    for (const auto set : colour_sets) {
+        if ((game.player(player_id).properties & set) != set) continue;
+
+        bool mortgaged = false;
+        for_each_property(set, game, [&mortgaged](const Property& p) {
+            if (p.mortgaged()) mortgaged = true;
+        });
+        if (mortgaged) continue;
+
+        const int house_price = game.properties[property_id(set)].house_price();
+        const int room = std::min<int>(max_per_set, set.count() * 5) - houses_on(game, set);
+        const int affordable = (game.player(player_id).cash - reserve) / house_price;
+        const int number = std::min(room, affordable);
+        if (number > 0) build_houses(game, player_id, set, number);
+    }
+}
+
+}
+
+Strategy cautious_strategy()
+{
+    constexpr int reserve = 300;
+
+    Strategy strategy;
+    strategy.name = "cautious";
+    strategy.offer = [](const Game& game, unsigned player_id,
+                        unsigned property_id) -> std::optional<int> {
+        const int price = market_price(game, property_id);
+        if (game.player(player_id).cash - price < reserve) return {};
+        return price;
+    };
+    strategy.raise_cash = liquidate;
+    strategy.manage = [](Game& game, unsigned player_id) {
+        repay_debt(game, player_id, reserve);
+        build(game, player_id, reserve, 9);
+    };
+    return strategy;
+}
+
+Strategy aggressive_strategy()
+{
+    Strategy strategy;
+    strategy.name = "aggressive";
+    strategy.offer = [](const Game& game, unsigned player_id,
+                        unsigned property_id) -> std::optional<int> {
+        const int price = market_price(game, property_id);
+        if (game.player(player_id).cash < price) return {};
+        return price;
+    };
+    strategy.raise_cash = liquidate;
+    strategy.manage = [](Game& game, unsigned player_id) {
+        // Only repay the expensive debt, and build as much as possible
+        const int unsecured = game.player(player_id).unsecured_debt;
+        if (unsecured > 0 && game.player(player_id).cash > 2 * unsecured) {
+            pay_off_unsecured_debt(game, player_id, unsecured);
+        }
+        build(game, player_id, 50, 15);
+    };
+    return strategy;
+}
+
+Strategy passive_strategy()
+{
+    Strategy strategy;
+    strategy.name = "passive";
+    strategy.offer = [](const Game&, unsigned, unsigned) -> std::optional<int> { return {}; };
+    strategy.raise_cash = liquidate;
+    strategy.manage = [](Game& game, unsigned player_id) { repay_debt(game, player_id, 0); };
+    return strategy;
+}
+
+Strategy hold_strategy()
+{
+    Strategy strategy;
+    strategy.name = "hold";
+    strategy.offer = [](const Game&, unsigned, unsigned) -> std::optional<int> { return {}; };
+    strategy.raise_cash = liquidate;
+    strategy.manage = [](Game&, unsigned) {};
+    return strategy;
+}
+
+std::optional<Strategy> strategy_by_name(const std::string& name)
+{
+    if (name == "cautious") return cautious_strategy();
+    if (name == "aggressive") return aggressive_strategy();
+    if (name == "passive") return passive_strategy();
+    if (name == "hold") return hold_strategy();
+    return {};
+}
+
+// Simulation -----------------------------------------------------------------
+
+namespace {
+
+// Everything about a player that the Game doesn't track
+struct Seat {
+    unsigned position = 0;
+    bool in_jail = false;
+    unsigned turns_in_jail = 0;
+    unsigned get_out_of_jail_cards = 0;
+    unsigned laps = 0;
+    bool bankrupt = false;
+};
+
+struct Deck {
+    Deck(const std::array<Card, deck_size>& cards, Rng& rng)
+        : cards_{cards}
+    {
+        std::iota(order_.begin(), order_.end(), 0);
+        std::shuffle(order_.begin(), order_.end(), rng);
+    }
+
+    const Card& draw() noexcept {
+        const Card& card = cards_[order_[next_]];
+        next_ = (next_ + 1) % deck_size;
+        return card;
+    }
+private:
+    const std::array<Card, deck_size>& cards_;
+    std::array<unsigned char, deck_size> order_;
+    unsigned next_ = 0;
+};
+
+struct Table {
+    Table(const std::vector<Strategy>& strategies, Rng& rng, const Ruleset& ruleset)
+        : strategies_{strategies}, rng_{rng}, game_{ruleset}, seats_(strategies.size()),
+          chance_{chance_cards, rng}, community_chest_{community_chest_cards, rng}
+    {
+        for (const auto& strategy : strategies) game_.add_player(Player{strategy.name});
+    }
+
+    Table(const Game& game, const std::vector<Strategy>& strategies, Rng& rng)
+        : strategies_{strategies}, rng_{rng}, game_{game}, seats_(strategies.size()),
+          chance_{chance_cards, rng}, community_chest_{community_chest_cards, rng}
+    {
+        assert(strategies.size() == game.num_players());
+
+        const auto& probabilities = landing_probabilities();
+        std::discrete_distribution<unsigned> square(probabilities.begin(), probabilities.end());
+        for (auto& seat : seats_) seat.position = square(rng_);
+    }
+
+    GameOutcome play(const SimulationOptions& options)
+    {
+        GameOutcome outcome;
+
+        while (outcome.rounds < options.max_rounds && this->players_left() > 1
+               && !(options.max_laps > 0 && this->laps_completed() >= options.max_laps)) {
+            ++outcome.rounds;
+            for (unsigned player_id = 0; player_id < seats_.size(); ++player_id) {
+                if (seats_[player_id].bankrupt) continue;
+                this->turn(player_id);
+                if (!seats_[player_id].bankrupt) {
+                    strategies_[player_id].manage(game_, player_id);
+                }
+            }
+        }
+
+        if (this->players_left() == 1) {
+            for (unsigned player_id = 0; player_id < seats_.size(); ++player_id) {
+                if (!seats_[player_id].bankrupt) outcome.winner = player_id;
+            }
+        }
+        outcome.bankruptcies = bankruptcies_;
+        for (const auto& seat : seats_) outcome.bankrupt.push_back(seat.bankrupt);
+        for (const auto& player : game_.players()) {
+            outcome.net_worth.push_back(player.cash + asset_value(player, game_)
+                                        - player.secured_debt - player.unsecured_debt);
+        }
+        return outcome;
+    }
+private:
+    unsigned players_left() const noexcept
+    {
+        return std::count_if(seats_.begin(), seats_.end(),
+                             [](const Seat& s) { return !s.bankrupt; });
+    }
+
+    // Laps completed by the slowest player still in the game
+    unsigned laps_completed() const noexcept
+    {
+        unsigned laps = UINT_MAX;
+        for (const auto& seat : seats_) {
+            if (!seat.bankrupt) laps = std::min(laps, seat.laps);
+        }
+        return laps;
+    }
+
+    int roll() { return std::uniform_int_distribution<int>{1, 6}(rng_); }
+
+    void turn(unsigned player_id)
+    {
+        auto& seat = seats_[player_id];
+
+        for (unsigned doubles = 0; doubles < 3; ++doubles) {
+            const int die1 = this->roll();
+            const int die2 = this->roll();
+            const bool is_double = die1 == die2;
+
+            if (seat.in_jail) {
+                if (seat.get_out_of_jail_cards > 0) {
+                    --seat.get_out_of_jail_cards;
+                } else if (!is_double && ++seat.turns_in_jail < 3) {
+                    return;
+                } else if (!is_double && !this->pay(player_id, jail_fine, {})) {
+                    return;
+                }
+                seat.in_jail = false;
+                this->advance(player_id, die1 + die2);
+                return;
+            }
+
+            if (is_double && doubles == 2) {
+                this->send_to_jail(player_id);
+                return;
+            }
+
+            this->advance(player_id, die1 + die2);
+            if (!is_double || seat.bankrupt || seat.in_jail) return;
+        }
+    }
+
+    void advance(unsigned player_id, int squares)
+    {
+        auto& seat = seats_[player_id];
+        const unsigned destination = (seat.position + squares) % board_size;
+        this->move_to(player_id, destination, squares, true);
+    }
+
+    void move_to(unsigned player_id, unsigned destination, int dice_total, bool forwards)
+    {
+        auto& seat = seats_[player_id];
+        const bool passed_go = forwards && destination < seat.position;
+        seat.position = destination;
+        if (passed_go) ++seat.laps;
+
+        if (passed_go && !this->pass_go(player_id)) return;
+        this->land(player_id, dice_total);
+    }
+
+    void send_to_jail(unsigned player_id)
+    {
+        auto& seat = seats_[player_id];
+        seat.position = jail_square;
+        seat.in_jail = true;
+        seat.turns_in_jail = 0;
+    }
+
+    bool pass_go(unsigned player_id)
+    {
+        if (!can_afford_passgo(player_id)) {
+            const auto& player = game_.player(player_id);
+            strategies_[player_id].raise_cash(game_, player_id,
+                                              interest_to_pay(player, game_) - player.salary);
+        }
+
+        if (!passgo(game_, player_id)) {
+            this->go_bankrupt(player_id, {});
+            return false;
+        }
+        return true;
+    }
+
+    bool can_afford_passgo(unsigned player_id) const
+    {
+        const auto& player = game_.player(player_id);
+        return player.cash + player.salary >= interest_to_pay(player, game_);
+    }
+
+    void land(unsigned player_id, int dice_total)
+    {
+        const auto& square = board[seats_[player_id].position];
+
+        switch (square.type) {
+        case SquareType::property:
+            this->land_on_property(player_id, square.property_id, dice_total);
+            break;
+        case SquareType::chance:
+            this->apply(player_id, chance_.draw(), dice_total);
+            break;
+        case SquareType::community_chest:
+            this->apply(player_id, community_chest_.draw(), dice_total);
+            break;
+        case SquareType::income_tax:
+            this->pay(player_id, income_tax, {});
+            break;
+        case SquareType::super_tax:
+            this->pay(player_id, super_tax, {});
+            break;
+        case SquareType::go_to_jail:
+            this->send_to_jail(player_id);
+            break;
+        case SquareType::go:
+        case SquareType::jail:
+        case SquareType::free_parking:
+            break;
+        }
+    }
+
+    void land_on_property(unsigned player_id, unsigned property_id, int dice_total)
+    {
+        const auto& property = game_.properties[property_id];
+
+        if (!property.owner_id) {
+            const auto price = strategies_[player_id].offer(game_, player_id, property_id);
+            if (price) buy_property(game_, player_id, property_id, *price);
+            return;
+        }
+
+        const unsigned owner_id = *property.owner_id;
+        if (owner_id == player_id || seats_[owner_id].bankrupt) return;
+
+        const int amount = rent(property, game_, dice_total);
+        if (amount > 0) this->pay(player_id, amount, owner_id);
+    }
+
+    void apply(unsigned player_id, const Card& card, int dice_total)
+    {
+        auto& seat = seats_[player_id];
+
+        switch (card.action) {
+        case Card::Action::advance_to:
+            this->move_to(player_id, card.value, dice_total, true);
+            break;
+        case Card::Action::go_back:
+            this->move_to(player_id, (seat.position + board_size - card.value) % board_size,
+                          dice_total, false);
+            break;
+        case Card::Action::go_back_to:
+            this->move_to(player_id, card.value, dice_total, false);
+            break;
+        case Card::Action::go_to_jail:
+            this->send_to_jail(player_id);
+            break;
+        case Card::Action::collect:
+            pay_to_player(game_, player_id, card.value);
+            break;
+        case Card::Action::pay:
+            this->pay(player_id, card.value, {});
+            break;
+        case Card::Action::repairs: {
+            int amount = 0;
+            for_each_property(game_.player(player_id).properties, game_,
+                              [&amount, &card](const Property& p) {
+                                  amount += p.houses == 5 ? card.value2 : p.houses * card.value;
+                              });
+            if (amount > 0 && this->ensure_cash(player_id, amount)) {
+                pay_repairs(game_, player_id, card.value, card.value2);
+            }
+            break;
+        }
+        case Card::Action::get_out_of_jail:
+            ++seat.get_out_of_jail_cards;
+            break;
+        }
+    }
+
+    // Raise cash if necessary, going bankrupt to the creditor if it can't be done
+    bool ensure_cash(unsigned player_id, int amount, std::optional<unsigned> creditor = {})
+    {
+        if (game_.player(player_id).cash < amount) {
+            strategies_[player_id].raise_cash(game_, player_id, amount);
+        }
+        if (game_.player(player_id).cash < amount) {
+            this->go_bankrupt(player_id, creditor);
+            return false;
+        }
+        return true;
+    }
+
+    // Pay the creditor, or the bank if there isn't one
+    bool pay(unsigned player_id, int amount, std::optional<unsigned> creditor)
+    {
+        if (!this->ensure_cash(player_id, amount, creditor)) return false;
+
+        if (creditor) {
+            transfer(game_, player_id, *creditor, amount, 0);
+        } else {
+            pay_to_bank(game_, player_id, amount);
+        }
+        return true;
+    }
+
+    void go_bankrupt(unsigned player_id, std::optional<unsigned> creditor)
+    {
+        // Houses can't change hands, so they go back to the bank first
+        for (const auto set : colour_sets) {
+            if ((game_.player(player_id).properties & set) != set) continue;
+            const int houses = houses_on(game_, set);
+            if (houses > 0) sell_houses(game_, player_id, set, houses);
+        }
+
+        if (creditor) {
+            concede_to_player(game_, player_id, *creditor);
+        } else {
+            concede_to_bank(game_, player_id);
+        }
+
+        seats_[player_id].bankrupt = true;
+        ++bankruptcies_;
+    }
+
+    const std::vector<Strategy>& strategies_;
+    Rng& rng_;
+
+    Game game_;
+    std::vector<Seat> seats_;
+    Deck chance_;
+    Deck community_chest_;
+    unsigned bankruptcies_ = 0;
+};
+
+// Mixes bits well enough that consecutive task indices give unrelated seeds
+std::uint64_t splitmix64(std::uint64_t x) noexcept
+{
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+}
+
+GameOutcome simulate_game(const std::vector<Strategy>& strategies, Rng& rng,
+                          const SimulationOptions& options)
+{
+    Table table{strategies, rng, *options.ruleset};
+    return table.play(options);
+}
+
+GameOutcome simulate_game(const Game& game, const std::vector<Strategy>& strategies, Rng& rng,
+                          const SimulationOptions& options)
+{
+    Table table{game, strategies, rng};
+    return table.play(options);
+}
+
+double gini_coefficient(std::vector<int> values)
+{
+    for (auto& value : values) value = std::max(value, 0);
+    std::sort(values.begin(), values.end());
+
+    // With values sorted ascending, G = sum((2i - n - 1) * x_i) / (n * sum(x))
+    const double n = values.size();
+    double weighted = 0.0;
+    double total = 0.0;
+    for (unsigned i = 0; i < values.size(); ++i) {
+        weighted += (2.0 * (i + 1) - n - 1.0) * values[i];
+        total += values[i];
+    }
+    return total > 0.0 ? weighted / (n * total) : 0.0;
+}
+
+void SimulationStats::add(const GameOutcome& outcome)
+{
+    ++games;
+    rounds += outcome.rounds;
+    bankruptcies += outcome.bankruptcies;
+    gini += gini_coefficient(outcome.net_worth);
+
+    if (outcome.winner) {
+        ++finished;
+        if (wins.size() <= *outcome.winner) wins.resize(*outcome.winner + 1);
+        ++wins[*outcome.winner];
+    }
+}
+
+void SimulationStats::merge(const SimulationStats& other)
+{
+    games += other.games;
+    finished += other.finished;
+    rounds += other.rounds;
+    bankruptcies += other.bankruptcies;
+    gini += other.gini;
+
+    if (wins.size() < other.wins.size()) wins.resize(other.wins.size());
+    for (unsigned i = 0; i < other.wins.size(); ++i) wins[i] += other.wins[i];
+}
+
+void submit_games(ThreadPool& pool, std::uint64_t games, const std::vector<Strategy>& strategies,
+                  std::uint64_t seed, const SimulationOptions& options,
+                  std::vector<SimulationStats>& batch_stats)
+{
+    // Small enough batches that stealing can even out the load at the end
+    static constexpr std::uint64_t batch_size = 256;
+    const std::uint64_t batches = (games + batch_size - 1) / batch_size;
+    batch_stats.assign(batches, SimulationStats{});
+
+    for (std::uint64_t batch = 0; batch < batches; ++batch) {
+        pool.submit([&, games, seed, batch] {
+            Rng rng{splitmix64(seed ^ splitmix64(batch))};
+            SimulationStats& stats = batch_stats[batch];
+            const std::uint64_t count = std::min(batch_size, games - batch * batch_size);
+            for (std::uint64_t i = 0; i < count; ++i) {
+                stats.add(simulate_game(strategies, rng, options));
+            }
+        });
+    }
+}
+
+SimulationStats simulate_games(ThreadPool& pool, std::uint64_t games,
+                               const std::vector<Strategy>& strategies, std::uint64_t seed,
+                               const SimulationOptions& options)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<SimulationStats> batch_stats;
+    submit_games(pool, games, strategies, seed, options, batch_stats);
+    pool.wait();
+
+    SimulationStats stats;
+    stats.wins.resize(strategies.size());
+    for (const auto& batch : batch_stats) stats.merge(batch);
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Headless simulator, playing whole games on the full board (dice, jail,
+// chance and community chest) on top of the Game and its mutators. Used to
+// balance the rules before they are rolled out.
+
+struct ThreadPool;
+
+// Every task gets its own generator, seeded from the simulation seed and the
+// task index, so results don't depend on how tasks are scheduled
+using Rng = std::mt19937_64;
+
+// The decisions a simulated player makes. All decisions are carried out by
+// applying the mutators from game.cpp, exactly as a human player would.
+struct Strategy {
+    std::string name;
+
+    // Price to offer for the unowned property the player has landed on, if any
+    std::function<std::optional<int>(const Game&, unsigned player, unsigned property)> offer;
+
+    // Try to hold at least amount in cash, called when the player has to pay
+    // more than they have
+    std::function<void(Game&, unsigned player, int amount)> raise_cash;
+
+    // Build houses, repay debt etc., called at the end of each of the player's turns
+    std::function<void(Game&, unsigned player)> manage;
+};
+
+// Buys at market price while keeping a cash reserve, builds slowly and repays debt
+Strategy cautious_strategy();
+// Buys everything it can afford and builds whenever it can
+Strategy aggressive_strategy();
+// Never buys anything, only ever pays rent
+Strategy passive_strategy();
+// Keeps whatever it has, only selling or borrowing when it must pay. Useful
+// for asking what happens to a game if nobody changes anything.
+Strategy hold_strategy();
+
+std::optional<Strategy> strategy_by_name(const std::string& name);
+
+struct SimulationOptions {
+    // Board and rules that new games are played with, which must outlive the
+    // simulation. The board must have the same squares as the standard one.
+    const Ruleset* ruleset = &standard_ruleset();
+    // Games still running after this many rounds are abandoned
+    unsigned max_rounds = 1000;
+    // Stop once every player still in has passed go this many times, 0 for
+    // no limit
+    unsigned max_laps = 0;
+};
+
+struct GameOutcome {
+    unsigned rounds = 0;
+    std::optional<unsigned> winner = {};
+    unsigned bankruptcies = 0;
+    std::vector<bool> bankrupt;
+    // Cash plus assets minus debt of each player at the end of the game
+    std::vector<int> net_worth;
+};
+
+// Play a new game, one seat per strategy
+GameOutcome simulate_game(const std::vector<Strategy>&, Rng&, const SimulationOptions& = {});
+
+// Play on from an existing game, one strategy per player. The board position
+// of each player isn't part of the Game, so players start on squares drawn
+// from the landing probabilities.
+GameOutcome simulate_game(const Game&, const std::vector<Strategy>&, Rng&,
+                          const SimulationOptions& = {});
+
+struct SimulationStats {
+    std::uint64_t games = 0;
+    std::uint64_t finished = 0;
+    std::uint64_t rounds = 0;
+    std::uint64_t bankruptcies = 0;
+    // Number of games won by each seat
+    std::vector<std::uint64_t> wins;
+    // Sum over games of the Gini coefficient of the final net worths
+    double gini = 0.0;
+
+    double seconds = 0.0;
+
+    void add(const GameOutcome&);
+    void merge(const SimulationStats&);
+
+    double games_per_second() const noexcept {
+        return seconds > 0.0 ? games / seconds : 0.0;
+    }
+};
+
+// Gini coefficient of the values, with negative values counted as zero.
+// 0 when everyone has the same, approaching 1 when one has everything.
+double gini_coefficient(std::vector<int> values);
+
+// Play games, one seat per strategy, spread over every thread in the pool
+SimulationStats simulate_games(ThreadPool&, std::uint64_t games, const std::vector<Strategy>&,
+                               std::uint64_t seed, const SimulationOptions& = {});
+
+// Queue games on the pool without waiting for them. Each batch of games
+// fills its own element of batch_stats, which is complete once pool.wait()
+// returns. Everything passed by reference must outlive that. Merge the
+// batches in order, so the sums come out the same whichever finished first.
+void submit_games(ThreadPool&, std::uint64_t games, const std::vector<Strategy>&,
+                  std::uint64_t seed, const SimulationOptions&,
+                  std::vector<SimulationStats>& batch_stats);
@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+    // Index of the worker running on this thread, for submitting to its own queue
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local unsigned current_worker = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    threads = std::max(threads, 1u);
+
+    for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < threads; ++i) threads_.emplace_back([this, i] { this->run(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+
+    for (auto& thread : threads_) thread.join();
+}
+
+void ThreadPool::submit(Task task)
+{
+    unsigned queue_index;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queue_index = current_pool == this ? current_worker : next_queue_++ % queues_.size();
+        ++pending_;
+    }
+
+    {
+        auto& queue = *queues_[queue_index];
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++queued_;
+    }
+    work_available_.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    all_done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+bool ThreadPool::try_pop(unsigned worker, Task& task)
+{
+    // Newest task from our own queue first, as its data is most likely to
+    // still be in cache, then the oldest task from everyone else's
+    for (unsigned i = 0; i < queues_.size(); ++i) {
+        auto& queue = *queues_[(worker + i) % queues_.size()];
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(unsigned worker)
+{
+    current_pool = this;
+    current_worker = worker;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_available_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+            if (stopping_ && queued_ == 0) return;
+        }
+
+        Task task;
+        if (!this->try_pop(worker, task)) continue;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            --queued_;
+        }
+
+        task();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (--pending_ == 0) all_done_.notify_all();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads. Each worker has its own queue of tasks,
+// and steals from the other queues once its own runs dry, so tasks of uneven
+// length (like games of very different lengths) still keep every core busy.
+struct ThreadPool {
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const noexcept { return threads_.size(); }
+
+    // Tasks submitted from a worker go on that worker's own queue, others are
+    // spread over the queues round robin
+    void submit(Task);
+
+    // Block until every submitted task has finished
+    void wait();
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool try_pop(unsigned worker, Task&);
+    void run(unsigned worker);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable all_done_;
+    unsigned next_queue_ = 0;
+    std::size_t queued_ = 0;   // Tasks waiting in a queue
+    std::size_t pending_ = 0;  // Tasks waiting or running
+    bool stopping_ = false;
+};
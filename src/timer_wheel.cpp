@@ -0,0 +1,141 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <cassert>
+
+TimerWheel::Id TimerWheel::insert(Tick deadline, Callback callback)
+{
+    deadline = std::clamp(deadline, now_ + 1, now_ + max_delay);
+
+    std::uint32_t node = free_;
+    if (node == none) {
+        node = nodes_.size();
+        nodes_.emplace_back();
+    } else {
+        free_ = nodes_[node].next;
+    }
+
+    nodes_[node].deadline = deadline;
+    nodes_[node].callback = std::move(callback);
+    this->link(node);
+    ++size_;
+    return Id(nodes_[node].generation) << 32 | node;
+}
+
+bool TimerWheel::cancel(Id id)
+{
+    const std::uint32_t node = id & 0xffffffff;
+    if (node >= nodes_.size()) return false;
+    if (nodes_[node].generation != id >> 32 || nodes_[node].slot == none) return false;
+
+    this->unlink(node);
+    this->free(node);
+    --size_;
+    return true;
+}
+
+void TimerWheel::advance(Tick now, std::vector<Callback>& due)
+{
+    // Nothing can fire on the way, so there's no need to visit every tick
+    while (now_ < now) {
+        if (size_ == 0) {
+            now_ = now;
+            return;
+        }
+        ++now_;
+        this->tick(due);
+    }
+}
+
+std::size_t TimerWheel::memory_usage() const noexcept
+{
+    return sizeof(TimerWheel) + nodes_.capacity() * sizeof(Node);
+}
+
+std::uint32_t TimerWheel::slot_for(Tick deadline) const noexcept
+{
+    assert(deadline >= now_ && deadline - now_ <= max_delay);
+
+    const Tick delay = deadline - now_;
+    std::size_t wheel = 0;
+    while (delay >> (slot_bits * (wheel + 1)) != 0) ++wheel;
+    const std::size_t index = (deadline >> (slot_bits * wheel)) & (slots_per_wheel - 1);
+    return wheel * slots_per_wheel + index;
+}
+
+void TimerWheel::link(std::uint32_t node)
+{
+    // Added at the back, so timers due on the same tick fire in the order
+    // they were inserted
+    const std::uint32_t slot = this->slot_for(nodes_[node].deadline);
+    nodes_[node].slot = slot;
+    nodes_[node].previous = tails_[slot];
+    nodes_[node].next = none;
+    if (tails_[slot] == none) {
+        heads_[slot] = node;
+    } else {
+        nodes_[tails_[slot]].next = node;
+    }
+    tails_[slot] = node;
+}
+
+void TimerWheel::unlink(std::uint32_t node)
+{
+    const Node& n = nodes_[node];
+    if (n.previous == none) {
+        heads_[n.slot] = n.next;
+    } else {
+        nodes_[n.previous].next = n.next;
+    }
+    if (n.next == none) {
+        tails_[n.slot] = n.previous;
+    } else {
+        nodes_[n.next].previous = n.previous;
+    }
+}
+
+void TimerWheel::free(std::uint32_t node)
+{
+    Node& n = nodes_[node];
+    n.callback = nullptr;
+    n.slot = none;
+    if (++n.generation == 0) n.generation = 1;
+    n.next = free_;
+    free_ = node;
+}
+
+void TimerWheel::cascade(std::size_t wheel)
+{
+    const std::size_t slot
+        = wheel * slots_per_wheel + ((now_ >> (slot_bits * wheel)) & (slots_per_wheel - 1));
+
+    std::uint32_t node = heads_[slot];
+    heads_[slot] = none;
+    tails_[slot] = none;
+    while (node != none) {
+        const std::uint32_t next = nodes_[node].next;
+        this->link(node);
+        node = next;
+    }
+}
+
+void TimerWheel::tick(std::vector<Callback>& due)
+{
+    // Coarser wheels first, as their timers may move into a slot of the
+    // wheel below that is itself due to move down on this tick
+    std::size_t top = 0;
+    while (top + 1 < wheels && (now_ & ((Tick(1) << (slot_bits * (top + 1))) - 1)) == 0) ++top;
+    for (std::size_t wheel = top; wheel > 0; --wheel) this->cascade(wheel);
+
+    const std::size_t slot = now_ & (slots_per_wheel - 1);
+    std::uint32_t node = heads_[slot];
+    heads_[slot] = none;
+    tails_[slot] = none;
+    while (node != none) {
+        const std::uint32_t next = nodes_[node].next;
+        due.push_back(std::move(nodes_[node].callback));
+        this->free(node);
+        --size_;
+        node = next;
+    }
+}
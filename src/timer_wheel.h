@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Timers counted in whole ticks, any number of which can be pending, each
+// inserted or cancelled in constant time however many there are. Not thread
+// safe, see Scheduler for that.
+//
+// Timers due within the next 256 ticks sit in the slot for their tick on the
+// first of four wheels of 256 slots. Later ones sit on the coarser wheels,
+// whose slots each span 256 slots of the wheel below, and move down a wheel
+// whenever the wheel below comes round to the start of their slot, so each
+// timer is moved at most three times before it fires. Deadlines up to 2^32
+// ticks away can be told apart; later ones fire at 2^32 - 1 ticks.
+struct TimerWheel {
+    using Tick = std::uint64_t;
+    using Callback = std::function<void()>;
+    // Identifies a timer to cancel it. Never 0, so 0 can mean no timer.
+    using Id = std::uint64_t;
+
+    static constexpr std::size_t wheels = 4;
+    static constexpr std::size_t slot_bits = 8;
+    static constexpr std::size_t slots_per_wheel = 1 << slot_bits;
+    static constexpr Tick max_delay = (Tick(1) << (wheels * slot_bits)) - 1;
+
+    explicit TimerWheel(Tick now = 0) : now_{now} {}
+
+    // Deadlines that have already passed are due on the next tick
+    Id insert(Tick deadline, Callback);
+
+    // Returns false if the timer has already fired or been cancelled
+    bool cancel(Id);
+
+    // Moves time on to now, appending the callback of every timer due by
+    // then to due, earliest deadline first. Callbacks aren't called here, so
+    // the caller can call them once it has let go of any lock of its own.
+    void advance(Tick now, std::vector<Callback>& due);
+
+    Tick now() const noexcept { return now_; }
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    std::size_t memory_usage() const noexcept;
+private:
+    static constexpr std::uint32_t none = ~std::uint32_t(0);
+
+    // Timers are kept in one array, and linked into their slot's list by
+    // index. Free ones are linked into a list of their own through next.
+    struct Node {
+        Tick deadline = 0;
+        Callback callback;
+        std::uint32_t previous = none;
+        std::uint32_t next = none;
+        std::uint32_t slot = none;
+        // Bumped every time the node is freed, so an old Id can't cancel
+        // whichever timer uses the node next
+        std::uint32_t generation = 1;
+    };
+
+    std::uint32_t slot_for(Tick deadline) const noexcept;
+    void link(std::uint32_t node);
+    void unlink(std::uint32_t node);
+    void free(std::uint32_t node);
+    // Moves every timer in the slot to the wheel below
+    void cascade(std::size_t wheel);
+    void tick(std::vector<Callback>& due);
+
+    std::vector<Node> nodes_;
+    std::uint32_t free_ = none;
+    std::array<std::uint32_t, wheels * slots_per_wheel> heads_ = make_heads();
+    std::array<std::uint32_t, wheels * slots_per_wheel> tails_ = make_heads();
+    Tick now_;
+    std::size_t size_ = 0;
+
+    static constexpr std::array<std::uint32_t, wheels * slots_per_wheel> make_heads() {
+        std::array<std::uint32_t, wheels * slots_per_wheel> heads{};
+        for (auto& head : heads) head = none;
+        return heads;
+    }
+};
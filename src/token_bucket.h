@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+// Allows bursts of up to burst actions, refilling at rate actions a second
+struct TokenBucket {
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(double rate, double burst, Clock::time_point now = Clock::now())
+        : rate_{rate}, burst_{burst}, tokens_{burst}, last_refill_{now}
+    {
+        assert(rate > 0 && burst >= 1);
+    }
+
+    // Whether a token can be taken now. Taking is separate, so that a token
+    // is only taken from one bucket once every bucket involved has one.
+    bool ready(Clock::time_point now) noexcept {
+        const std::chrono::duration<double> elapsed = now - last_refill_;
+        tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+        last_refill_ = now;
+        return tokens_ >= 1;
+    }
+
+    void take() noexcept {
+        assert(tokens_ >= 1);
+        tokens_ -= 1;
+    }
+
+    bool try_take(Clock::time_point now) noexcept {
+        if (!this->ready(now)) return false;
+        this->take();
+        return true;
+    }
+private:
+    double rate_;
+    double burst_;
+    double tokens_;
+    Clock::time_point last_refill_;
+};
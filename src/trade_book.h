@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Trades being negotiated in one game. A player offers a trade, any party to
+// it can counter with other terms, and once every party has accepted the
+// latest terms it can be done, as a single step of the game.
+//
+// Acceptances are tied to the game's version number, so an offer never goes
+// through on terms someone agreed to before the game changed under them:
+// each party's acceptance is stale once the version moves on, which is
+// checked with a single comparison, without looking at the game at all. The
+// trade itself is still checked in full when it's done.
+//
+// Not thread safe. GameServer keeps it under the game's lock.
+struct TradeBook {
+    static constexpr std::size_t max_offers = 32;
+
+    struct Offer {
+        // Never reused
+        std::uint64_t id = 0;
+        // Counted up by every counter offer
+        unsigned revision = 1;
+        Trade terms;
+        // Whoever made the latest terms
+        unsigned proposer = 0;
+        // Everyone giving or receiving anything, in order of id
+        std::vector<unsigned> parties;
+        // Version of the game when each party accepted the latest terms, 0
+        // if they haven't
+        std::vector<std::uint64_t> accepted;
+
+        // Whether every party has accepted with the game as it is now
+        bool agreed(std::uint64_t version) const noexcept {
+            return std::all_of(accepted.begin(), accepted.end(),
+                               [version](std::uint64_t v) { return v == version; });
+        }
+        // Parties yet to accept with the game as it is now
+        std::vector<unsigned> waiting_for(std::uint64_t version) const {
+            std::vector<unsigned> waiting;
+            for (std::size_t i = 0; i < parties.size(); ++i) {
+                if (accepted[i] != version) waiting.push_back(parties[i]);
+            }
+            return waiting;
+        }
+        bool involves(unsigned player_id) const noexcept {
+            return std::binary_search(parties.begin(), parties.end(), player_id);
+        }
+    };
+
+    // Fails, saying why, if the terms don't make sense whatever the game
+    // holds, the player isn't a party, or there are too many offers already
+    Result propose(unsigned player_id, Trade terms, std::uint64_t version) {
+        if (offers_.size() >= max_offers) {
+            return {false, "There are too many trades on offer, accept or turn some down first"};
+        }
+        const Result r = check_terms(player_id, terms);
+        if (!r) return r;
+
+        Offer offer;
+        offer.id = next_id_++;
+        offer.proposer = player_id;
+        offer.terms = std::move(terms);
+        this->set_parties(offer, player_id, version);
+        offers_.push_back(std::move(offer));
+        return {true, "Trade " + std::to_string(offers_.back().id) + " offered"};
+    }
+
+    // New terms in place of the old, which every other party has to accept
+    // again. Only a party to both the old and the new terms can counter.
+    Result counter(unsigned player_id, std::uint64_t id, Trade terms, std::uint64_t version) {
+        Offer* offer = this->find(id);
+        if (!offer) return {false, "That trade is no longer on offer"};
+        if (!offer->involves(player_id)) return {false, "Only parties to a trade can counter it"};
+        const Result r = check_terms(player_id, terms);
+        if (!r) return r;
+
+        ++offer->revision;
+        offer->proposer = player_id;
+        offer->terms = std::move(terms);
+        this->set_parties(*offer, player_id, version);
+        return {true, "Trade " + std::to_string(id) + " countered"};
+    }
+
+    // Once every party has accepted, agreed() is true for the offer
+    Result accept(unsigned player_id, std::uint64_t id, std::uint64_t version) {
+        Offer* offer = this->find(id);
+        if (!offer) return {false, "That trade is no longer on offer"};
+        const auto party = std::lower_bound(offer->parties.begin(), offer->parties.end(),
+                                            player_id);
+        if (party == offer->parties.end() || *party != player_id) {
+            return {false, "Only parties to a trade can accept it"};
+        }
+
+        offer->accepted[party - offer->parties.begin()] = version;
+        return true;
+    }
+
+    // Any party can turn a trade down, which takes it off the table
+    Result reject(unsigned player_id, std::uint64_t id) {
+        const auto it = std::find_if(offers_.begin(), offers_.end(),
+                                     [id](const Offer& offer) { return offer.id == id; });
+        if (it == offers_.end()) return {false, "That trade is no longer on offer"};
+        if (!it->involves(player_id)) return {false, "Only parties to a trade can turn it down"};
+        offers_.erase(it);
+        return true;
+    }
+
+    // Clears every acceptance, such as when a trade everyone agreed to
+    // couldn't be done after all
+    void reset(std::uint64_t id) {
+        if (Offer* offer = this->find(id)) offer->accepted.assign(offer->parties.size(), 0);
+    }
+
+    // Takes a trade off the table once done
+    void remove(std::uint64_t id) {
+        offers_.erase(std::remove_if(offers_.begin(), offers_.end(),
+                                     [id](const Offer& offer) { return offer.id == id; }),
+                      offers_.end());
+    }
+
+    Offer* find(std::uint64_t id) {
+        const auto it = std::find_if(offers_.begin(), offers_.end(),
+                                     [id](const Offer& offer) { return offer.id == id; });
+        return it == offers_.end() ? nullptr : &*it;
+    }
+
+    const std::vector<Offer>& offers() const noexcept { return offers_; }
+private:
+    static Result check_terms(unsigned player_id, const Trade& terms) {
+        if (terms.legs.empty()) return {false, "Nothing to trade"};
+        bool party = false;
+        // Every leg is netted when the trade is done, so the totals must fit
+        // in an int too
+        std::int64_t cash = 0;
+        std::int64_t secured_debt = 0;
+        std::int64_t unsecured_debt = 0;
+        for (const auto& leg : terms.legs) {
+            if (leg.from == leg.to) return {false, "Players can't trade with themselves"};
+            if (leg.cash < 0 || leg.secured_debt < 0 || leg.unsecured_debt < 0) {
+                return {false, "Amounts traded can't be negative"};
+            }
+            cash += leg.cash;
+            secured_debt += leg.secured_debt;
+            unsecured_debt += leg.unsecured_debt;
+            party = party || leg.from == player_id || leg.to == player_id;
+        }
+        constexpr std::int64_t most = std::numeric_limits<int>::max();
+        if (cash > most || secured_debt > most || unsecured_debt > most) {
+            return {false, "That's more than can be traded"};
+        }
+        if (!party) return {false, "Only trades you're a party to can be offered"};
+        return true;
+    }
+
+    // Only the proposer has accepted the new terms
+    static void set_parties(Offer& offer, unsigned proposer, std::uint64_t version) {
+        offer.parties.clear();
+        for (const auto& leg : offer.terms.legs) {
+            offer.parties.push_back(leg.from);
+            offer.parties.push_back(leg.to);
+        }
+        std::sort(offer.parties.begin(), offer.parties.end());
+        offer.parties.erase(std::unique(offer.parties.begin(), offer.parties.end()),
+                            offer.parties.end());
+
+        offer.accepted.assign(offer.parties.size(), 0);
+        const auto party = std::lower_bound(offer.parties.begin(), offer.parties.end(), proposer);
+        offer.accepted[party - offer.parties.begin()] = version;
+    }
+
+    std::vector<Offer> offers_;
+    std::uint64_t next_id_ = 1;
+};
+
+// In words, such as "A gives B £100 and Mayfair; B takes over £50 of A's
+// secured debt"
+inline std::string describe_trade(const Trade& terms, const Game& game)
+{
+    std::vector<std::string> clauses;
+    for (const auto& leg : terms.legs) {
+        const auto& from = game.player(leg.from).name;
+        const auto& to = game.player(leg.to).name;
+
+        std::vector<std::string> gives;
+        if (leg.cash > 0) gives.push_back("£" + std::to_string(leg.cash));
+        for_each_property(leg.properties, game,
+                          [&gives](const Property& p) { gives.push_back(p.name()); });
+        if (!gives.empty()) {
+            std::string clause = from + " gives " + to + " ";
+            for (std::size_t i = 0; i < gives.size(); ++i) {
+                if (i > 0) clause += i + 1 == gives.size() ? " and " : ", ";
+                clause += gives[i];
+            }
+            clauses.push_back(std::move(clause));
+        }
+        if (leg.secured_debt > 0) {
+            clauses.push_back(to + " takes over £" + std::to_string(leg.secured_debt) + " of "
+                              + from + "'s secured debt");
+        }
+        if (leg.unsecured_debt > 0) {
+            clauses.push_back(to + " takes over £" + std::to_string(leg.unsecured_debt) + " of "
+                              + from + "'s unsecured debt");
+        }
+    }
+
+    std::string text;
+    for (const auto& clause : clauses) {
+        if (!text.empty()) text += "; ";
+        text += clause;
+    }
+    return text.empty() ? "Nothing" : text;
+}
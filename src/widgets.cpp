@@ -3,6 +3,10 @@
 #include "servers.h"
 #include "game.h"
 
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <Wt/WVBoxLayout.h>
 #include <Wt/WRadioButton.h>
@@ -19,32 +23,51 @@ bool is_positive_int(const std::string& s)
 
 namespace {
 
+void alert(Wt::WContainerWidget* widget, const std::string& text)
+{
+    if (widget) {
+        auto* popup = widget->addChild(std::make_unique<Popup>(Popup::Alert, text, ""));
+        popup->show.exec();
+    }
+}
+
+// Whether the server will take input from this session now, explaining why
+// not if it won't
+bool admitted(GameServer& server, Wt::WContainerWidget* widget)
+{
+    const Result r = server.admit_input();
+    if (!r) alert(widget, r.text());
+    return bool(r);
+}
+
 void attempt_to_send(const UndoEvent& event, GameServer& server, Wt::WContainerWidget* widget)
 {
+    if (!admitted(server, widget)) return;
     const Result r = server.undo();
 
     if (r) {
         server.post(Event{event});
-        server.post(Event{NotificationEvent{r.description()}});
+        server.post(Event{NotificationEvent{r.text()}});
     } else {
         if (widget) {
             auto* popup = widget->addChild(
-                std::make_unique<Popup>(Popup::Alert, r.description(), ""));
+                std::make_unique<Popup>(Popup::Alert, r.text(), ""));
             popup->show.exec();
         }
     }
 }
 void attempt_to_send(const RedoEvent& event, GameServer& server, Wt::WContainerWidget* widget)
 {
+    if (!admitted(server, widget)) return;
     const Result r = server.redo();
 
     if (r) {
         server.post(Event{event});
-        server.post(Event{NotificationEvent{r.description()}});
+        server.post(Event{NotificationEvent{r.text()}});
     } else {
         if (widget) {
             auto* popup = widget->addChild(
-                std::make_unique<Popup>(Popup::Alert, r.description(), ""));
+                std::make_unique<Popup>(Popup::Alert, r.text(), ""));
             popup->show.exec();
         }
     }
@@ -52,15 +75,16 @@ void attempt_to_send(const RedoEvent& event, GameServer& server, Wt::WContainerW
 
 void attempt_to_send(const GameEvent& event, GameServer& server, Wt::WContainerWidget* widget)
 {
+    if (!admitted(server, widget)) return;
     const Result r = server.apply(event);
 
     if (r) {
         server.post(Event{event});
-        server.post(Event{NotificationEvent{r.description()}});
+        server.post(Event{NotificationEvent{r.text()}});
     } else {
         if (widget) {
             auto* popup = widget->addChild(
-                std::make_unique<Popup>(Popup::Alert, "Error: " + r.description(), ""));
+                std::make_unique<Popup>(Popup::Alert, "Error: " + r.text(), ""));
             popup->show.exec();
         }
     }
@@ -78,6 +102,33 @@ int get_positive_int(const Wt::WLineEdit* const line_edit)
     return std::stoi(s);
 }
 
+// Counts the widgets in the tree rooted at widget, including those managed by
+// layouts and table cells. Message widgets keep their own count, and are not
+// included so that the potentially very long message log isn't walked.
+std::size_t count_widgets(Wt::WWidget* widget)
+{
+    if (!widget || dynamic_cast<MessageWidget*>(widget)) return 0;
+
+    std::size_t count = 1;
+    if (auto* table = dynamic_cast<Wt::WTable*>(widget)) {
+        for (int row = 0; row < table->rowCount(); ++row) {
+            for (int column = 0; column < table->columnCount(); ++column) {
+                count += count_widgets(table->elementAt(row, column));
+            }
+        }
+    } else if (auto* container = dynamic_cast<Wt::WContainerWidget*>(widget)) {
+        if (auto* layout = container->layout()) {
+            for (int i = 0; i < layout->count(); ++i) {
+                count += count_widgets(layout->itemAt(i)->widget());
+            }
+        }
+        for (int i = 0; i < container->count(); ++i) {
+            count += count_widgets(container->widget(i));
+        }
+    }
+    return count;
+}
+
 }
 
 // MessageWidget --------------------------------------------------------------
@@ -100,6 +151,9 @@ MessageWidget::MessageWidget(GameServer& server, std::optional<unsigned> player_
                              bool banker)
     : server_{server}
 {
+    earlier_button_ = this->addWidget(std::make_unique<Wt::WPushButton>("Earlier messages"));
+    earlier_button_->hide();
+
     messages_ = this->addWidget(std::make_unique<Wt::WContainerWidget>());
     messages_->setHeight(100);
     messages_->setOverflow(Wt::Overflow::Auto);
@@ -109,30 +163,75 @@ MessageWidget::MessageWidget(GameServer& server, std::optional<unsigned> player_
         = this->addWidget(std::make_unique<Wt::WPushButton>("Send"));
 
     const auto send_message = [this, player_id] {
-        const auto message_text = input_box_->text();
+        const MessageEvent message{input_box_->text().narrow(),
+                                   name_from_id(player_id, server_.game())};
+        const Result r = server_.send_message(message);
+        if (!r) {
+            alert(this, r.text());
+            return;
+        }
         input_box_->setText("");
-        const auto e = Event(MessageEvent{
-            message_text.narrow(), name_from_id(player_id, server_.game())});
-        server_.post(e);
     };
 
     send_message_button_->mouseWentDown().connect(send_message);
     input_box_->enterPressed().connect(send_message);
 
-    // Send a welcome message to the user
-    const std::string welcome_message = [this, player_id, banker] {
+    earlier_button_->mouseWentDown().connect([this] {
+        this->show_earlier(server_.messages_before(first_, page_size));
+    });
+
+    // Shown once the history has been paged in
+    welcome_message_ = [this, player_id, banker] {
         std::string txt
             = "Welcome "s + (banker ? "Banker " : "")
               + (player_id ? server_.game().player(*player_id).name : ""s);
         if (txt == "Welcome ") txt += "casual observer";
         return txt;
     }();
-    this->push(welcome_message);
+}
+
+void MessageWidget::join()
+{
+    // Everything up to the newest message, however many there are now
+    const auto page = server_.messages_before(ChatLog::capacity, page_size);
+    first_ = end_ = page.first;
+    this->append(page);
+    earlier_button_->setHidden(first_ == 0);
+    this->push(std::move(welcome_message_));
+}
+
+void MessageWidget::append(const ChatLog::Page& page)
+{
+    // Pages may overlap what's already shown, and may start after it if
+    // some had to be skipped
+    if (page.first > end_) {
+        this->push(std::to_string(page.first - end_) + " messages were missed while busy");
+    }
+    for (auto i = std::max(page.first, end_); i < page.end(); ++i) {
+        this->push(page.messages[i - page.first]);
+    }
+    end_ = std::max(end_, page.end());
+}
+
+void MessageWidget::show_earlier(const ChatLog::Page& page)
+{
+    // Inserted at the top from the newest back, each as a break then the text
+    for (auto i = page.messages.size(); i-- > 0;) {
+        ++line_count_;
+        byte_count_ += page.messages[i].size();
+        messages_->insertWidget(0, std::make_unique<Wt::WText>(page.messages[i]));
+        messages_->insertWidget(0, std::make_unique<Wt::WBreak>());
+    }
+    first_ = std::min(first_, page.first);
+    earlier_button_->setHidden(first_ == 0);
 }
 
 // Push a string to the message widget to display
 void MessageWidget::push(std::string s)
 {
+    ++line_count_;
+    byte_count_ += s.size();
+
     messages_->addWidget(std::make_unique<Wt::WBreak>());
     messages_->addWidget(std::make_unique<Wt::WText>(std::move(s)));
 
@@ -159,6 +258,7 @@ InfoWidget::InfoWidget(GameServer& server)
     player_table_->elementAt(0, 4)->addWidget(std::make_unique<Wt::WText>("Secured debt"));
     player_table_->elementAt(0, 5)->addWidget(std::make_unique<Wt::WText>("Unsecured debt"));
     player_table_->elementAt(0, 6)->addWidget(std::make_unique<Wt::WText>("Interest to pay"));
+    player_table_->elementAt(0, 7)->addWidget(std::make_unique<Wt::WText>("Bankruptcy risk"));
     for (unsigned player_id = 0; player_id < server_.game().num_players(); ++player_id) {
         this->add_player(player_id);
     }
@@ -168,14 +268,15 @@ InfoWidget::InfoWidget(GameServer& server)
 
 void InfoWidget::add_player(unsigned player_id)
 {
-    player_info_.push_back(std::array<Wt::WText*, 7>{
+    player_info_.push_back(std::array<Wt::WText*, 8>{
         player_table_->elementAt(player_id + 1, 0)->addWidget(std::make_unique<Wt::WText>()),
         player_table_->elementAt(player_id + 1, 1)->addWidget(std::make_unique<Wt::WText>()),
         player_table_->elementAt(player_id + 1, 2)->addWidget(std::make_unique<Wt::WText>()),
         player_table_->elementAt(player_id + 1, 3)->addWidget(std::make_unique<Wt::WText>()),
         player_table_->elementAt(player_id + 1, 4)->addWidget(std::make_unique<Wt::WText>()),
         player_table_->elementAt(player_id + 1, 5)->addWidget(std::make_unique<Wt::WText>()),
-        player_table_->elementAt(player_id + 1, 6)->addWidget(std::make_unique<Wt::WText>())
+        player_table_->elementAt(player_id + 1, 6)->addWidget(std::make_unique<Wt::WText>()),
+        player_table_->elementAt(player_id + 1, 7)->addWidget(std::make_unique<Wt::WText>())
     });
 }
 
@@ -186,10 +287,10 @@ void InfoWidget::update()
     secured_interest_->setText("Secured interest: " + std::to_string(game.secured_interest()));
     unsecured_interest_->setText("Unsecured interest: " +
                                  std::to_string(game.unsecured_interest()));
-    ppi_->setText("PPI: " + std::to_string(server_.game().ppi));
+    ppi_->setText("PPI: " + server_.game().ppi.to_string());
 
     // Player information
-    assert(player_info_.size() <= game.num_players());
+    while (player_info_.size() < game.num_players()) this->add_player(player_info_.size());
     for (unsigned player_id = 0; player_id < player_info_.size(); ++player_id) {
         const auto& player = game.player(player_id);
         player_info_[player_id][0]->setText(player.name);
@@ -202,6 +303,23 @@ void InfoWidget::update()
                                             std::to_string(max_unsecured_debt(player, game)));
         player_info_[player_id][6]->setText(std::to_string(interest_to_pay(player, game)));
     }
+
+    this->update_analysis();
+}
+
+void InfoWidget::update_analysis()
+{
+    // The estimate is made in the background, until it is ready for this
+    // version of the game there is nothing to show
+    const auto risk = server_.bankruptcy_risk();
+    for (unsigned player_id = 0; player_id < player_info_.size(); ++player_id) {
+        if (risk && player_id < risk->size()) {
+            const int percent = std::lround(100.0 * (*risk)[player_id]);
+            player_info_[player_id][7]->setText(std::to_string(percent) + "%");
+        } else {
+            player_info_[player_id][7]->setText("...");
+        }
+    }
 }
 
 // PlayerWidget
@@ -216,11 +334,12 @@ PlayerWidget::PlayerWidget(GameServer& server, unsigned player_id)
         buy_combobox_ = this->addWidget(std::make_unique<Wt::WComboBox>());
         buy_amount_ = this->addWidget(std::make_unique<Wt::WLineEdit>());
         buy_button_ = this->addWidget(std::make_unique<Wt::WPushButton>("Buy property"));
-        const auto buy_function = [this, &game, &player] {
+        const auto buy_function = [this, &player] {
             const int amount = get_positive_int(buy_amount_);
             if (amount < 0) return;
-            const unsigned property_id =
-                game.id_of_property(buy_combobox_->currentText().narrow());
+            const int index = buy_combobox_->currentIndex();
+            if (index < 0 || unsigned(index) >= buy_property_ids_.size()) return;
+            const unsigned property_id = buy_property_ids_[index];
             buy_amount_->setText("");
 
             const auto function = [=](Game& g) {
@@ -231,12 +350,25 @@ PlayerWidget::PlayerWidget(GameServer& server, unsigned player_id)
             attempt_to_send(event, server_, this);
         };
         buy_button_->mouseWentDown().connect(buy_function);
+
+        auction_button_ = this->addWidget(std::make_unique<Wt::WPushButton>("Auction"));
+        auction_button_->mouseWentDown().connect([this] {
+            const int amount = get_positive_int(buy_amount_);
+            if (amount < 0) return;
+            const int index = buy_combobox_->currentIndex();
+            if (index < 0 || unsigned(index) >= buy_property_ids_.size()) return;
+            if (!admitted(server_, this)) return;
+            buy_amount_->setText("");
+
+            const Result r = server_.open_auction(buy_property_ids_[index], amount);
+            if (!r) alert(this, r.text());
+        });
     }
 
     // Property selector/displayer
     auto* container = this->addWidget(std::make_unique<Wt::WContainerWidget>());
     auto* vbox = container->setLayout(std::make_unique<Wt::WVBoxLayout>());
-    for (unsigned i = 0; i < 28; ++i) {
+    for (unsigned i = 0; i < Game::num_properties; ++i) {
         const auto& property = server_.game().properties[i];
         properties_[i] = vbox->addWidget(std::make_unique<PropertySelectWidget>(property));
         properties_[i]->setHidden(true);
@@ -245,7 +377,7 @@ PlayerWidget::PlayerWidget(GameServer& server, unsigned player_id)
     { // Sell property
         sell_properties_ = this->addWidget(std::make_unique<Wt::WPushButton>("Sell properties"));
         const auto sell_function = [this] {
-            for (unsigned property_id = 0; property_id < 28; ++property_id) {
+            for (unsigned property_id = 0; property_id < Game::num_properties; ++property_id) {
                 if (!properties_[property_id]->checked()) continue;
 
                 const auto function = [=](Game& g) {
@@ -263,7 +395,7 @@ PlayerWidget::PlayerWidget(GameServer& server, unsigned player_id)
         mortgage_properties_ =
             this->addWidget(std::make_unique<Wt::WPushButton>("Mortgage properties"));
         const auto mortgage_function = [this] {
-            for (unsigned property_id = 0; property_id < 28; ++property_id) {
+            for (unsigned property_id = 0; property_id < Game::num_properties; ++property_id) {
                 if (!properties_[property_id]->checked()) continue;
 
                 const auto function = [=](Game& g) {
@@ -281,7 +413,7 @@ PlayerWidget::PlayerWidget(GameServer& server, unsigned player_id)
         unmortgage_properties_ =
             this->addWidget(std::make_unique<Wt::WPushButton>("Unmortgage properties"));
         const auto unmortgage_function = [this] {
-            for (unsigned property_id = 0; property_id < 28; ++property_id) {
+            for (unsigned property_id = 0; property_id < Game::num_properties; ++property_id) {
                 if (!properties_[property_id]->checked()) continue;
 
                 const auto function = [=](Game& g) {
@@ -309,8 +441,8 @@ PlayerWidget::PlayerWidget(GameServer& server, unsigned player_id)
             amount_to_transfer_->setText("");
             const PropertySet properties = [this]() {
                 PropertySet set;
-                for (unsigned property_id = 0; property_id < 28; ++property_id) {
-                    set[property_id] = properties_[property_id]->checked();
+                for (unsigned property_id = 0; property_id < Game::num_properties; ++property_id) {
+                    set.set(property_id, properties_[property_id]->checked());
                 }
                 return set;
             }();
@@ -341,8 +473,8 @@ PlayerWidget::PlayerWidget(GameServer& server, unsigned player_id)
 
             const PropertySet properties = [this]() {
                 PropertySet set;
-                for (unsigned property_id = 0; property_id < 28; ++property_id) {
-                    set[property_id] = properties_[property_id]->checked();
+                for (unsigned property_id = 0; property_id < Game::num_properties; ++property_id) {
+                    set.set(property_id, properties_[property_id]->checked());
                 }
                 return set;
             }();
@@ -362,8 +494,8 @@ PlayerWidget::PlayerWidget(GameServer& server, unsigned player_id)
 
             const PropertySet properties = [this]() {
                 PropertySet set;
-                for (unsigned property_id = 0; property_id < 28; ++property_id) {
-                    set[property_id] = properties_[property_id]->checked();
+                for (unsigned property_id = 0; property_id < Game::num_properties; ++property_id) {
+                    set.set(property_id, properties_[property_id]->checked());
                 }
                 return set;
             }();
@@ -522,7 +654,7 @@ void PlayerWidget::update()
 {
     // Property selector/display
     const auto& all_properties = server_.game().properties;
-    for (unsigned i = 0; i < 28; ++i) {
+    for (unsigned i = 0; i < Game::num_properties; ++i) {
         if (all_properties[i].owner_id == player_id_) {
             properties_[i]->setHidden(false);
         } else {
@@ -534,8 +666,12 @@ void PlayerWidget::update()
 
     // Buy property
     buy_combobox_->clear();
-    for (const auto& property : server_.game().properties) {
-        if (!property.owner_id) buy_combobox_->addItem(property.name);
+    buy_property_ids_.clear();
+    for (unsigned id = 0; id < server_.game().properties.size(); ++id) {
+        const auto& property = server_.game().properties[id];
+        if (property.owner_id) continue;
+        buy_combobox_->addItem(property.name());
+        buy_property_ids_.push_back(id);
     }
 
     // Players combobox
@@ -545,6 +681,291 @@ void PlayerWidget::update()
     }
 }
 
+// AuctionWidget --------------------------------------------------------------
+
+AuctionWidget::AuctionWidget(GameServer& server, std::optional<unsigned> player_id)
+    : server_{server}, player_id_{player_id}
+{
+    status_ = this->addWidget(std::make_unique<Wt::WText>());
+
+    if (player_id_) {
+        bid_amount_ = this->addWidget(std::make_unique<Wt::WLineEdit>());
+        bid_button_ = this->addWidget(std::make_unique<Wt::WPushButton>("Bid"));
+        bid_button_->mouseWentDown().connect([this] {
+            const int amount = get_positive_int(bid_amount_);
+            if (amount < 0) return;
+            if (!bid_limit_.try_take(TokenBucket::Clock::now())) {
+                alert(this, "Slow down, that was too many bids at once");
+                return;
+            }
+            bid_amount_->setText("");
+
+            const Result r = server_.bid(*player_id_, amount);
+            if (!r) alert(this, r.text());
+            this->update();
+        });
+    }
+
+    this->update();
+}
+
+void AuctionWidget::update()
+{
+    const auto auction = server_.auction();
+    if (bid_amount_) bid_amount_->setHidden(!auction);
+    if (bid_button_) bid_button_->setHidden(!auction);
+    if (!auction) {
+        status_->setText("");
+        return;
+    }
+
+    const auto& game = server_.game();
+    std::string text = "Auction of " + game.properties[auction->property_id()].name() + ": ";
+    if (const auto highest = auction->highest()) {
+        text += game.player(highest->player_id).name + " bid " + std::to_string(highest->amount);
+    } else {
+        text += "no bids yet";
+    }
+    const auto left = std::chrono::duration_cast<std::chrono::seconds>(
+        auction->deadline() - Auction::Clock::now());
+    text += ", next bid at least " + std::to_string(auction->minimum_bid()) + ", ends in "
+            + std::to_string(std::max<long long>(left.count(), 0)) + "s";
+    status_->setText(text);
+}
+
+// TradeWidget ----------------------------------------------------------------
+
+namespace {
+
+// An amount left blank is none at all. Returns -1 if it's not a number.
+int get_amount(const Wt::WLineEdit* const line_edit)
+{
+    if (line_edit && line_edit->text().narrow().empty()) return 0;
+    return get_positive_int(line_edit);
+}
+
+}
+
+TradeWidget::TradeWidget(GameServer& server, unsigned player_id)
+    : server_{server}, player_id_{player_id}
+{
+    { // Draft
+        from_combobox_ = this->addWidget(std::make_unique<Wt::WComboBox>());
+        this->addWidget(std::make_unique<Wt::WText>(" gives "));
+        to_combobox_ = this->addWidget(std::make_unique<Wt::WComboBox>());
+        cash_ = this->addWidget(std::make_unique<Wt::WLineEdit>());
+        cash_->setPlaceholderText("Cash");
+        property_combobox_ = this->addWidget(std::make_unique<Wt::WComboBox>());
+        secured_debt_ = this->addWidget(std::make_unique<Wt::WLineEdit>());
+        secured_debt_->setPlaceholderText("Secured debt");
+        unsecured_debt_ = this->addWidget(std::make_unique<Wt::WLineEdit>());
+        unsecured_debt_->setPlaceholderText("Unsecured debt");
+        add_ = this->addWidget(std::make_unique<Wt::WPushButton>("Add to trade"));
+        clear_ = this->addWidget(std::make_unique<Wt::WPushButton>("Clear"));
+        this->addWidget(std::make_unique<Wt::WBreak>());
+        draft_text_ = this->addWidget(std::make_unique<Wt::WText>());
+        propose_ = this->addWidget(std::make_unique<Wt::WPushButton>("Offer trade"));
+
+        from_combobox_->changed().connect([this] { this->update_properties(); });
+
+        add_->mouseWentDown().connect([this] {
+            const int from = from_combobox_->currentIndex();
+            const int to = to_combobox_->currentIndex();
+            const int cash = get_amount(cash_);
+            const int secured_debt = get_amount(secured_debt_);
+            const int unsecured_debt = get_amount(unsecured_debt_);
+            if (from < 0 || to < 0 || cash < 0 || secured_debt < 0 || unsecured_debt < 0) return;
+            if (from == to) {
+                alert(this, "Players can't trade with themselves");
+                return;
+            }
+
+            PropertySet properties;
+            const int index = property_combobox_->currentIndex();
+            if (index > 0 && unsigned(index) <= property_ids_.size()) {
+                properties.set(property_ids_[index - 1]);
+            }
+            if (cash == 0 && properties.none() && secured_debt == 0 && unsecured_debt == 0) return;
+
+            // Everything one player gives another goes in the same leg
+            auto leg = std::find_if(draft_.legs.begin(), draft_.legs.end(),
+                                    [from, to](const TradeLeg& l) {
+                                        return l.from == unsigned(from) && l.to == unsigned(to);
+                                    });
+
+            // Added up in a wider type, so a total too big to trade is turned
+            // away rather than wrapping round
+            const TradeLeg before = leg == draft_.legs.end() ? TradeLeg{} : *leg;
+            const auto too_big = [](int total, int amount) {
+                return std::int64_t(total) + amount > std::numeric_limits<int>::max();
+            };
+            if (too_big(before.cash, cash) || too_big(before.secured_debt, secured_debt)
+                || too_big(before.unsecured_debt, unsecured_debt)) {
+                alert(this, "That's more than can be traded");
+                return;
+            }
+
+            if (leg == draft_.legs.end()) {
+                leg = draft_.legs.insert(draft_.legs.end(), TradeLeg{unsigned(from), unsigned(to)});
+            }
+            leg->cash += cash;
+            leg->properties |= properties;
+            leg->secured_debt += secured_debt;
+            leg->unsecured_debt += unsecured_debt;
+
+            cash_->setText("");
+            secured_debt_->setText("");
+            unsecured_debt_->setText("");
+            property_combobox_->setCurrentIndex(0);
+            this->update_draft();
+        });
+        clear_->mouseWentDown().connect([this] {
+            draft_.legs.clear();
+            this->update_draft();
+        });
+        propose_->mouseWentDown().connect([this] {
+            if (!admitted(server_, this)) return;
+            const Result r = server_.propose_trade(player_id_, draft_);
+            if (!r) {
+                alert(this, r.text());
+                return;
+            }
+            draft_.legs.clear();
+            this->update_draft();
+        });
+    }
+
+    this->addWidget(std::make_unique<Wt::WBreak>());
+
+    { // Offers
+        offers_combobox_ = this->addWidget(std::make_unique<Wt::WComboBox>());
+        accept_ = this->addWidget(std::make_unique<Wt::WPushButton>("Accept"));
+        reject_ = this->addWidget(std::make_unique<Wt::WPushButton>("Turn down"));
+        counter_ = this->addWidget(std::make_unique<Wt::WPushButton>("Counter with draft"));
+        this->addWidget(std::make_unique<Wt::WBreak>());
+        offer_text_ = this->addWidget(std::make_unique<Wt::WText>());
+
+        offers_combobox_->changed().connect([this] { this->update(); });
+
+        accept_->mouseWentDown().connect([this] {
+            const auto offer_id = this->chosen_offer();
+            if (!offer_id || !admitted(server_, this)) return;
+            const Result r = server_.accept_trade(player_id_, *offer_id);
+            if (!r) alert(this, r.text());
+        });
+        reject_->mouseWentDown().connect([this] {
+            const auto offer_id = this->chosen_offer();
+            if (!offer_id || !admitted(server_, this)) return;
+            const Result r = server_.reject_trade(player_id_, *offer_id);
+            if (!r) alert(this, r.text());
+        });
+        counter_->mouseWentDown().connect([this] {
+            const auto offer_id = this->chosen_offer();
+            if (!offer_id || !admitted(server_, this)) return;
+            const Result r = server_.counter_trade(player_id_, *offer_id, draft_);
+            if (!r) {
+                alert(this, r.text());
+                return;
+            }
+            draft_.legs.clear();
+            this->update_draft();
+        });
+    }
+
+    this->update();
+}
+
+std::optional<std::uint64_t> TradeWidget::chosen_offer() const
+{
+    const int index = offers_combobox_->currentIndex();
+    if (index < 0 || unsigned(index) >= offer_ids_.size()) return {};
+    return offer_ids_[index];
+}
+
+void TradeWidget::update()
+{
+    const auto& game = server_.game();
+
+    // Players may have joined, but never leave
+    if (from_combobox_->count() != int(game.num_players())) {
+        const int from = from_combobox_->currentIndex();
+        const int to = to_combobox_->currentIndex();
+        from_combobox_->clear();
+        to_combobox_->clear();
+        for (const auto& player : game.players()) {
+            from_combobox_->addItem(player.name);
+            to_combobox_->addItem(player.name);
+        }
+        from_combobox_->setCurrentIndex(from < 0 ? int(player_id_) : from);
+        to_combobox_->setCurrentIndex(std::max(to, 0));
+    }
+    this->update_properties();
+    this->update_draft();
+
+    // Offers the player is a party to, keeping the one chosen if it's still
+    // on offer
+    const auto chosen = this->chosen_offer();
+    const auto trades = server_.trade_offers();
+    offers_combobox_->clear();
+    offer_ids_.clear();
+    for (const auto& offer : trades.offers) {
+        if (!offer.involves(player_id_)) continue;
+        offers_combobox_->addItem("Trade " + std::to_string(offer.id) + " from "
+                                  + game.player(offer.proposer).name);
+        if (offer.id == chosen) offers_combobox_->setCurrentIndex(int(offer_ids_.size()));
+        offer_ids_.push_back(offer.id);
+    }
+
+    const auto offer_id = this->chosen_offer();
+    const auto offer = std::find_if(trades.offers.begin(), trades.offers.end(),
+                                    [&](const TradeBook::Offer& o) { return o.id == offer_id; });
+    accept_->setHidden(!offer_id);
+    reject_->setHidden(!offer_id);
+    counter_->setHidden(!offer_id);
+    if (offer == trades.offers.end()) {
+        offer_text_->setText(offer_ids_.empty() ? "No trades on offer" : "");
+        return;
+    }
+
+    std::string text = describe_trade(offer->terms, game) + ". Waiting for ";
+    const auto waiting = offer->waiting_for(trades.version);
+    for (std::size_t i = 0; i < waiting.size(); ++i) {
+        text += std::string(i > 0 ? ", " : "") + game.player(waiting[i]).name;
+    }
+    offer_text_->setText(text);
+}
+
+void TradeWidget::update_properties()
+{
+    // Only what the giving player owns now, though it may be gone by the
+    // time the trade is offered, which the server checks
+    const auto& game = server_.game();
+    const int from = from_combobox_->currentIndex();
+    const int index = property_combobox_->currentIndex();
+    const std::optional<unsigned> chosen
+        = index > 0 && unsigned(index) <= property_ids_.size()
+              ? std::optional<unsigned>(property_ids_[index - 1]) : std::nullopt;
+
+    property_combobox_->clear();
+    property_ids_.clear();
+    property_combobox_->addItem("(no property)");
+    for (unsigned id = 0; id < game.properties.size(); ++id) {
+        if (from < 0 || game.properties[id].owner_id != unsigned(from)) continue;
+        property_combobox_->addItem(game.properties[id].name());
+        property_ids_.push_back(id);
+        if (id == chosen) property_combobox_->setCurrentIndex(int(property_ids_.size()));
+    }
+}
+
+void TradeWidget::update_draft()
+{
+    const bool empty = draft_.legs.empty();
+    draft_text_->setText(empty ? "Nothing in the trade yet"
+                               : "Trade: " + describe_trade(draft_, server_.game()));
+    propose_->setDisabled(empty);
+    counter_->setDisabled(empty);
+}
+
 // BankerWidget ---------------------------------------------------------------
 
 BankerWidget::BankerWidget(GameServer& server)
@@ -556,11 +977,11 @@ BankerWidget::BankerWidget(GameServer& server)
         std::make_unique<Wt::WPushButton>("Decrease interest rates"));
 
     increase_rates_->mouseWentDown().connect([this] {
-        const GameEvent event{raise_interest};
+        const GameEvent event{[](Game& g) { return raise_interest(g); }};
         attempt_to_send(event, server_, this);
     });
     decrease_rates_->mouseWentDown().connect([this] {
-        const GameEvent event{lower_interest};
+        const GameEvent event{[](Game& g) { return lower_interest(g); }};
         attempt_to_send(event, server_, this);
     });
 
@@ -571,10 +992,49 @@ BankerWidget::BankerWidget(GameServer& server)
         [this] { attempt_to_send(UndoEvent{}, server_, this); });
     redo_->mouseWentDown().connect(
         [this] { attempt_to_send(RedoEvent{}, server_, this); });
+
+    { // Routines
+        routine_combobox_ = this->addWidget(std::make_unique<Wt::WComboBox>());
+        for (std::size_t i = 0; i < GameServer::num_routines; ++i) {
+            routine_combobox_->addItem(GameServer::routine_name(GameServer::Routine(i)));
+        }
+        routine_minutes_ = this->addWidget(std::make_unique<Wt::WLineEdit>());
+        routine_minutes_->setPlaceholderText("Minutes");
+        start_routine_ = this->addWidget(std::make_unique<Wt::WPushButton>("Start"));
+        stop_routine_ = this->addWidget(std::make_unique<Wt::WPushButton>("Stop"));
+        routines_ = this->addWidget(std::make_unique<Wt::WText>());
+
+        start_routine_->mouseWentDown().connect([this] {
+            const int minutes = get_positive_int(routine_minutes_);
+            if (minutes < 0 || !admitted(server_, this)) return;
+            const auto routine = GameServer::Routine(routine_combobox_->currentIndex());
+            const Result r = server_.start_routine(routine, std::chrono::minutes(minutes));
+            if (!r) alert(this, r.text());
+            this->update();
+        });
+        stop_routine_->mouseWentDown().connect([this] {
+            if (!admitted(server_, this)) return;
+            const auto routine = GameServer::Routine(routine_combobox_->currentIndex());
+            const Result r = server_.stop_routine(routine);
+            if (!r) alert(this, r.text());
+            this->update();
+        });
+    }
+
+    this->update();
 }
 
 void BankerWidget::update()
 {
+    std::string text;
+    for (std::size_t i = 0; i < GameServer::num_routines; ++i) {
+        const auto routine = GameServer::Routine(i);
+        const auto every = server_.routine_interval(routine);
+        if (!every) continue;
+        text += std::string(text.empty() ? "" : ", ") + GameServer::routine_name(routine) + " ("
+                + std::to_string(every->count()) + " min)";
+    }
+    routines_->setText(text.empty() ? "No routines running" : "Running: " + text);
 }
 
 // GameWidget -----------------------------------------------------------------
@@ -595,62 +1055,132 @@ GameWidget::GameWidget(GameServer& server, Type type, unsigned player_id)
         std::make_unique<MessageWidget>(server_, player_id_, banker_));
 
     info_widget_ = this->addWidget(std::make_unique<InfoWidget>(server_));
+    auction_widget_ = this->addWidget(std::make_unique<AuctionWidget>(server_, player_id_));
 
     if (player_id_) {
         player_widget_ = this->addWidget(
             std::make_unique<PlayerWidget>(server_, *player_id_));
+        trade_widget_ = this->addWidget(std::make_unique<TradeWidget>(server_, *player_id_));
     }
 
     if (banker_) {
         banker_widget_
             = this->addWidget(std::make_unique<BankerWidget>(server_));
     }
+
+    widget_count_ = count_widgets(this);
+}
+
+SessionMemoryUsage GameWidget::memory_usage() const
+{
+    SessionMemoryUsage usage;
+    usage.widgets = widget_count_;
+    if (message_widget_) {
+        usage.widgets += message_widget_->widget_count();
+        usage.message_lines = message_widget_->line_count();
+        usage.message_bytes = message_widget_->byte_count();
+    }
+    return usage;
 }
 
-void GameWidget::handle_event(const Event& event)
-{
-    switch (event.type()) {
-    case Event::Type::undo:
-        if (info_widget_) info_widget_->update();
-        if (player_widget_) player_widget_->update();
-        if (banker_widget_) banker_widget_->update();
-        break;
-    case Event::Type::redo:
-        if (info_widget_) info_widget_->update();
-        if (player_widget_) player_widget_->update();
-        if (banker_widget_) banker_widget_->update();
-        break;
-    case Event::Type::message:
-        if (message_widget_) message_widget_->push(event.get<MessageEvent>().text);
-        break;
-    case Event::Type::notification:
-        if (message_widget_) message_widget_->push(event.get<NotificationEvent>().text);
-        break;
-    case Event::Type::game:
-        if (info_widget_) info_widget_->update();
-        if (player_widget_) player_widget_->update();
-        if (banker_widget_) banker_widget_->update();
-        break;
-    case Event::Type::add_player:
-        if (info_widget_) {
-            info_widget_->add_player(event.get<AddPlayerEvent>().player_id);
-            info_widget_->update();
+void GameWidget::connect(std::uint64_t cursor)
+{
+    const CatchUp catch_up = server_.connect(this, player_id_, cursor);
+    cursor_ = catch_up.last;
+
+    // Only game events are replayed, the message box pages in its history
+    if (message_widget_) message_widget_->join();
+    server_.flush_chat(this);
+
+    // Any game events missed were made after the widgets were built
+    this->update();
+    server_.report_memory_usage(this, this->memory_usage());
+}
+
+void GameWidget::update()
+{
+    if (info_widget_) info_widget_->update();
+    if (auction_widget_) auction_widget_->update();
+    if (player_widget_) player_widget_->update();
+    if (trade_widget_) trade_widget_->update();
+    if (banker_widget_) banker_widget_->update();
+    widget_count_ = count_widgets(this);
+}
+
+void GameWidget::handle_events(const std::vector<SequencedEvent>& events)
+{
+    // The widgets show the game as it is now, so however many changes there
+    // were they only need updating once
+    bool changed = false;
+    bool analysed = false;
+    bool auctioned = false;
+    bool traded = false;
+    for (const auto& sequenced : events) {
+        const Event& event = sequenced.event;
+        cursor_ = sequenced.sequence;
+
+        switch (event.type()) {
+        case Event::Type::undo:
+            changed = true;
+            break;
+        case Event::Type::redo:
+            changed = true;
+            break;
+        case Event::Type::message:
+        case Event::Type::notification:
+            // Never sent as events, text comes through handle_messages
+            break;
+        case Event::Type::game:
+            changed = true;
+            break;
+        case Event::Type::add_player:
+            changed = true;
+            break;
+        case Event::Type::analysis:
+            analysed = true;
+            break;
+        case Event::Type::auction:
+            auctioned = true;
+            break;
+        case Event::Type::trade:
+            traded = true;
+            break;
         }
-        if (player_widget_) player_widget_->update();
-        break;
     }
 
+    if (changed) this->update();
+    if (analysed && info_widget_) info_widget_->update_analysis();
+    if (auctioned && !changed && auction_widget_) auction_widget_->update();
+    if (traded && !changed && trade_widget_) trade_widget_->update();
+
+    server_.report_memory_usage(this, this->memory_usage());
+
+    Wt::WApplication::instance()->triggerUpdate();
+}
+
+void GameWidget::handle_messages(const ChatLog::Page& page)
+{
+    if (message_widget_) message_widget_->append(page);
+
+    // Memory usage isn't reported here, as that takes the game's lock. It's
+    // reported with the next game event.
     Wt::WApplication::instance()->triggerUpdate();
 }
 
 // LoginWidget ----------------------------------------------------------------
 
 LoginWidget::LoginWidget(
-    const std::function<void(LoginWidget*)>& login_function)
+    const std::function<void(LoginWidget*)>& login_function,
+    const std::vector<std::string>& ruleset_names)
 {
     game_name_field_ = this->addWidget(std::make_unique<Wt::WLineEdit>(""));
     user_name_field_ = this->addWidget(std::make_unique<Wt::WLineEdit>(""));
     banker_checkbox_ = this->addWidget(std::make_unique<Wt::WCheckBox>());
+    ruleset_combobox_ = this->addWidget(std::make_unique<Wt::WComboBox>());
+    for (const auto& name : ruleset_names) ruleset_combobox_->addItem(name);
+    ruleset_combobox_->setCurrentIndex(
+        std::find(ruleset_names.begin(), ruleset_names.end(), standard_ruleset().name())
+        - ruleset_names.begin());
     login_button_
         = this->addWidget(std::make_unique<Wt::WPushButton>("Login"));
 
@@ -658,3 +1188,95 @@ LoginWidget::LoginWidget(
         [this, login_function] { login_function(this); });
 }
 
+// LobbyWidget ----------------------------------------------------------------
+
+namespace {
+    std::string age(std::chrono::system_clock::time_point created)
+    {
+        using namespace std::chrono;
+        const auto minutes = duration_cast<std::chrono::minutes>(system_clock::now() - created);
+        if (minutes < 1h) return std::to_string(minutes.count()) + " min";
+        if (minutes < 48h) return std::to_string(minutes.count() / 60) + " h";
+        return std::to_string(minutes.count() / (60 * 24)) + " days";
+    }
+}
+
+LobbyWidget::LobbyWidget(MainServer& server,
+                         std::function<void(const std::string&)> choose_game)
+    : server_{server}, choose_game_{std::move(choose_game)}
+{
+    this->addWidget(std::make_unique<Wt::WText>("Games"));
+    summary_ = this->addWidget(std::make_unique<Wt::WText>());
+    games_table_ = this->addWidget(std::make_unique<Wt::WTable>());
+
+    previous_button_ = this->addWidget(std::make_unique<Wt::WPushButton>("Previous"));
+    next_button_ = this->addWidget(std::make_unique<Wt::WPushButton>("Next"));
+    refresh_button_ = this->addWidget(std::make_unique<Wt::WPushButton>("Refresh"));
+
+    previous_button_->mouseWentDown().connect([this] {
+        first_ -= std::min(first_, page_size);
+        this->update();
+    });
+    next_button_->mouseWentDown().connect([this] {
+        first_ += page_size;
+        this->update();
+    });
+    refresh_button_->mouseWentDown().connect([this] { this->update(); });
+
+    this->update();
+}
+
+void LobbyWidget::update()
+{
+    auto page = server_.lobby_page(first_, page_size);
+    // Games may have gone since the last page was fetched
+    if (page.games.empty() && page.total > 0) {
+        first_ = (page.total - 1) / page_size * page_size;
+        page = server_.lobby_page(first_, page_size);
+    }
+    this->show(page);
+}
+
+void LobbyWidget::show(const LobbyPage& page)
+{
+    first_ = page.first;
+
+    if (page.total == 0) {
+        summary_->setText(" - none yet, type a name to start one");
+    } else {
+        summary_->setText(" " + std::to_string(page.first + 1) + "-"
+                          + std::to_string(page.first + page.games.size()) + " of "
+                          + std::to_string(page.total));
+    }
+
+    games_table_->clear();
+    const std::array<const char*, 6> headings
+        = {"Game", "Ruleset", "Players", "Online", "Age", "Leader"};
+    for (int column = 0; column < int(headings.size()); ++column) {
+        games_table_->elementAt(0, column)->addWidget(
+            std::make_unique<Wt::WText>(headings[column]));
+    }
+
+    int row = 1;
+    for (const auto& game : page.games) {
+        auto* join = games_table_->elementAt(row, 0)->addWidget(
+            std::make_unique<Wt::WPushButton>(game->name));
+        join->mouseWentDown().connect(
+            [this, name = game->name] { choose_game_(name); });
+        games_table_->elementAt(row, 1)->addWidget(std::make_unique<Wt::WText>(game->ruleset));
+        games_table_->elementAt(row, 2)->addWidget(
+            std::make_unique<Wt::WText>(std::to_string(game->players)));
+        games_table_->elementAt(row, 3)->addWidget(
+            std::make_unique<Wt::WText>(std::to_string(game->clients)));
+        games_table_->elementAt(row, 4)->addWidget(
+            std::make_unique<Wt::WText>(age(game->created)));
+        games_table_->elementAt(row, 5)->addWidget(std::make_unique<Wt::WText>(
+            game->leader.empty() ? ""
+                                 : game->leader + " (" + std::to_string(game->leader_net_worth)
+                                       + ")"));
+        ++row;
+    }
+
+    previous_button_->setHidden(page.first == 0);
+    next_button_->setHidden(page.first + page.games.size() >= page.total);
+}
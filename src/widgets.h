@@ -16,9 +16,15 @@
 #include <optional>
 #include <memory>
 
+#include "chat_log.h"
 #include "game.h"
+#include "lobby.h"
+#include "memory_usage.h"
+#include "replay_buffer.h"
+#include "token_bucket.h"
 
 struct GameServer;
+struct MainServer;
 struct Event;
 struct MessageEvent;
 struct NotificationEvent;
@@ -71,8 +77,36 @@ private:
 struct MessageWidget : Wt::WContainerWidget {
     MessageWidget(GameServer&, std::optional<unsigned> player_id, bool banker);
 
+    // Show the most recent page of the game's history, then the welcome.
+    // Call once the client is connected.
+    void join();
+
+    // Messages from the game's history, skipping any already shown
+    void append(const ChatLog::Page&);
+
+    // A line only shown here, not kept in the game's history
     void push(std::string);
+
+    std::size_t line_count() const noexcept { return line_count_; }
+    std::size_t byte_count() const noexcept { return byte_count_; }
+    // Each message is made up of a WBreak and a WText
+    std::size_t widget_count() const noexcept { return 5 + 2 * line_count_; }
 private:
+    // Messages fetched at a time, on joining and for each click of earlier
+    static constexpr std::size_t page_size = 50;
+
+    void show_earlier(const ChatLog::Page&);
+
+    std::size_t line_count_ = 0;
+    std::size_t byte_count_ = 0;
+
+    // Indices in the history of the first message shown, and of the one
+    // after the last
+    std::uint64_t first_ = 0;
+    std::uint64_t end_ = 0;
+    std::string welcome_message_;
+
+    Wt::WPushButton* earlier_button_ = nullptr;
     Wt::WLineEdit* input_box_ = nullptr;
     Wt::WPushButton* send_message_button_ = nullptr;
 
@@ -86,6 +120,8 @@ struct InfoWidget : Wt::WContainerWidget {
     InfoWidget(GameServer& server);
 
     void update();
+    // Only update the results of background analysis
+    void update_analysis();
     void add_player(unsigned player_id);
 private:
     Wt::WText* secured_interest_ = nullptr;
@@ -93,11 +129,74 @@ private:
     Wt::WText* ppi_ = nullptr;
 
     Wt::WTable* player_table_ = nullptr;
-    std::vector<std::array<Wt::WText*, 7>> player_info_;
+    std::vector<std::array<Wt::WText*, 8>> player_info_;
 
     GameServer& server_;
 };
 
+// Shows the auction running in the game, if there is one, and takes a
+// player's bids
+struct AuctionWidget : Wt::WContainerWidget {
+    AuctionWidget(GameServer&, std::optional<unsigned> player_id);
+
+    void update();
+private:
+    // Bids never take the game's lock, so are limited here in the session
+    // rather than by GameServer::admit_input
+    static constexpr double bid_rate = 5;
+    static constexpr double bid_burst = 10;
+
+    GameServer& server_;
+    std::optional<unsigned> player_id_;
+    TokenBucket bid_limit_{bid_rate, bid_burst};
+
+    Wt::WText* status_ = nullptr;
+    Wt::WLineEdit* bid_amount_ = nullptr;
+    Wt::WPushButton* bid_button_ = nullptr;
+};
+
+// Trades the player is a party to, and a draft of one to offer. The draft is
+// built up a hand over at a time, and can be offered as a new trade or as a
+// counter to the chosen one.
+struct TradeWidget : Wt::WContainerWidget {
+    TradeWidget(GameServer&, unsigned player_id);
+
+    void update();
+private:
+    // The chosen offer's id, if there is one
+    std::optional<std::uint64_t> chosen_offer() const;
+    void update_properties();
+    void update_draft();
+
+    GameServer& server_;
+    unsigned player_id_;
+    Trade draft_;
+
+    // Draft:
+    Wt::WComboBox* from_combobox_ = nullptr;
+    Wt::WComboBox* to_combobox_ = nullptr;
+    Wt::WLineEdit* cash_ = nullptr;
+    Wt::WComboBox* property_combobox_ = nullptr;
+    // Property id of each property_combobox_ item after the first, which is
+    // no property
+    std::vector<unsigned> property_ids_;
+    Wt::WLineEdit* secured_debt_ = nullptr;
+    Wt::WLineEdit* unsecured_debt_ = nullptr;
+    Wt::WPushButton* add_ = nullptr;
+    Wt::WPushButton* clear_ = nullptr;
+    Wt::WText* draft_text_ = nullptr;
+    Wt::WPushButton* propose_ = nullptr;
+
+    // Offers:
+    Wt::WComboBox* offers_combobox_ = nullptr;
+    // Id of each offers_combobox_ item
+    std::vector<std::uint64_t> offer_ids_;
+    Wt::WText* offer_text_ = nullptr;
+    Wt::WPushButton* accept_ = nullptr;
+    Wt::WPushButton* reject_ = nullptr;
+    Wt::WPushButton* counter_ = nullptr;
+};
+
 // Widget containing controls specific to a certain player
 struct PlayerWidget : Wt::WContainerWidget {
     PlayerWidget(GameServer&, unsigned player_id);
@@ -110,7 +209,7 @@ private:
             auto* container = this->addWidget(std::make_unique<Wt::WContainerWidget>());
             auto* hbox = container->setLayout(std::make_unique<Wt::WHBoxLayout>());
             checkbox_ = hbox->addWidget(std::make_unique<Wt::WCheckBox>());
-            hbox->addWidget(std::make_unique<Wt::WText>(property.name));
+            hbox->addWidget(std::make_unique<Wt::WText>(property.name()));
         }
 
         bool checked() const {
@@ -131,10 +230,14 @@ private:
 
     // Actions:
     Wt::WComboBox* buy_combobox_ = nullptr;
+    // Property id of each buy_combobox_ item
+    std::vector<unsigned> buy_property_ids_;
     Wt::WLineEdit* buy_amount_ = nullptr;
     Wt::WPushButton* buy_button_ = nullptr;
+    // Auctions the chosen property instead, with the amount as the lowest bid
+    Wt::WPushButton* auction_button_ = nullptr;
 
-    std::array<PropertySelectWidget*, 28> properties_;
+    std::array<PropertySelectWidget*, Game::num_properties> properties_;
 
     Wt::WPushButton* sell_properties_ = nullptr;
     Wt::WPushButton* mortgage_properties_ = nullptr;
@@ -196,6 +299,13 @@ private:
 
     Wt::WPushButton* undo_ = nullptr;
     Wt::WPushButton* redo_ = nullptr;
+
+    // Routines done every so many minutes
+    Wt::WComboBox* routine_combobox_ = nullptr;
+    Wt::WLineEdit* routine_minutes_ = nullptr;
+    Wt::WPushButton* start_routine_ = nullptr;
+    Wt::WPushButton* stop_routine_ = nullptr;
+    Wt::WText* routines_ = nullptr;
 };
 
 struct GameWidget : Wt::WContainerWidget {
@@ -211,20 +321,45 @@ struct GameWidget : Wt::WContainerWidget {
 
     GameWidget(GameServer&, Type, unsigned player_id = 0);
 
-    void handle_event(const Event&);
+    // Start receiving events, catching up on those missed since the cursor.
+    // Everything but the message log is already up to date, as it was built
+    // from the current game.
+    void connect(std::uint64_t cursor);
+
+    // Events taken from the client's outbox, in order
+    void handle_events(const std::vector<SequencedEvent>&);
+
+    // Messages from the game's history the client hadn't been sent
+    void handle_messages(const ChatLog::Page&);
+
+    // Sequence number of the last event handled
+    std::uint64_t cursor() const noexcept { return cursor_; }
+
+    SessionMemoryUsage memory_usage() const;
 private:
+    // Number of widgets in the tree, not including the message widget, which
+    // keeps its own count. Only recounted when the tree changes shape.
+    std::size_t widget_count_ = 0;
+
+    void update();
+
     GameServer& server_;
     bool banker_;
     std::optional<unsigned> player_id_ = {};
+    std::uint64_t cursor_ = 0;
 
     MessageWidget* message_widget_ = nullptr;
     InfoWidget* info_widget_ = nullptr;
+    AuctionWidget* auction_widget_ = nullptr;
     PlayerWidget* player_widget_ = nullptr;
+    TradeWidget* trade_widget_ = nullptr;
     BankerWidget* banker_widget_ = nullptr;
 };
 
 struct LoginWidget : Wt::WContainerWidget {
-    LoginWidget(const std::function<void(LoginWidget*)>& login_function);
+    // Rulesets are offered in case the game has to be created
+    LoginWidget(const std::function<void(LoginWidget*)>& login_function,
+                const std::vector<std::string>& ruleset_names);
 
     std::string game_name() const {
         return game_name_field_->text().narrow();
@@ -235,6 +370,13 @@ struct LoginWidget : Wt::WContainerWidget {
     bool banker() const {
         return banker_checkbox_->isChecked();
     }
+    std::string ruleset_name() const {
+        return ruleset_combobox_->currentText().narrow();
+    }
+
+    void set_game_name(const std::string& name) {
+        game_name_field_->setText(name);
+    }
 
     void bad_login() {
         this->addWidget(std::make_unique<Wt::WText>("Bad login"));
@@ -243,6 +385,29 @@ private:
     Wt::WLineEdit* game_name_field_;
     Wt::WLineEdit* user_name_field_;
     Wt::WCheckBox* banker_checkbox_;
+    Wt::WComboBox* ruleset_combobox_;
     Wt::WPushButton* login_button_;
 };
 
+// Lists the games being played a page at a time, so one can be picked to join
+struct LobbyWidget : Wt::WContainerWidget {
+    LobbyWidget(MainServer&, std::function<void(const std::string& game_name)> choose_game);
+
+    // Fetch the current page again. The server only rebuilds the list every
+    // few seconds, however often this is called.
+    void update();
+private:
+    static constexpr std::size_t page_size = 20;
+
+    void show(const LobbyPage&);
+
+    MainServer& server_;
+    std::function<void(const std::string&)> choose_game_;
+    std::size_t first_ = 0;
+
+    Wt::WText* summary_ = nullptr;
+    Wt::WTable* games_table_ = nullptr;
+    Wt::WPushButton* previous_button_ = nullptr;
+    Wt::WPushButton* next_button_ = nullptr;
+    Wt::WPushButton* refresh_button_ = nullptr;
+};
@@ -0,0 +1,102 @@
+// Counts heap allocations made by the game functions: failed checks, mutators
+// that succeed, and whole simulated games.
+//
+// Usage: alloc_count [--iterations=N] [--games=N]
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "board.h"
+#include "game.h"
+#include "simulation.h"
+#include "options.h"
+
+namespace {
+    std::atomic<unsigned long long> allocations{0};
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+    template <typename F>
+    void count(const char* name, unsigned long long iterations, F function)
+    {
+        const auto before = allocations.load();
+        for (unsigned long long i = 0; i < iterations; ++i) function();
+        const auto made = allocations.load() - before;
+
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(10) << double(made) / iterations
+                  << " allocations each\n";
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long iterations = 100000;
+    unsigned long long games = 200;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "iterations", iterations) && !parse_option(arg, "games", games)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Game game({Player{"Alice"}, Player{"Bob"}});
+    game.player(0).cash = 1 << 30;
+    game.player_changed(0);
+    for (const auto set : {colour_sets[0], colour_sets[7]}) {
+        for_each_property_id(set, [&game](unsigned id) {
+            buy_property(game, 0, id, game.properties[id].guide_price());
+        });
+    }
+    const PropertySet brown = colour_sets[0];
+
+    count("failed can_buy_property", iterations, [&game] {
+        return can_buy_property(game, 1, 0, 60);
+    });
+    count("failed can_build_houses", iterations, [&game] {
+        return can_build_houses(game, 1, colour_sets[0], 1);
+    });
+    count("failed can_pay_to_bank", iterations, [&game] {
+        return can_pay_to_bank(game, 1, 1000);
+    });
+    count("successful can_build_houses", iterations, [&game, brown] {
+        return can_build_houses(game, 0, brown, 1);
+    });
+    count("build + sell houses", iterations, [&game, brown] {
+        build_houses(game, 0, brown, 2);
+        sell_houses(game, 0, brown, 2);
+    });
+    count("mortgage + unmortgage", iterations, [&game] {
+        mortgage(game, 0, 21);
+        unmortgage(game, 0, 21);
+    });
+    count("pay to bank + pay to player", iterations, [&game] {
+        pay_to_bank(game, 0, 10);
+        pay_to_player(game, 0, 10);
+    });
+
+    const std::vector<Strategy> strategies = {cautious_strategy(), cautious_strategy(),
+                                              aggressive_strategy(), aggressive_strategy()};
+    Rng rng{1};
+    count("simulated game", games, [&strategies, &rng] {
+        simulate_game(strategies, rng);
+    });
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
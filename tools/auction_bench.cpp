@@ -0,0 +1,272 @@
+// Measures how long bids take with many bidders going at once while the game
+// keeps changing, first with every bid checked and sent out under the game's
+// lock and then with the auction engine, which checks bids without any lock
+// and sends out at most one update a scheduler tick. Both runs make the same
+// bids against the same game events.
+//
+// Usage: auction_bench [--bidders=N] [--bids=N] [--gap_us=N] [--seed=N]
+//
+// bids is the number each bidder makes, gap_us the pause between game events.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "auction.h"
+#include "bot_search.h"
+#include "event.h"
+#include "game_history.h"
+#include "replay_buffer.h"
+#include "scheduler.h"
+#include "options.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    GameEvent random_event(const Game& game, Rng& rng)
+    {
+        const unsigned player
+            = std::uniform_int_distribution<unsigned>(0, game.num_players() - 1)(rng);
+        const auto actions = legal_actions(game, player);
+        const auto action
+            = actions[std::uniform_int_distribution<std::size_t>(0, actions.size() - 1)(rng)];
+        return GameEvent{[action, player](Game& g) { return action.apply(g, player); }};
+    }
+
+    struct Options {
+        unsigned long long bidders = 16;
+        unsigned long long bids = 20000;
+        unsigned long long gap_us = 50;
+        unsigned long long seed = 1;
+    };
+
+    struct Run {
+        // Time each bid took, sorted
+        std::vector<double> latencies_us;
+        // Time from asking for each game event to it being applied, sorted
+        std::vector<double> game_latencies_us;
+        unsigned long long accepted = 0;
+        unsigned long long updates = 0;
+        double seconds = 0;
+    };
+
+    // What a bid needs to do, whichever way it's done
+    struct Bidding {
+        // Makes a bid, returning whether it was accepted
+        std::function<bool(unsigned player_id, int amount)> bid;
+        // The least the next bid can be
+        std::function<int()> minimum_bid;
+        // Called under the game's lock after every change to the game
+        std::function<void(const Game&)> game_changed = [](const Game&) {};
+    };
+
+    // The game side is the same in both runs: game events are applied and
+    // numbered under the game's lock, as GameServer::apply then post do,
+    // for as long as anyone is bidding
+    Run run(const Options& options, std::recursive_mutex& game_mutex, GameHistory& history,
+            ReplayBuffer& replay, const Bidding& bidding)
+    {
+        std::vector<std::vector<double>> latencies(options.bidders);
+        std::atomic<unsigned long long> accepted{0};
+        std::atomic<bool> go{false};
+
+        std::vector<std::thread> bidders;
+        for (unsigned long long b = 0; b < options.bidders; ++b) {
+            bidders.emplace_back([&, b] {
+                // Each bids a little over the least it can, as a crowd of
+                // eager bidders would, so most bids race with another
+                std::mt19937 rng(options.seed * 1000 + b);
+                std::uniform_int_distribution<int> over(0, 2);
+                latencies[b].reserve(options.bids);
+                while (!go.load()) {}
+
+                for (unsigned long long i = 0; i < options.bids; ++i) {
+                    const int amount = bidding.minimum_bid() + over(rng);
+                    const auto asked = Clock::now();
+                    if (bidding.bid(unsigned(b), amount)) ++accepted;
+                    latencies[b].push_back(
+                        std::chrono::duration<double, std::micro>(Clock::now() - asked).count());
+                }
+            });
+        }
+
+        Rng rng{options.seed};
+        Run result;
+        const auto start = Clock::now();
+        go = true;
+
+        std::atomic<bool> bidding_done{false};
+        std::thread waiter([&] {
+            for (auto& bidder : bidders) bidder.join();
+            bidding_done = true;
+        });
+        while (!bidding_done.load()) {
+            const auto event = random_event(history.current_game(), rng);
+
+            const auto asked = Clock::now();
+            {
+                std::unique_lock<std::recursive_mutex> lock(game_mutex);
+                if (history.apply(event)) {
+                    replay.push(Event{event});
+                    bidding.game_changed(history.current_game());
+                }
+            }
+            result.game_latencies_us.push_back(
+                std::chrono::duration<double, std::micro>(Clock::now() - asked).count());
+
+            std::this_thread::sleep_for(std::chrono::microseconds(options.gap_us));
+        }
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        waiter.join();
+
+        for (const auto& l : latencies) {
+            result.latencies_us.insert(result.latencies_us.end(), l.begin(), l.end());
+        }
+        std::sort(result.latencies_us.begin(), result.latencies_us.end());
+        std::sort(result.game_latencies_us.begin(), result.game_latencies_us.end());
+        result.accepted = accepted;
+        return result;
+    }
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty()) return 0;
+        return sorted[std::min(sorted.size() - 1, std::size_t(p * sorted.size()))];
+    }
+
+    void report(const std::string& name, const Run& run)
+    {
+        std::cout << std::left << std::setw(12) << name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12)
+                  << run.latencies_us.size() / run.seconds << std::setw(10)
+                  << percentile(run.latencies_us, 0.5) << std::setw(10)
+                  << percentile(run.latencies_us, 0.99) << std::setw(10)
+                  << percentile(run.latencies_us, 0.999) << std::setw(10)
+                  << run.latencies_us.back() << std::setw(10) << run.accepted << std::setw(9)
+                  << run.updates << std::setw(10) << percentile(run.game_latencies_us, 0.99)
+                  << "\n";
+    }
+
+    GameHistory rich_game(unsigned players)
+    {
+        // Rich enough that nobody runs out of cash however high the bids go
+        std::vector<Player> list;
+        for (unsigned i = 0; i < players; ++i) {
+            list.emplace_back("Bidder " + std::to_string(i));
+            list.back().cash = 1000000000;
+        }
+        return GameHistory{Game(std::move(list))};
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "bidders", options.bidders)
+            && !parse_option(arg, "bids", options.bids)
+            && !parse_option(arg, "gap_us", options.gap_us)
+            && !parse_option(arg, "seed", options.seed)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.bidders == 0 || options.bids == 0) {
+        throw std::runtime_error("--bidders and --bids must be at least 1");
+    }
+
+    std::cout << options.bidders << " bidders making " << options.bids << " bids each\n"
+              << std::left << std::setw(12) << "bids" << std::right << std::setw(12) << "bids/s"
+              << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10)
+              << "p99.9 us" << std::setw(10) << "max us" << std::setw(10) << "accepted"
+              << std::setw(9) << "updates" << std::setw(10) << "game p99" << "\n";
+
+    {
+        // Every bid checked against the game, and sent out, under its lock
+        std::recursive_mutex game_mutex;
+        GameHistory history = rich_game(options.bidders);
+        ReplayBuffer replay{256};
+        std::optional<Auction::Bid> highest;
+        unsigned long long updates = 0;
+
+        Bidding bidding;
+        bidding.bid = [&](unsigned player_id, int amount) {
+            std::unique_lock<std::recursive_mutex> lock(game_mutex);
+            if (highest && amount <= highest->amount) return false;
+            if (amount > history.current_game().player(player_id).cash) return false;
+            highest = Auction::Bid{player_id, amount};
+            replay.push(Event{AuctionEvent{}});
+            ++updates;
+            return true;
+        };
+        bidding.minimum_bid = [&] {
+            std::unique_lock<std::recursive_mutex> lock(game_mutex);
+            return highest ? highest->amount + 1 : 1;
+        };
+
+        auto result = run(options, game_mutex, history, replay, bidding);
+        result.updates = updates;
+        report("game lock", result);
+    }
+    {
+        std::recursive_mutex game_mutex;
+        GameHistory history = rich_game(options.bidders);
+        ReplayBuffer replay{256};
+        std::atomic<unsigned long long> updates{0};
+        std::atomic<bool> announced{false};
+
+        // As GameServer keeps it, swapped whenever the game changes
+        std::shared_ptr<const std::vector<int>> cash;
+        const auto update_cash = [&cash](const Game& game) {
+            auto fresh = std::make_shared<std::vector<int>>();
+            for (const auto& player : game.players()) fresh->push_back(player.cash);
+            std::atomic_store(&cash, std::shared_ptr<const std::vector<int>>(std::move(fresh)));
+        };
+        update_cash(history.current_game());
+
+        Auction auction{0, 1, 1, unsigned(options.bidders), Clock::now() + std::chrono::hours(1)};
+        Scheduler scheduler;
+
+        Bidding bidding;
+        bidding.bid = [&](unsigned player_id, int amount) {
+            const auto snapshot = std::atomic_load(&cash);
+            if (auction.bid(player_id, amount, (*snapshot)[player_id])
+                != Auction::BidResult::accepted) {
+                return false;
+            }
+            if (!announced.exchange(true)) {
+                scheduler.schedule_after(Clock::duration::zero(), [&] {
+                    announced = false;
+                    std::unique_lock<std::recursive_mutex> lock(game_mutex);
+                    replay.push(Event{AuctionEvent{}});
+                    ++updates;
+                });
+            }
+            return true;
+        };
+        bidding.minimum_bid = [&] { return auction.minimum_bid(); };
+        bidding.game_changed = update_cash;
+
+        auto result = run(options, game_mutex, history, replay, bidding);
+        scheduler.stop();
+        result.updates = updates;
+        report("auction", result);
+    }
+
+    return EXIT_SUCCESS;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,206 @@
+// Checks that a property being auctioned can't be taken by anything but the
+// auction, going through the game history the way GameServer does: opening
+// the auction reserves the property under the game's lock, and settling it
+// releases the property and buys it for the winner.
+//
+// First checks that a purchase and its undo are still described, and that a
+// bid near the largest int leaves the minimum bid above it. Then tries a redo
+// and a merge that would each give the property an owner, then races buyers
+// and bidders against the auction for a number of rounds. Fails if a step
+// loses its description, if anyone buys the property while the auction is
+// open, or if the auction can't then sell it to its highest bidder.
+//
+// Usage: auction_check [--rounds=N] [--buyers=N] [--bidders=N] [--seed=N]
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "auction.h"
+#include "event.h"
+#include "game_history.h"
+#include "options.h"
+
+namespace {
+    constexpr unsigned auctioned = 0;
+
+    GameEvent buy(unsigned player_id, int price)
+    {
+        return GameEvent{[player_id, price](Game& g) {
+            return buy_property(g, player_id, auctioned, price);
+        }};
+    }
+
+    bool owned(const GameHistory& history)
+    {
+        return bool(history.current_game().properties[auctioned].owner_id);
+    }
+
+    // What GameServer does under its lock when an auction opens and ends
+    struct Table {
+        explicit Table(Game game)
+            : history{std::move(game)}
+        {}
+
+        std::shared_ptr<Auction> open(int starting_bid) {
+            std::unique_lock<std::recursive_mutex> lock(mutex);
+            if (owned(history) || auction) return nullptr;
+            history.reserve(Game::Set::only(auctioned));
+            auction = std::make_shared<Auction>(auctioned, starting_bid, 1,
+                                                history.current_game().num_players(),
+                                                Auction::Clock::now());
+            return auction;
+        }
+
+        // The winner, if anyone could pay
+        std::optional<unsigned> settle() {
+            std::unique_lock<std::recursive_mutex> lock(mutex);
+            auction->close();
+            const auto ranking = auction->ranking();
+            auction.reset();
+            history.release(Game::Set::only(auctioned));
+            for (const auto& bid : ranking) {
+                if (history.apply(buy(bid.player_id, bid.amount))) return bid.player_id;
+            }
+            return {};
+        }
+
+        std::recursive_mutex mutex;
+        GameHistory history;
+        std::shared_ptr<Auction> auction;
+    };
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long rounds = 50;
+    unsigned long long buyers = 3;
+    unsigned long long bidders = 3;
+    unsigned long long seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "rounds", rounds) && !parse_option(arg, "buyers", buyers)
+            && !parse_option(arg, "bidders", bidders) && !parse_option(arg, "seed", seed)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (bidders == 0) throw std::runtime_error("--bidders must be at least 1");
+
+    std::vector<Player> players;
+    for (unsigned long long i = 0; i < buyers + bidders; ++i) {
+        players.emplace_back("Player " + std::to_string(i));
+    }
+    const Game start(std::move(players));
+    bool failed = false;
+
+    {
+        // Bought then undone, so a redo would buy it again. Both still say
+        // what they did, as the server sends that on to every player.
+        Table table{start};
+        const Result bought = table.history.apply(buy(0, 1));
+        const Result undone = table.history.undo();
+        Game game = start;
+        const std::string expected = buy_property(game, 0, auctioned, 1).description(game);
+        std::cout << "bought: \"" << bought.text() << "\", then \"" << undone.text() << "\"\n";
+        if (!bought || bought.text() != expected || undone.text() != "Undo: " + expected) {
+            std::cerr << "A successful step lost its description\n";
+            failed = true;
+        }
+        table.open(1);
+        const bool redone = bool(table.history.redo());
+
+        // Bought on a fork of the game as it was when the auction opened
+        GameFork fork = table.history.fork();
+        fork.apply(buy(1, 1));
+        const bool merged = bool(table.history.merge(fork));
+
+        std::cout << "redo during auction " << (redone ? "went through" : "refused")
+                  << ", merge " << (merged ? "went through" : "refused") << "\n";
+        failed = failed || redone || merged || owned(table.history);
+    }
+
+    {
+        // A top bid within the increment of the largest int leaves no bid
+        // that can beat it, rather than wrapping round to a negative minimum
+        constexpr int most = std::numeric_limits<int>::max();
+        Auction auction(auctioned, 1, 2, 1, Auction::Clock::now());
+        const bool near_top = auction.bid(0, most - 1, most) == Auction::BidResult::accepted;
+        const bool beaten = auction.bid(0, most, most) != Auction::BidResult::too_low;
+        std::cout << "after a bid of " << most - 1 << ", bids from " << auction.minimum_bid()
+                  << "\n";
+        if (!near_top || beaten || auction.minimum_bid() <= most) {
+            std::cerr << "The minimum bid wrapped round\n";
+            failed = true;
+        }
+    }
+
+    unsigned long long taken = 0;
+    unsigned long long unsold = 0;
+    for (unsigned long long round = 0; !failed && round < rounds; ++round) {
+        Table table{start};
+        const auto auction = table.open(1);
+        if (!auction) throw std::runtime_error("Couldn't open the auction");
+
+        std::atomic<bool> done{false};
+        std::atomic<unsigned long long> bought_while_open{0};
+        std::vector<std::thread> threads;
+        for (unsigned long long b = 0; b < buyers; ++b) {
+            threads.emplace_back([&table, &done, &bought_while_open, b] {
+                while (!done.load()) {
+                    std::unique_lock<std::recursive_mutex> lock(table.mutex);
+                    const bool open = bool(table.auction);
+                    if (table.history.apply(buy(unsigned(b), 1)) && open) ++bought_while_open;
+                }
+            });
+        }
+        std::vector<std::thread> bidding;
+        for (unsigned long long b = 0; b < bidders; ++b) {
+            bidding.emplace_back([&auction, &start, b, buyers, seed, round] {
+                const unsigned player_id = unsigned(buyers + b);
+                const int cash = start.player(player_id).cash;
+                std::mt19937_64 rng(seed + 1000 * round + b);
+                for (int bid = 0; bid < 100; ++bid) {
+                    auction->bid(player_id, std::uniform_int_distribution<int>(1, cash)(rng),
+                                 cash);
+                }
+            });
+        }
+        for (auto& thread : bidding) thread.join();
+
+        const auto top = auction->highest();
+        const auto winner = table.settle();
+        done = true;
+        for (auto& thread : threads) thread.join();
+
+        taken += bought_while_open;
+        if (!winner) ++unsold;
+        const auto owner = table.history.current_game().properties[auctioned].owner_id;
+        if (bought_while_open > 0 || !top || !winner || owner != top->player_id) {
+            std::cerr << "round " << round << ": bought " << bought_while_open
+                      << " times while open, "
+                      << (winner ? "sold to player " + std::to_string(*winner) : "unsold")
+                      << "\n";
+            failed = true;
+        }
+    }
+    std::cout << rounds << " auctions raced by " << buyers << " buyers: taken " << taken
+              << " times while open, " << unsold << " unsold\n";
+
+    if (failed) {
+        std::cerr << "The auction check failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,150 @@
+// Compares the vectorised GameBatch kernels against calling the scalar
+// information functions on every player in a loop, on random games, and
+// checks that both give the same answers.
+//
+// Usage: batch_bench [--games=N] [--repeats=N] [--seed=N]
+
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "game_batch.h"
+#include "options.h"
+
+namespace {
+    // A game part way through: properties shared out, some mortgaged, houses
+    // on complete sets and some debt. Its ruleset is added to rulesets.
+    Game random_game(std::mt19937_64& rng, std::deque<Ruleset>& rulesets)
+    {
+        std::uniform_int_distribution<int> percent(0, 99);
+
+        Rules rules;
+        rules.starting_secured_interest = std::uniform_int_distribution<int>(1, 15)(rng);
+        rules.starting_unsecured_interest = std::uniform_int_distribution<int>(10, 40)(rng);
+        rulesets.emplace_back("Standard", standard_ruleset().properties(), rules);
+        Game game(rulesets.back(), {Player{"A"}, Player{"B"}, Player{"C"}, Player{"D"}});
+        game.ppi = Ratio::from_raw(
+            std::uniform_int_distribution<std::int64_t>(Ratio::scale / 2, Ratio::scale * 2)(rng));
+
+        for (unsigned id = 0; id < game.properties.size(); ++id) {
+            if (percent(rng) < 25) continue;
+            const unsigned owner = std::uniform_int_distribution<unsigned>(0, 3)(rng);
+            game.properties[id].owner_id = owner;
+            game.player(owner).properties |= PropertySet(1ull << id);
+        }
+
+        for (const auto set : colour_sets) {
+            const auto& first = game.properties[property_id(set)];
+            if (!first.owner_id || (game.player(*first.owner_id).properties & set) != set) {
+                continue;
+            }
+            const int houses = std::uniform_int_distribution<int>(0, 5)(rng);
+            for_each_property(set, game, [houses](Property& p) { p.houses = houses; });
+        }
+
+        for (auto& property : game.properties) {
+            if (property.owner_id && property.houses == 0 && percent(rng) < 15) {
+                property.mortgage(property.guide_price() / 2);
+            }
+        }
+
+        for (unsigned id = 0; id < game.num_players(); ++id) {
+            auto& player = game.player(id);
+            player.cash = std::uniform_int_distribution<int>(0, 3000)(rng);
+            player.secured_debt = std::uniform_int_distribution<int>(0, 2000)(rng);
+            player.unsecured_debt = std::uniform_int_distribution<int>(0, 200)(rng);
+            game.player_changed(id);
+        }
+        game.properties_changed(~0ull);
+        return game;
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long games = 4096;
+    unsigned long long repeats = 200;
+    unsigned long long seed = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "games", games) && !parse_option(arg, "repeats", repeats)
+            && !parse_option(arg, "seed", seed)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::mt19937_64 rng{seed};
+    std::deque<Ruleset> rulesets;
+    std::vector<Game> game_list;
+    GameBatch batch;
+    for (unsigned long long i = 0; i < games; ++i) {
+        game_list.push_back(random_game(rng, rulesets));
+        batch.add(game_list.back());
+    }
+
+    using Scalar = int (*)(const Player&, const Game&) noexcept;
+    using Batched = void (GameBatch::*)(std::vector<int>&) const;
+    struct Function {
+        const char* name;
+        Scalar scalar;
+        Batched batched;
+    };
+    const Function functions[] = {
+        {"asset_value", asset_value, &GameBatch::asset_value},
+        {"expected_income", expected_income, &GameBatch::expected_income},
+        {"interest_to_pay", interest_to_pay, &GameBatch::interest_to_pay},
+        {"max_secured_debt", max_secured_debt, &GameBatch::max_secured_debt},
+    };
+
+    std::cout << batch.size() << " players in " << games << " games, kernels for "
+              << GameBatch::instruction_set() << " (" << GameBatch::width() << " lanes)\n\n"
+              << std::left << std::setw(18) << "function" << std::right << std::setw(14)
+              << "scalar ns/pl" << std::setw(14) << "batch ns/pl" << std::setw(10) << "speedup"
+              << "\n";
+
+    bool all_match = true;
+    for (const auto& function : functions) {
+        std::vector<int> expected(batch.size());
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long long r = 0; r < repeats; ++r) {
+            std::size_t lane = 0;
+            for (const auto& game : game_list) {
+                for (const auto& player : game.players()) {
+                    expected[lane++] = function.scalar(player, game);
+                }
+            }
+        }
+        const double scalar_seconds = seconds_since(start);
+
+        std::vector<int> actual;
+        start = std::chrono::steady_clock::now();
+        for (unsigned long long r = 0; r < repeats; ++r) {
+            (batch.*function.batched)(actual);
+        }
+        const double batch_seconds = seconds_since(start);
+
+        const bool match = actual == expected;
+        all_match = all_match && match;
+
+        const double evaluations = double(batch.size()) * repeats;
+        std::cout << std::left << std::setw(18) << function.name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(14) << scalar_seconds / evaluations * 1e9
+                  << std::setw(14) << batch_seconds / evaluations * 1e9 << std::setw(9)
+                  << scalar_seconds / batch_seconds << "x" << (match ? "" : "  MISMATCH")
+                  << "\n";
+    }
+
+    return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,141 @@
+// Plays random walks through the mutators on the standard board and on made
+// up boards of 64 and 128 properties, timing each step and checking the
+// players' totals and the hash against a recount at the end.
+//
+// Usage: board_bench [--steps=N] [--seed=N]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "options.h"
+
+namespace {
+    using Rng = std::mt19937_64;
+
+    // Groups of eight properties: two streets of three, then a pair of
+    // stations or a pair of utilities, taking turns
+    template <std::size_t N>
+    BasicPropertyInfo<N> made_up_property(unsigned id)
+    {
+        using Set = BasicPropertySet<N>;
+        const int group = id / 8;
+        const unsigned first = id / 8 * 8;
+        const std::string name = "Property " + std::to_string(id);
+
+        if (id % 8 < 6) {
+            const unsigned leader = id % 8 < 3 ? first : first + 3;
+            const Set set = Set::only(leader) | Set::only(leader + 1) | Set::only(leader + 2);
+            const int price = 60 + 10 * (id % 8) + 20 * group;
+            return {name, price, 50 + 10 * group, set,
+                    {{price / 10, price / 2, price * 3 / 2, price * 4, price * 5, price * 6}}};
+        }
+
+        const Set pair = Set::only(first + 6) | Set::only(first + 7);
+        if (group % 2 == 0) {
+            return {name, 200, 0, pair, {{25, 50, 0, 0, 0, 0}}, PropertyKind::station};
+        }
+        return {name, 150, 0, pair, {{4, 10, 0, 0, 0, 0}}, PropertyKind::utility};
+    }
+
+    template <std::size_t N, std::size_t... Ids>
+    BasicRuleset<N> made_up_board(std::index_sequence<Ids...>)
+    {
+        return {"Made up", {{made_up_property<N>(Ids)...}}};
+    }
+
+    template <std::size_t N>
+    BasicRuleset<N> made_up_board()
+    {
+        static_assert(N % 8 == 0);
+        return made_up_board<N>(std::make_index_sequence<N>{});
+    }
+
+    template <std::size_t N>
+    void random_step(BasicGame<N>& game, Rng& rng)
+    {
+        std::uniform_int_distribution<unsigned> any_player(0, game.num_players() - 1);
+        const unsigned player = any_player(rng);
+        const unsigned other = any_player(rng);
+        const unsigned id = std::uniform_int_distribution<unsigned>(0, N - 1)(rng);
+        const auto set = game.properties[id].set();
+
+        switch (std::uniform_int_distribution<int>(0, 7)(rng)) {
+        case 0: buy_property(game, player, id, game.properties[id].guide_price()); break;
+        case 1: mortgage(game, player, id); break;
+        case 2: unmortgage(game, player, id); break;
+        case 3: build_houses(game, player, set, 1); break;
+        case 4: sell_houses(game, player, set, 1); break;
+        case 5: transfer(game, player, other, 10, game.player(player).properties & set); break;
+        case 6: passgo(game, player); break;
+        case 7: pay_to_bank(game, player, 20); break;
+        }
+    }
+
+    template <std::size_t N>
+    bool run(const char* name, BasicGame<N> game, unsigned long long steps, Rng& rng)
+    {
+        for (unsigned id = 0; id < game.num_players(); ++id) {
+            game.player(id).cash = 1 << 24;
+            game.player_changed(id);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned long long i = 0; i < steps; ++i) random_step(game, rng);
+        const double seconds
+            = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const bool valid = game.totals_valid() && game.hash_valid();
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(6) << N
+                  << std::setw(10) << sizeof(typename BasicGame<N>::Set) << std::setw(12)
+                  << memory_usage(game) << std::fixed << std::setprecision(1) << std::setw(12)
+                  << seconds / steps * 1e9 << (valid ? "" : "  INVALID") << "\n";
+        return valid;
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long steps = 1000000;
+    unsigned long long seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "steps", steps) && !parse_option(arg, "seed", seed)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << std::left << std::setw(10) << "board" << std::right << std::setw(6)
+              << "props" << std::setw(10) << "set bytes" << std::setw(12) << "game bytes"
+              << std::setw(12) << "ns/step" << "\n";
+
+    Rng rng{seed};
+    const std::vector<Player> players = {Player{"A"}, Player{"B"}, Player{"C"}, Player{"D"}};
+    bool valid = run("standard", Game(players), steps, rng);
+
+    const auto board64 = made_up_board<64>();
+    using Player64 = BasicPlayer<64>;
+    valid &= run("made up", BasicGame<64>(board64,
+                                          {Player64{"A"}, Player64{"B"}, Player64{"C"},
+                                           Player64{"D"}}),
+                 steps, rng);
+
+    const auto board128 = made_up_board<128>();
+    using Player128 = BasicPlayer<128>;
+    valid &= run("made up", BasicGame<128>(board128,
+                                           {Player128{"A"}, Player128{"B"}, Player128{"C"},
+                                            Player128{"D"}}),
+                 steps, rng);
+
+    return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
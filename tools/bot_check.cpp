@@ -0,0 +1,151 @@
+// Checks that bots in the same game go quiet after each change somebody else
+// makes, rather than answering each other's moves for ever. Plays a game
+// with a person and several bots, the person passing go every so often, and
+// fails if the bots make more moves than they could in one answer each.
+//
+// Usage: bot_check [--bots=N] [--rounds=N] [--budget_ms=N]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bot.h"
+#include "game_history.h"
+#include "options.h"
+#include "thread_pool.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Does what GameServer does for bots, without any clients
+    struct Host : BotHost {
+        explicit Host(Game game)
+            : history_{std::move(game)}
+        {}
+
+        std::uint64_t version() override {
+            std::unique_lock<std::recursive_mutex> lock(mutex_);
+            return version_;
+        }
+
+        Result play(const GameEvent& event) override {
+            std::unique_lock<std::recursive_mutex> lock(mutex_);
+            const Result r = history_.apply(event);
+            if (!r) return r;
+            ++version_;
+            ++changes_;
+            for (auto* bot : bots_) bot->game_changed(version_, history_.current_game());
+            return r;
+        }
+
+        void add_bot(Bot* bot) {
+            std::unique_lock<std::recursive_mutex> lock(mutex_);
+            bots_.push_back(bot);
+            bot->game_changed(version_, history_.current_game());
+        }
+
+        // Every change made, by anyone
+        unsigned long long changes() {
+            std::unique_lock<std::recursive_mutex> lock(mutex_);
+            return changes_;
+        }
+    private:
+        std::recursive_mutex mutex_;
+        GameHistory history_;
+        std::uint64_t version_ = 0;
+        unsigned long long changes_ = 0;
+        std::vector<Bot*> bots_;
+    };
+
+    // Waits for the number of changes to stop going up, returning it, or
+    // nothing if it's still going up at the deadline
+    std::optional<unsigned long long> wait_for_quiet(Host& host, Clock::duration quiet,
+                                                     Clock::time_point deadline)
+    {
+        unsigned long long changes = host.changes();
+        auto changed_at = Clock::now();
+        while (Clock::now() < deadline) {
+            std::this_thread::sleep_for(quiet / 10);
+            const unsigned long long now = host.changes();
+            if (now != changes) {
+                changes = now;
+                changed_at = Clock::now();
+            } else if (Clock::now() - changed_at >= quiet) {
+                return changes;
+            }
+        }
+        return {};
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long bots = 3;
+    unsigned long long rounds = 5;
+    unsigned long long budget_ms = 20;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "bots", bots) && !parse_option(arg, "rounds", rounds)
+            && !parse_option(arg, "budget_ms", budget_ms)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (bots < 2) throw std::runtime_error("--bots must be at least 2");
+
+    std::vector<Player> players{Player("Person")};
+    for (unsigned long long i = 0; i < bots; ++i) {
+        players.emplace_back("Bot " + std::to_string(i));
+    }
+    Host host{Game(std::move(players))};
+
+    SearchOptions options;
+    options.budget = std::chrono::milliseconds(budget_ms);
+    // A bot answers with one move, of at most max_actions actions
+    const unsigned long long most_per_answer = bots * options.max_actions;
+
+    // Destroyed before the pool, each waiting for its search to finish
+    ThreadPool pool(2);
+    std::vector<std::unique_ptr<Bot>> list;
+
+    const auto quiet = std::chrono::milliseconds(20 * budget_ms + 200);
+    const auto deadline = [&] { return Clock::now() + 50 * quiet; };
+
+    // Joining counts as a change made by somebody else
+    for (unsigned long long i = 0; i < bots; ++i) {
+        list.push_back(std::make_unique<Bot>(host, pool, unsigned(i + 1), options));
+        host.add_bot(list.back().get());
+    }
+
+    auto changes = wait_for_quiet(host, quiet, deadline());
+    bool failed = !changes || *changes > bots * most_per_answer;
+    std::cout << "joined: " << (changes ? std::to_string(*changes) : "never quiet")
+              << " changes\n";
+
+    for (unsigned long long round = 0; !failed && round < rounds; ++round) {
+        const unsigned long long before = *changes;
+        host.play(GameEvent{[](Game& g) { return passgo(g, 0); }});
+
+        changes = wait_for_quiet(host, quiet, deadline());
+        failed = !changes || *changes - before > 1 + most_per_answer;
+        std::cout << "round " << round << ": "
+                  << (changes ? std::to_string(*changes - before) : "never quiet")
+                  << " changes\n";
+    }
+
+    list.clear();
+    if (failed) {
+        std::cerr << "The bots kept answering each other" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
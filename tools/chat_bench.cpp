@@ -0,0 +1,191 @@
+// Measures how long game events take to apply while other threads chat as
+// fast as a busy table could, first with chat posted under the game's lock
+// (as every event used to be) and then with chat going to its own lock free
+// chat log. Both runs carry the same chat load and the same game events.
+//
+// Usage: chat_bench [--events=N] [--chatters=N] [--chat_rate=N] [--gap_us=N] [--seed=N]
+//
+// chat_rate is messages a second from each chatter, gap_us the pause between
+// game events.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bot_search.h"
+#include "chat_log.h"
+#include "event.h"
+#include "game_history.h"
+#include "replay_buffer.h"
+#include "options.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    GameEvent random_event(const Game& game, Rng& rng)
+    {
+        const unsigned player
+            = std::uniform_int_distribution<unsigned>(0, game.num_players() - 1)(rng);
+        const auto actions = legal_actions(game, player);
+        const auto action
+            = actions[std::uniform_int_distribution<std::size_t>(0, actions.size() - 1)(rng)];
+        return GameEvent{[action, player](Game& g) { return action.apply(g, player); }};
+    }
+
+    struct Options {
+        unsigned long long events = 20000;
+        unsigned long long chatters = 4;
+        unsigned long long chat_rate = 50000;
+        unsigned long long gap_us = 50;
+        unsigned long long seed = 1;
+    };
+
+    struct Run {
+        // Time from asking for each game event to it being applied, sorted
+        std::vector<double> latencies_us;
+        unsigned long long messages = 0;
+        double seconds = 0;
+    };
+
+    // The game side is the same in both runs: a game event is applied and
+    // numbered under the game's lock, as GameServer::apply then post do
+    template <typename SendMessage>
+    Run run(const Options& options, std::recursive_mutex& game_mutex, GameHistory& history,
+            ReplayBuffer& replay, SendMessage send_message)
+    {
+        std::atomic<bool> stop{false};
+        std::atomic<unsigned long long> messages{0};
+
+        std::vector<std::thread> chatters;
+        for (unsigned long long c = 0; c < options.chatters; ++c) {
+            chatters.emplace_back([&, c] {
+                // Sent in bursts, to keep to the rate without sleeping for
+                // every message
+                constexpr unsigned long long burst = 100;
+                const auto interval = std::chrono::duration<double>(
+                    double(burst) / std::max(options.chat_rate, 1ull));
+                auto next = Clock::now();
+                unsigned long long sent = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (unsigned long long i = 0; i < burst; ++i, ++sent) {
+                        send_message(MessageEvent{"message " + std::to_string(sent),
+                                                  "Chatter " + std::to_string(c)});
+                    }
+                    messages += burst;
+                    next += std::chrono::duration_cast<Clock::duration>(interval);
+                    std::this_thread::sleep_until(next);
+                }
+            });
+        }
+
+        Rng rng{options.seed};
+        Run result;
+        result.latencies_us.reserve(options.events);
+        const auto start = Clock::now();
+        for (unsigned long long i = 0; i < options.events; ++i) {
+            const auto event = random_event(history.current_game(), rng);
+
+            const auto asked = Clock::now();
+            {
+                std::unique_lock<std::recursive_mutex> lock(game_mutex);
+                if (history.apply(event)) replay.push(Event{event});
+            }
+            result.latencies_us.push_back(
+                std::chrono::duration<double, std::micro>(Clock::now() - asked).count());
+
+            std::this_thread::sleep_for(std::chrono::microseconds(options.gap_us));
+        }
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        stop = true;
+        for (auto& chatter : chatters) chatter.join();
+        result.messages = messages;
+
+        std::sort(result.latencies_us.begin(), result.latencies_us.end());
+        return result;
+    }
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty()) return 0;
+        return sorted[std::min(sorted.size() - 1, std::size_t(p * sorted.size()))];
+    }
+
+    void report(const std::string& name, const Run& run)
+    {
+        std::cout << std::left << std::setw(16) << name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12) << run.messages / run.seconds
+                  << std::setw(10) << percentile(run.latencies_us, 0.5) << std::setw(10)
+                  << percentile(run.latencies_us, 0.99) << std::setw(10)
+                  << percentile(run.latencies_us, 0.999) << std::setw(10)
+                  << run.latencies_us.back() << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "events", options.events)
+            && !parse_option(arg, "chatters", options.chatters)
+            && !parse_option(arg, "chat_rate", options.chat_rate)
+            && !parse_option(arg, "gap_us", options.gap_us)
+            && !parse_option(arg, "seed", options.seed)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.events == 0) throw std::runtime_error("--events must be at least 1");
+
+    const Game start({Player{"A"}, Player{"B"}, Player{"C"}, Player{"D"}});
+
+    std::cout << options.events << " game events, " << options.chatters
+              << " chatters at up to " << options.chat_rate << " messages a second each\n"
+              << std::left << std::setw(16) << "chat" << std::right << std::setw(12)
+              << "messages/s" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+              << std::setw(10) << "p99.9 us" << std::setw(10) << "max us" << "\n";
+
+    {
+        // Chat as it was: numbered under the game's lock and logged there
+        std::recursive_mutex game_mutex;
+        GameHistory history{start};
+        ReplayBuffer replay{256};
+        std::ofstream log("/dev/null");
+        report("game lock", run(options, game_mutex, history, replay,
+                                [&](const MessageEvent& message) {
+                                    std::unique_lock<std::recursive_mutex> lock(game_mutex);
+                                    const Event event{message};
+                                    replay.push(event);
+                                    log << event.description() << std::endl;
+                                }));
+    }
+    {
+        std::recursive_mutex game_mutex;
+        GameHistory history{start};
+        ReplayBuffer replay{256};
+        auto chat = std::make_unique<ChatLog>();
+        std::atomic<unsigned long long> refused{0};
+        report("chat log", run(options, game_mutex, history, replay,
+                               [&](const MessageEvent& message) {
+                                   if (!chat->append(message.text)) ++refused;
+                               }));
+        if (refused > 0) {
+            std::cout << refused << " messages didn't fit in the chat log, lower --chat_rate\n";
+        }
+    }
+
+    return EXIT_SUCCESS;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
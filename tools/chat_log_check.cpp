@@ -0,0 +1,116 @@
+// Checks that a chat log saved to a file holds every message appended to it,
+// however many threads append at once. Once the appending threads have
+// finished, the file must have every message, without waiting for another
+// append to write out the last few, and a log loaded from it must read them
+// all back.
+//
+// Then fills a file past the point where loading it rolls it over, and checks
+// that the log starts again from the most recent messages, with room for
+// more, and that the old file is kept in full.
+//
+// Usage: chat_log_check [--threads=N] [--messages=N] [--rounds=N]
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chat_log.h"
+#include "options.h"
+
+namespace {
+    std::uint64_t count_lines(const std::string& path)
+    {
+        std::ifstream in(path);
+        std::uint64_t lines = 0;
+        for (std::string line; std::getline(in, line);) ++lines;
+        return lines;
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long threads = 4;
+    unsigned long long messages = 5000;
+    unsigned long long rounds = 20;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "threads", threads) && !parse_option(arg, "messages", messages)
+            && !parse_option(arg, "rounds", rounds)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string path
+        = (std::filesystem::temp_directory_path() / "chat_log_check.log").string();
+    bool failed = false;
+
+    for (unsigned long long round = 0; !failed && round < rounds; ++round) {
+        std::filesystem::remove(path);
+        std::uint64_t size = 0;
+        {
+            ChatLog chat{path};
+            std::vector<std::thread> appenders;
+            for (unsigned long long t = 0; t < threads; ++t) {
+                appenders.emplace_back([&chat, t, messages] {
+                    for (unsigned long long i = 0; i < messages; ++i) {
+                        chat.append(std::to_string(t) + " " + std::to_string(i));
+                    }
+                });
+            }
+            for (auto& appender : appenders) appender.join();
+
+            size = chat.size();
+            const std::uint64_t written = count_lines(path);
+            if (size != threads * messages || written != size) {
+                std::cerr << "round " << round << ": " << size << " messages published, "
+                          << written << " written\n";
+                failed = true;
+            }
+        }
+
+        const ChatLog loaded{path};
+        if (!failed && loaded.size() != size) {
+            std::cerr << "round " << round << ": " << loaded.size() << " messages loaded of "
+                      << size << "\n";
+            failed = true;
+        }
+    }
+
+    if (!failed) {
+        const std::uint64_t lines = ChatLog::roll_over_above + 1;
+        {
+            std::ofstream out(path);
+            for (std::uint64_t i = 0; i < lines; ++i) out << i << '\n';
+        }
+
+        ChatLog chat{path};
+        const auto newest = chat.read(chat.size() - 1, chat.size());
+        const bool rolled = chat.size() == ChatLog::kept_on_roll_over
+                            && newest.messages.size() == 1
+                            && newest.messages[0] == std::to_string(lines - 1)
+                            && count_lines(path + ".1") == lines && chat.append("more");
+        std::cout << "rolled over " << lines << " messages to " << chat.size() << "\n";
+        if (!rolled) {
+            std::cerr << "Loading a full chat log didn't roll it over\n";
+            failed = true;
+        }
+    }
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".1");
+
+    if (failed) {
+        std::cerr << "The chat log lost messages" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << rounds << " rounds of " << threads << " x " << messages
+              << " messages, all written\n";
+    return EXIT_SUCCESS;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
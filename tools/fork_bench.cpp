@@ -0,0 +1,93 @@
+// Makes many forks of one game, tries a few random actions on each, and
+// reports what the forks cost in time and memory next to copying the whole
+// game. Then checks that a fork merges back as a single undoable step, and
+// that a fork of a game that has since moved on is refused.
+//
+// Usage: fork_bench [--forks=N] [--actions=N] [--seed=N]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bot_search.h"
+#include "game_history.h"
+#include "options.h"
+
+namespace {
+    // An action any bot could take now, as the event a player would send
+    GameEvent random_event(const Game& game, Rng& rng)
+    {
+        const unsigned player
+            = std::uniform_int_distribution<unsigned>(0, game.num_players() - 1)(rng);
+        const auto actions = legal_actions(game, player);
+        const auto action
+            = actions[std::uniform_int_distribution<std::size_t>(0, actions.size() - 1)(rng)];
+        return GameEvent{[action, player](Game& g) { return action.apply(g, player); }};
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long forks = 1000;
+    unsigned long long actions = 3;
+    unsigned long long seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "forks", forks) && !parse_option(arg, "actions", actions)
+            && !parse_option(arg, "seed", seed)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Rng rng{seed};
+    GameHistory history(Game({Player{"A"}, Player{"B"}, Player{"C"}, Player{"D"}}));
+    for (int i = 0; i < 40; ++i) history.apply(random_event(history.current_game(), rng));
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<GameFork> sandboxes;
+    sandboxes.reserve(forks);
+    for (unsigned long long i = 0; i < forks; ++i) sandboxes.push_back(history.fork());
+    const double fork_seconds = seconds_since(start);
+
+    std::size_t unused_bytes = 0;
+    for (const auto& fork : sandboxes) unused_bytes += fork.memory_usage();
+
+    start = std::chrono::steady_clock::now();
+    for (auto& fork : sandboxes) {
+        for (unsigned long long i = 0; i < actions; ++i) fork.apply(random_event(fork.game(), rng));
+    }
+    const double apply_seconds = seconds_since(start);
+
+    std::size_t used_bytes = 0;
+    for (const auto& fork : sandboxes) used_bytes += fork.memory_usage();
+
+    std::cout << std::fixed << std::setprecision(1) << forks << " forks of a "
+              << memory_usage(history.current_game()) << " byte game\n"
+              << "fork           " << std::setw(10) << fork_seconds / forks * 1e9 << " ns, "
+              << std::setw(8) << unused_bytes / forks << " bytes each\n"
+              << "after " << actions << " actions " << std::setw(10)
+              << apply_seconds / (forks * actions) * 1e9 << " ns per action, " << std::setw(8)
+              << used_bytes / forks << " bytes each\n";
+
+    // Keep the first fork, then try to keep the second, which was made from
+    // the game the first one has now replaced
+    bool valid = true;
+    const std::uint64_t before = history.current_game().hash();
+    auto& kept = sandboxes.front();
+    while (!kept.changed()) kept.apply(random_event(kept.game(), rng));
+
+    valid = valid && history.merge(kept) && history.current_game().hash() == kept.game().hash();
+    valid = valid && (forks < 2 || !history.merge(sandboxes[1]));
+    valid = valid && history.undo() && history.current_game().hash() == before;
+
+    std::cout << "merge " << (valid ? "ok" : "FAILED") << "\n";
+    return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,102 @@
+// Checks the incremental Game::hash against a hash of the whole game from
+// scratch, after every step of random walks through the mutators. Also checks
+// that moves which undo each other give back the hash they started from.
+//
+// Usage: hash_check [--games=N] [--steps=N] [--seed=N]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "bot_search.h"
+#include "game.h"
+#include "options.h"
+
+namespace {
+    // One random mutator on a random player, on top of whatever a bot could do
+    void random_step(Game& game, Rng& rng)
+    {
+        std::uniform_int_distribution<unsigned> any_player(0, game.num_players() - 1);
+        const unsigned player = any_player(rng);
+        const unsigned other = any_player(rng);
+        const unsigned property = std::uniform_int_distribution<unsigned>(0, 27)(rng);
+        const int amount = std::uniform_int_distribution<int>(0, 300)(rng);
+
+        switch (std::uniform_int_distribution<int>(0, 9)(rng)) {
+        case 0: passgo(game, player); break;
+        case 1: pay_to_bank(game, player, amount); break;
+        case 2: pay_to_player(game, player, amount); break;
+        case 3: sell_property(game, player, property); break;
+        case 4: {
+            const auto some = game.player(player).properties & PropertySet(0x5555555);
+            transfer(game, player, other, amount / 10, some.to_ulong());
+            break;
+        }
+        case 5: pay_repairs(game, player, 25, 100); break;
+        case 6: amount % 2 ? raise_interest(game) : lower_interest(game); break;
+        default: {
+            const auto actions = legal_actions(game, player);
+            std::uniform_int_distribution<std::size_t> any_action(0, actions.size() - 1);
+            actions[any_action(rng)].apply(game, player);
+        }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long games = 200;
+    unsigned long long steps = 500;
+    unsigned long long seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "games", games) && !parse_option(arg, "steps", steps)
+            && !parse_option(arg, "seed", seed)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Rng rng{seed};
+    unsigned long long checked = 0, invalid = 0, not_restored = 0;
+    double incremental_seconds = 0.0, scratch_seconds = 0.0;
+    std::uint64_t checksum = 0;
+
+    for (unsigned long long g = 0; g < games; ++g) {
+        Game game({Player{"A"}, Player{"B"}, Player{"C"}, Player{"D"}});
+        for (unsigned long long s = 0; s < steps; ++s) {
+            random_step(game, rng);
+
+            auto start = std::chrono::steady_clock::now();
+            checksum += game.hash();
+            incremental_seconds += seconds_since(start);
+
+            start = std::chrono::steady_clock::now();
+            const bool valid = game.hash_valid();
+            scratch_seconds += seconds_since(start);
+
+            ++checked;
+            if (!valid) ++invalid;
+
+            // Take out and pay off the same debt, which leaves the game as it was
+            const std::uint64_t before = game.hash();
+            const unsigned player = s % game.num_players();
+            if (take_out_unsecured_debt(game, player, 10)) {
+                pay_off_unsecured_debt(game, player, 10);
+                if (game.hash() != before) ++not_restored;
+            }
+        }
+    }
+
+    std::cout << checked << " states checked: " << invalid << " invalid, " << not_restored
+              << " not restored by undoing a move\n"
+              << "incremental " << incremental_seconds / checked * 1e9 << " ns, from scratch "
+              << scratch_seconds / checked * 1e9 << " ns  (checksum " << checksum << ")\n";
+
+    return invalid == 0 && not_restored == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,98 @@
+// Times the mutators and checks that walk over sets of properties, on a game
+// where every colour set is owned and being built on.
+//
+// Usage: mutator_bench [--iterations=N]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "board.h"
+#include "game.h"
+#include "options.h"
+
+namespace {
+    // Each player owns every other colour set and some stations
+    Game built_up_game()
+    {
+        Game game({Player{"A"}, Player{"B"}});
+        for (unsigned i = 0; i < colour_sets.size(); ++i) {
+            const unsigned owner = i % 2;
+            game.player(owner).properties |= colour_sets[i];
+            for_each_property(colour_sets[i], game, [owner](Property& p) {
+                p.owner_id = owner;
+                p.houses = 2;
+            });
+        }
+        for (unsigned id = 22; id < 26; ++id) {
+            game.properties[id].owner_id = id % 2;
+            game.player(id % 2).properties |= PropertySet(1ull << id);
+        }
+        game.player(0).cash = game.player(1).cash = 1 << 30;
+        game.properties_changed(~0ull);
+        game.player_changed(0);
+        game.player_changed(1);
+        return game;
+    }
+
+    template <typename F>
+    void time(const char* name, unsigned long long iterations, F function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        long long checksum = 0;
+        for (unsigned long long i = 0; i < iterations; ++i) checksum += function(i);
+        const double seconds
+            = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(10) << seconds / iterations * 1e9
+                  << " ns  (checksum " << checksum << ")\n";
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long iterations = 1000000;
+    for (int i = 1; i < argc; ++i) {
+        if (!parse_option(argv[i], "iterations", iterations)) {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Game game = built_up_game();
+    const PropertySet stations = (PropertySet::station & game.player(0).properties).to_ulong();
+
+    // Build then sell, so the game stays the same from one iteration to the next
+    time("build + sell houses", iterations, [&game](unsigned long long i) {
+        const auto set = colour_sets[(i % 4) * 2];
+        return bool(build_houses(game, 0, set, 2)) + bool(sell_houses(game, 0, set, 2));
+    });
+    time("can_build_houses", iterations, [&game](unsigned long long i) {
+        return bool(can_build_houses(game, 0, colour_sets[(i % 4) * 2], 1));
+    });
+    time("can_pay_repairs", iterations, [&game](unsigned long long) {
+        return bool(can_pay_repairs(game, 0, 25, 100));
+    });
+    time("pay_repairs", iterations, [&game](unsigned long long) {
+        game.player(0).cash += 1000;
+        game.player_changed(0);
+        return bool(pay_repairs(game, 0, 25, 100));
+    });
+    time("can_transfer", iterations, [&game, stations](unsigned long long) {
+        return bool(can_transfer(game, 0, 1, 0, stations));
+    });
+    time("transfer and back", iterations, [&game, stations](unsigned long long) {
+        return bool(transfer(game, 0, 1, 0, stations)) + bool(transfer(game, 1, 0, 0, stations));
+    });
+    time("property_ids", iterations, [&game](unsigned long long i) {
+        long long sum = 0;
+        for (const unsigned id : property_ids(game.player(i % 2).properties)) sum += id;
+        return sum;
+    });
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
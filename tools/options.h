@@ -0,0 +1,21 @@
+#pragma once
+
+// Helpers shared by the headless tools
+
+#include <chrono>
+#include <string>
+
+// Reads "--name=value" into value, returning whether arg was that option
+inline bool parse_option(const std::string& arg, const std::string& name,
+                         unsigned long long& value)
+{
+    const std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+    value = std::stoull(arg.substr(prefix.size()));
+    return true;
+}
+
+inline double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,114 @@
+// Times loading rulesets from text and starting games with them, and shows
+// how much memory each game saves by sharing its ruleset. A ruleset named
+// Standard is checked against the built in standard ruleset.
+//
+// Usage: ruleset_bench [--loads=N] [--games=N] [file...]
+//
+// With no files, loads rulesets/standard.txt.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ruleset.h"
+#include "options.h"
+
+namespace {
+    bool same_rules(const Rules& a, const Rules& b)
+    {
+        return a.ppi_memory == b.ppi_memory
+               && a.starting_secured_interest == b.starting_secured_interest
+               && a.starting_unsecured_interest == b.starting_unsecured_interest
+               && a.max_unsecured_debt == b.max_unsecured_debt
+               && a.secured_debt_salaries == b.secured_debt_salaries
+               && a.unmortgage_factor == b.unmortgage_factor;
+    }
+
+    bool same_ruleset(const Ruleset& a, const Ruleset& b)
+    {
+        if (!same_rules(a.rules(), b.rules())) return false;
+        for (unsigned id = 0; id < Game::num_properties; ++id) {
+            const auto& p = a.property(id);
+            const auto& q = b.property(id);
+            if (p.name != q.name || p.guide_price != q.guide_price
+                || p.house_price != q.house_price || p.set != q.set || p.rents != q.rents
+                || p.kind != q.kind || p.landing_weight != q.landing_weight) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long loads = 10000;
+    unsigned long long games = 100000;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (parse_option(arg, "loads", loads) || parse_option(arg, "games", games)) continue;
+        if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+        paths.push_back(arg);
+    }
+    if (paths.empty()) paths.push_back("rulesets/standard.txt");
+
+    std::cout << std::left << std::setw(28) << "ruleset" << std::right << std::setw(12)
+              << "us/load" << std::setw(12) << "bytes" << std::setw(12) << "ns/game" << "\n";
+
+    bool valid = true;
+    for (const auto& path : paths) {
+        // Read from memory, so only parsing and building the tables is timed
+        std::ifstream file(path);
+        if (!file) throw std::runtime_error(path + ": can't be opened");
+        std::stringstream contents;
+        contents << file.rdbuf();
+        const std::string text = contents.str();
+
+        std::size_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long long i = 0; i < loads; ++i) {
+            std::istringstream in(text);
+            checksum += parse_ruleset<num_standard_properties>(in, path).property_index().size();
+        }
+        const double load_seconds = seconds_since(start);
+
+        std::istringstream in(text);
+        const Ruleset ruleset = parse_ruleset<num_standard_properties>(in, path);
+
+        start = std::chrono::steady_clock::now();
+        for (unsigned long long i = 0; i < games; ++i) {
+            const Game game(ruleset, {Player{"A"}, Player{"B"}, Player{"C"}, Player{"D"}});
+            checksum += game.hash();
+        }
+        const double game_seconds = seconds_since(start);
+
+        const bool same = ruleset.name() != standard_ruleset().name()
+                          || same_ruleset(ruleset, standard_ruleset());
+        valid = valid && same;
+
+        std::cout << std::left << std::setw(28) << ruleset.name() << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(12) << load_seconds / loads * 1e6
+                  << std::setw(12) << memory_usage(ruleset) << std::setw(12)
+                  << game_seconds / games * 1e9 << (same ? "" : "  DIFFERS FROM BUILT IN")
+                  << "  (checksum " << checksum << ")\n";
+    }
+
+    const Game game({Player{"A"}, Player{"B"}, Player{"C"}, Player{"D"}});
+    std::cout << "\nEach game: " << sizeof(Game) << " bytes, " << memory_usage(game)
+              << " with its players. Shared by every game on a ruleset: "
+              << memory_usage(standard_ruleset()) << " bytes.\n";
+
+    return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,67 @@
+// Plays many games of the full board game headlessly, one seat per strategy,
+// and reports how they went and how fast they were played.
+//
+// Usage: simulate [--games=N] [--threads=N] [--seed=N] [--max-rounds=N] strategy...
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "simulation.h"
+#include "thread_pool.h"
+#include "options.h"
+
+int main(int argc, char** argv)
+try {
+    unsigned long long games = 100000;
+    unsigned long long threads = std::thread::hardware_concurrency();
+    unsigned long long seed = 1;
+    unsigned long long max_rounds = SimulationOptions{}.max_rounds;
+    std::vector<Strategy> strategies;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (parse_option(arg, "games", games) || parse_option(arg, "threads", threads)
+            || parse_option(arg, "seed", seed) || parse_option(arg, "max-rounds", max_rounds)) {
+            continue;
+        }
+
+        auto strategy = strategy_by_name(arg);
+        if (!strategy) {
+            std::cerr << "Unknown strategy: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+        strategies.push_back(std::move(*strategy));
+    }
+    // Every figure reported is per game
+    if (games == 0) throw std::runtime_error("--games must be at least 1");
+
+    if (strategies.empty()) {
+        strategies = {cautious_strategy(), cautious_strategy(),
+                      aggressive_strategy(), aggressive_strategy()};
+    }
+
+    SimulationOptions options;
+    options.max_rounds = max_rounds;
+
+    ThreadPool pool(threads);
+    const auto stats = simulate_games(pool, games, strategies, seed, options);
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "Simulated " << stats.games << " games in " << stats.seconds << "s on "
+              << pool.size() << " threads (" << stats.games_per_second() << " games/sec)\n"
+              << "Finished: " << 100.0 * stats.finished / stats.games << "%, "
+              << "average rounds: " << double(stats.rounds) / stats.games << ", "
+              << "bankruptcies per game: " << double(stats.bankruptcies) / stats.games << '\n';
+
+    for (unsigned seat = 0; seat < strategies.size(); ++seat) {
+        std::cout << "Seat " << seat << " (" << strategies[seat].name << ") won "
+                  << 100.0 * stats.wins[seat] / stats.games << "%\n";
+    }
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,141 @@
+// Plays games for every combination of the given rule values, all at once
+// across every core, and writes a line of CSV statistics per combination.
+//
+// Usage: sweep [--games=N] [--threads=N] [--seed=N] [--max-rounds=N]
+//              rule=value,value,... [strategy...]
+//
+// e.g. sweep --games=10000 ppi_memory=0.25,0.5,0.75 max_unsecured_debt=100,200,400
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "simulation.h"
+#include "thread_pool.h"
+#include "options.h"
+
+namespace {
+    std::vector<std::string> split(const std::string& s, char delimiter)
+    {
+        std::vector<std::string> parts;
+        std::size_t start = 0;
+        while (true) {
+            const auto end = s.find(delimiter, start);
+            parts.push_back(s.substr(start, end - start));
+            if (end == std::string::npos) return parts;
+            start = end + 1;
+        }
+    }
+
+    struct Axis {
+        std::string rule;
+        std::vector<std::string> values;
+    };
+
+    struct Config {
+        std::vector<std::string> values;
+        Rules rules;
+        std::optional<Ruleset> ruleset;
+        SimulationOptions options;
+        std::vector<SimulationStats> batch_stats;
+        SimulationStats stats;
+    };
+}
+
+int main(int argc, char** argv)
+try {
+    unsigned long long games = 10000;
+    unsigned long long threads = std::thread::hardware_concurrency();
+    unsigned long long seed = 1;
+    unsigned long long max_rounds = SimulationOptions{}.max_rounds;
+    std::vector<Axis> axes;
+    std::vector<Strategy> strategies;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (parse_option(arg, "games", games) || parse_option(arg, "threads", threads)
+            || parse_option(arg, "seed", seed) || parse_option(arg, "max-rounds", max_rounds)) {
+            continue;
+        }
+
+        const auto equals = arg.find('=');
+        if (equals != std::string::npos) {
+            axes.push_back({arg.substr(0, equals), split(arg.substr(equals + 1), ',')});
+            continue;
+        }
+
+        auto strategy = strategy_by_name(arg);
+        if (!strategy) {
+            std::cerr << "Unknown strategy: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+        strategies.push_back(std::move(*strategy));
+    }
+    // Every figure reported is per game
+    if (games == 0) throw std::runtime_error("--games must be at least 1");
+
+    if (strategies.empty()) {
+        strategies = {cautious_strategy(), cautious_strategy(),
+                      aggressive_strategy(), aggressive_strategy()};
+    }
+
+    // Cartesian product of every axis
+    std::vector<std::unique_ptr<Config>> configs;
+    configs.push_back(std::make_unique<Config>());
+    configs.back()->options.max_rounds = max_rounds;
+    for (const auto& axis : axes) {
+        std::vector<std::unique_ptr<Config>> expanded;
+        for (const auto& config : configs) {
+            for (const auto& value : axis.values) {
+                auto c = std::make_unique<Config>(*config);
+                if (!set_rule(c->rules, axis.rule, value)) {
+                    std::cerr << "Bad rule: " << axis.rule << "=" << value << std::endl;
+                    return EXIT_FAILURE;
+                }
+                c->values.push_back(value);
+                expanded.push_back(std::move(c));
+            }
+        }
+        configs = std::move(expanded);
+    }
+
+    // Every configuration plays the standard board, with its own rules
+    for (auto& config : configs) {
+        config->ruleset.emplace("Standard", standard_ruleset().properties(), config->rules);
+        config->options.ruleset = &*config->ruleset;
+    }
+
+    // Queue every configuration before waiting, so that the pool never runs
+    // dry between configurations. Every configuration uses the same seed, so
+    // they all see the same dice.
+    ThreadPool pool(threads);
+    for (auto& config : configs) {
+        submit_games(pool, games, strategies, seed, config->options, config->batch_stats);
+    }
+    pool.wait();
+
+    // In order of batch, so every run gives exactly the same results
+    for (auto& config : configs) {
+        for (const auto& batch : config->batch_stats) config->stats.merge(batch);
+    }
+
+    for (const auto& axis : axes) std::cout << axis.rule << ',';
+    std::cout << "games,finished,mean_rounds,bankruptcies_per_game,mean_gini\n";
+
+    for (const auto& config : configs) {
+        const auto& stats = config->stats;
+        for (const auto& value : config->values) std::cout << value << ',';
+        std::cout << stats.games << ','
+                  << double(stats.finished) / stats.games << ','
+                  << double(stats.rounds) / stats.games << ','
+                  << double(stats.bankruptcies) / stats.games << ','
+                  << stats.gini / stats.games << '\n';
+    }
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
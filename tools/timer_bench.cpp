@@ -0,0 +1,185 @@
+// Measures inserting, cancelling and firing timers on the timer wheel the
+// scheduler uses, against an ordered map of deadlines (as a simple scheduler
+// might keep them), and checks every timer left fires on its own tick.
+//
+// Usage: timer_bench [--timers=N] [--max_delay=N] [--cancel_percent=N] [--seed=N]
+//
+// Delays are in ticks, the default spanning an hour of the scheduler's
+// 100ms ticks.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "timer_wheel.h"
+#include "options.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using Tick = TimerWheel::Tick;
+
+    struct Options {
+        unsigned long long timers = 200000;
+        unsigned long long max_delay = 36000;
+        unsigned long long cancel_percent = 50;
+        unsigned long long seed = 1;
+    };
+
+    struct Run {
+        double insert_ns = 0;
+        double cancel_ns = 0;
+        double fire_ns = 0;
+        unsigned long long fired = 0;
+        // Timers that fired on any tick but their own
+        unsigned long long late = 0;
+    };
+
+    double ns_each(Clock::time_point start, unsigned long long count)
+    {
+        if (count == 0) return 0;
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+    }
+
+    // The deadlines to insert, and which of them to cancel, the same for both
+    struct Workload {
+        std::vector<Tick> deadlines;
+        std::vector<std::size_t> cancels;
+    };
+
+    Workload make_workload(const Options& options)
+    {
+        std::mt19937_64 rng{options.seed};
+        std::uniform_int_distribution<Tick> delay(1, std::max(options.max_delay, 1ull));
+        Workload workload;
+        for (unsigned long long i = 0; i < options.timers; ++i) {
+            workload.deadlines.push_back(delay(rng));
+        }
+        std::vector<std::size_t> order(options.timers);
+        for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        order.resize(order.size() * std::min(options.cancel_percent, 100ull) / 100);
+        workload.cancels = std::move(order);
+        return workload;
+    }
+
+    Run run_wheel(const Workload& workload, Tick end)
+    {
+        Run run;
+        Tick now = 0;
+        TimerWheel wheel;
+        std::vector<TimerWheel::Id> ids;
+        ids.reserve(workload.deadlines.size());
+
+        auto start = Clock::now();
+        for (const Tick deadline : workload.deadlines) {
+            ids.push_back(wheel.insert(deadline, [&run, &now, deadline] {
+                ++run.fired;
+                if (now != deadline) ++run.late;
+            }));
+        }
+        run.insert_ns = ns_each(start, workload.deadlines.size());
+
+        start = Clock::now();
+        for (const std::size_t i : workload.cancels) wheel.cancel(ids[i]);
+        run.cancel_ns = ns_each(start, workload.cancels.size());
+
+        start = Clock::now();
+        std::vector<TimerWheel::Callback> due;
+        for (now = 1; now <= end; ++now) {
+            wheel.advance(now, due);
+            for (auto& callback : due) callback();
+            due.clear();
+        }
+        run.fire_ns = ns_each(start, run.fired);
+        return run;
+    }
+
+    Run run_map(const Workload& workload, Tick end)
+    {
+        using Key = std::pair<Tick, std::size_t>;
+        Run run;
+        Tick now = 0;
+        std::map<Key, TimerWheel::Callback> timers;
+
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < workload.deadlines.size(); ++i) {
+            const Tick deadline = workload.deadlines[i];
+            timers.emplace(Key{deadline, i}, [&run, &now, deadline] {
+                ++run.fired;
+                if (now != deadline) ++run.late;
+            });
+        }
+        run.insert_ns = ns_each(start, workload.deadlines.size());
+
+        start = Clock::now();
+        for (const std::size_t i : workload.cancels) timers.erase(Key{workload.deadlines[i], i});
+        run.cancel_ns = ns_each(start, workload.cancels.size());
+
+        start = Clock::now();
+        for (now = 1; now <= end; ++now) {
+            while (!timers.empty() && timers.begin()->first.first <= now) {
+                auto callback = std::move(timers.begin()->second);
+                timers.erase(timers.begin());
+                callback();
+            }
+        }
+        run.fire_ns = ns_each(start, run.fired);
+        return run;
+    }
+
+    void report(const std::string& name, const Run& run)
+    {
+        std::cout << std::left << std::setw(12) << name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12) << run.insert_ns << std::setw(12)
+                  << run.cancel_ns << std::setw(12) << run.fire_ns << std::setw(10) << run.fired
+                  << std::setw(8) << run.late << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+try {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!parse_option(arg, "timers", options.timers)
+            && !parse_option(arg, "max_delay", options.max_delay)
+            && !parse_option(arg, "cancel_percent", options.cancel_percent)
+            && !parse_option(arg, "seed", options.seed)) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.max_delay > TimerWheel::max_delay) {
+        throw std::runtime_error("--max_delay must be at most "
+                                 + std::to_string(TimerWheel::max_delay));
+    }
+
+    const auto workload = make_workload(options);
+    const Tick end = std::max(options.max_delay, 1ull);
+
+    std::cout << options.timers << " timers up to " << options.max_delay << " ticks away, "
+              << workload.cancels.size() << " cancelled\n"
+              << std::left << std::setw(12) << "timers" << std::right << std::setw(12)
+              << "insert ns" << std::setw(12) << "cancel ns" << std::setw(12) << "fire ns"
+              << std::setw(10) << "fired" << std::setw(8) << "late" << "\n";
+
+    const auto wheel = run_wheel(workload, end);
+    const auto map = run_map(workload, end);
+    report("wheel", wheel);
+    report("map", map);
+
+    if (wheel.late > 0 || wheel.fired != map.fired) {
+        std::cerr << "The wheel fired timers at the wrong time" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+} catch (std::exception& e) {
+    std::cerr << "exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}